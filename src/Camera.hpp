@@ -40,29 +40,28 @@ public:
     float OrthoHeight = 20.0f; 
 
 
-    glm::mat4 GetProjectionMatrix(float viewportWidth, float viewportHeight) const {
+    // sub-pixel offset of the projection in NDC units (2 / width is one pixel), set per frame
+    // by temporal anti-aliasing; zero otherwise
+    glm::vec2 Jitter = glm::vec2(0.0f);
+
+
+    glm::mat4 GetProjectionMatrix(float viewportWidth, float viewportHeight, bool jittered = true) const {
         float aspect = viewportWidth / glm::max(1.0f, viewportHeight);
-        #if defined(GLM_FORCE_DEPTH_ZERO_TO_ONE)
-            return UseOrtho
-                ? orthoMatrix(aspect) 
-                : glm::perspectiveRH_ZO(glm::radians(Zoom), aspect, Near, Far);
-        #else
-            return UseOrtho
-                ? orthoMatrix(aspect)
-                : glm::perspective(glm::radians(Zoom), aspect, Near, Far);
-        #endif
+        return GetProjectionMatrix(aspect, jittered);
     }
 
-    glm::mat4 GetProjectionMatrix(float aspect) const {
+    glm::mat4 GetProjectionMatrix(float aspect, bool jittered = true) const {
         #if defined(GLM_FORCE_DEPTH_ZERO_TO_ONE)
-            return UseOrtho
+            glm::mat4 projection = UseOrtho
                 ? orthoMatrix(aspect)
                 : glm::perspectiveRH_ZO(glm::radians(Zoom), aspect, Near, Far);
         #else
-            return UseOrtho
+            glm::mat4 projection = UseOrtho
                 ? orthoMatrix(aspect)
                 : glm::perspective(glm::radians(Zoom), aspect, Near, Far);
         #endif
+        if (jittered) { applyJitter(projection); }
+        return projection;
     }
 
     // constructor with vectors
@@ -154,6 +153,18 @@ private:
     }
 
 
+    // shifts clip-space x/y by Jitter * w, i.e. the whole image by Jitter in NDC; a perspective
+    // matrix carries w in its z column, an orthographic one has w = 1
+    void applyJitter(glm::mat4& projection) const {
+        if (UseOrtho) {
+            projection[3][0] += Jitter.x;
+            projection[3][1] += Jitter.y;
+        } else {
+            projection[2][0] -= Jitter.x;
+            projection[2][1] -= Jitter.y;
+        }
+    }
+
     glm::mat4 orthoMatrix(float aspect) const {
         float halfH = OrthoHeight * 0.5f;
         float halfW = halfH * aspect;
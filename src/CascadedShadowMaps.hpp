@@ -0,0 +1,279 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_access.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Directional-light shadows as cascades in one GL_TEXTURE_2D_ARRAY of 16-bit depth, a layer per
+// cascade. The camera frustum up to shadowDistance is cut into slices by the practical split
+// scheme (a blend of logarithmic and uniform splits) and each cascade gets an orthographic box
+// around its slice's bounding sphere. The sphere keeps the box the same size however the camera
+// turns and the box is moved in whole texels, so shadow edges don't shimmer as the camera moves.
+// The box reaches back towards the light far enough to take in every caster in the scene.
+// Like the point shadows, every cascade has a twin layer caching only the static casters; a
+// cascade's cache survives while its matrix stays put and no static caster inside it changes.
+// For filtering, each refreshed cascade is turned into exponential variance moments at half
+// resolution (EVSM: two exponentially warped depths and their squares), blurred separably and
+// mipmapped, so shading needs a single trilinear fetch. The hardware comparison sampler is kept
+// for the plain PCF fallback.
+class CascadedShadowMaps {
+    public:
+        static constexpr int MAX_CASCADES = 4;
+        static constexpr int RESOLUTION = 2048;
+        // the light-space depth range is snapped to this, so it only changes in steps
+        static constexpr float DEPTH_STEP = 4.0f;
+        // moments are stored at half resolution, the conversion averages 2x2 depth texels
+        static constexpr int MOMENT_RESOLUTION = RESOLUTION / 2;
+        static constexpr int MOMENT_LEVELS = 11;    // log2(MOMENT_RESOLUTION) + 1
+        // warp exponents (positive, negative); exp(2 * 5.54) is about the largest 16-bit float
+        static constexpr float EVSM_EXPONENTS[2] = { 5.0f, 5.0f };
+
+        enum Filter { MomentFilter, ComparisonFilter };
+
+        struct Cascade {
+            glm::mat4 matrix = glm::mat4(1.0f);     // world to light clip space
+            float splitNear = 0.0f;                 // view depths this cascade covers
+            float splitFar = 0.0f;
+            float texelSize = 0.0f;                 // world units per shadow texel
+        };
+
+        struct Stats {
+            int cacheRenders = 0;   // cascade caches rebuilt, since startup
+            int liveRenders = 0;    // cascades composited this frame
+        };
+
+        // what the UI can change, handed over whole every frame
+        struct Settings {
+            int cascadeCount = MAX_CASCADES;
+            float splitLambda = 0.75f;      // 0 = uniform splits, 1 = logarithmic
+            float shadowDistance = 100.0f;  // view depth the last cascade ends at
+            int filter = MomentFilter;
+            int blurRadius = 2;             // moment texels either side of the centre tap
+            float lightBleedReduction = 0.2f;
+        };
+
+        Settings settings;
+
+        CascadedShadowMaps(){}
+        ~CascadedShadowMaps(){}
+
+        void init() {
+            texture = createArray();
+            staticTexture = createArray();
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            momentTexture = createMomentArray(MOMENT_LEVELS, MAX_CASCADES);
+            blurTexture = createMomentArray(1, 1);
+            glGenFramebuffers(1, &momentFramebuffer);
+
+            // the depth array is also read raw (moments, the depth view), so the comparison
+            // state lives in a sampler object bound only for shading
+            glGenSamplers(1, &comparisonSampler);
+            glSamplerParameteri(comparisonSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glSamplerParameteri(comparisonSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glSamplerParameteri(comparisonSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glSamplerParameteri(comparisonSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glSamplerParameterfv(comparisonSampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+            glSamplerParameteri(comparisonSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glSamplerParameteri(comparisonSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+
+        void destroy() {
+            if (texture) { glDeleteTextures(1, &texture); }
+            if (staticTexture) { glDeleteTextures(1, &staticTexture); }
+            if (momentTexture) { glDeleteTextures(1, &momentTexture); }
+            if (blurTexture) { glDeleteTextures(1, &blurTexture); }
+            if (framebuffer) { glDeleteFramebuffers(1, &framebuffer); }
+            if (momentFramebuffer) { glDeleteFramebuffers(1, &momentFramebuffer); }
+            if (comparisonSampler) { glDeleteSamplers(1, &comparisonSampler); }
+            texture = staticTexture = momentTexture = blurTexture = 0;
+            framebuffer = momentFramebuffer = comparisonSampler = 0;
+        }
+
+        // split the camera frustum (looking down -z of view) and fit a cascade to every slice.
+        // lightDirection points from the light into the scene; the scene sphere bounds every caster
+        void update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection, const glm::vec3& sceneCenter, float sceneRadius) {
+            settings.cascadeCount = std::clamp(settings.cascadeCount, 1, MAX_CASCADES);
+            float farPlane = std::max(settings.shadowDistance, nearPlane * 2.0f);
+            float tanHalfY = std::tan(fovY * 0.5f);
+            float tanHalfX = tanHalfY * aspect;
+            // squared distance of a slice corner from the view axis, per unit of depth
+            float k2 = tanHalfX * tanHalfX + tanHalfY * tanHalfY;
+            glm::mat4 invView = glm::inverse(view);
+
+            glm::vec3 dir = glm::normalize(lightDirection);
+            glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), dir, up);
+            glm::vec3 sceneLight = glm::vec3(lightView * glm::vec4(sceneCenter, 1.0f));
+
+            float splitNear = nearPlane;
+            for (int i = 0; i < settings.cascadeCount; i++) {
+                float t = (float)(i + 1) / settings.cascadeCount;
+                float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+                float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+                float splitFar = settings.splitLambda * logSplit + (1.0f - settings.splitLambda) * uniformSplit;
+
+                // the slice's bounding sphere sits on the view axis where its near and far
+                // corners are equally far away, but no further out than the far plane
+                float depth = std::min(0.5f * (splitNear + splitFar) * (1.0f + k2), splitFar);
+                float nearReach = splitNear * splitNear * k2 + (depth - splitNear) * (depth - splitNear);
+                float farReach = splitFar * splitFar * k2 + (splitFar - depth) * (splitFar - depth);
+                float radius = std::ceil(std::sqrt(std::max(nearReach, farReach)) * 16.0f) / 16.0f;
+                glm::vec3 center = glm::vec3(invView * glm::vec4(0.0f, 0.0f, -depth, 1.0f));
+
+                // move the box in whole texels of light space
+                Cascade& cascade = cascades[i];
+                cascade.splitNear = splitNear;
+                cascade.splitFar = splitFar;
+                cascade.texelSize = 2.0f * radius / RESOLUTION;
+                glm::vec3 c = glm::vec3(lightView * glm::vec4(center, 1.0f));
+                c.x = std::floor(c.x / cascade.texelSize) * cascade.texelSize;
+                c.y = std::floor(c.y / cascade.texelSize) * cascade.texelSize;
+                // the light looks down -z: everything up to the nearest caster in front, the slice behind
+                float zNear = std::max(c.z + radius, sceneLight.z + sceneRadius);
+                float zFar = c.z - radius;
+                zNear = std::ceil(zNear / DEPTH_STEP) * DEPTH_STEP;
+                zFar = std::floor(zFar / DEPTH_STEP) * DEPTH_STEP;
+                glm::mat4 projection = glm::ortho(c.x - radius, c.x + radius, c.y - radius, c.y + radius, -zNear, -zFar);
+                cascade.matrix = projection * lightView;
+
+                if (cascade.matrix != cachedMatrix[i]) cacheValid[i] = false;
+                splitNear = splitFar;
+            }
+            for (int i = settings.cascadeCount; i < MAX_CASCADES; i++) { cacheValid[i] = false; }
+            // a different kernel needs every cascade filtered again
+            settings.blurRadius = std::clamp(settings.blurRadius, 0, MAX_BLUR_RADIUS);
+            if (settings.blurRadius != filteredBlurRadius) {
+                for (int i = 0; i < MAX_CASCADES; i++) { momentsValid[i] = false; }
+                filteredBlurRadius = settings.blurRadius;
+            }
+            stats.liveRenders = 0;
+        }
+
+        // a static caster inside these bounds changed, so drop the caches it was baked into
+        void invalidate(const glm::vec3& center, float radius) {
+            for (int i = 0; i < MAX_CASCADES; i++) {
+                if (cacheValid[i] && sphereInCascade(cachedMatrix[i], center, radius)) cacheValid[i] = false;
+            }
+        }
+
+        void invalidateAll() {
+            for (int i = 0; i < MAX_CASCADES; i++) { cacheValid[i] = false; }
+        }
+
+        // the cascade matrices are orthographic projections, so each clip axis just scales distance
+        static bool sphereInCascade(const glm::mat4& matrix, const glm::vec3& center, float radius) {
+            glm::vec4 p = matrix * glm::vec4(center, 1.0f);
+            for (int axis = 0; axis < 3; axis++) {
+                float extent = radius * glm::length(glm::vec3(glm::row(matrix, axis)));
+                if (std::abs(p[axis]) > 1.0f + extent) return false;
+            }
+            return true;
+        }
+
+        // the cascade's cache now holds its static casters
+        void markStaticRendered(int cascade) {
+            cacheValid[cascade] = true;
+            cachedMatrix[cascade] = cascades[cascade].matrix;
+            stats.cacheRenders++;
+        }
+
+        // the live layer was refreshed; with no dynamic casters it's identical to the cache
+        void markComposited(int cascade, bool dynamic) {
+            liveIsStatic[cascade] = !dynamic;
+            stats.liveRenders++;
+        }
+
+        // a live layer that is refreshed this frame has to be turned into moments again before
+        // shading samples them
+        void invalidateMoments(int cascade) { momentsValid[cascade] = false; }
+        bool needsMoments(int cascade) const { return settings.filter == MomentFilter && !momentsValid[cascade]; }
+        void markMomentsFiltered(int cascade) { momentsValid[cascade] = true; }
+
+        bool isCacheValid(int cascade) const { return cacheValid[cascade]; }
+        bool isLiveStatic(int cascade) const { return liveIsStatic[cascade]; }
+
+        // bind one layer of texture (live or cache) as the depth target
+        void bindLayer(unsigned int target, int cascade) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, 0, cascade);
+            glViewport(0, 0, RESOLUTION, RESOLUTION);
+        }
+
+        // bind level 0 of one layer of a moment array (the moments or the blur scratch) as the target
+        void bindMomentLayer(unsigned int target, int layer) {
+            glBindFramebuffer(GL_FRAMEBUFFER, momentFramebuffer);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, 0, layer);
+            glViewport(0, 0, MOMENT_RESOLUTION, MOMENT_RESOLUTION);
+        }
+
+        const Cascade& getCascade(int cascade) const { return cascades[cascade]; }
+        unsigned int getTexture() const { return texture; }
+        unsigned int getStaticTexture() const { return staticTexture; }
+        unsigned int getMomentTexture() const { return momentTexture; }
+        unsigned int getBlurTexture() const { return blurTexture; }
+        unsigned int getComparisonSampler() const { return comparisonSampler; }
+        const Stats& getStats() const { return stats; }
+        float getMemoryMB() const {
+            float depthBytes = 2.0f * MAX_CASCADES * RESOLUTION * RESOLUTION * 2;
+            float momentBytes = (MAX_CASCADES * 4.0f / 3.0f + 1.0f) * MOMENT_RESOLUTION * MOMENT_RESOLUTION * 8;
+            return (depthBytes + momentBytes) / (1024.0f * 1024.0f);
+        }
+
+    private:
+        static constexpr int MAX_BLUR_RADIUS = 8;
+
+        Cascade cascades[MAX_CASCADES];
+        bool cacheValid[MAX_CASCADES] = {};
+        bool liveIsStatic[MAX_CASCADES] = {};
+        bool momentsValid[MAX_CASCADES] = {};
+        int filteredBlurRadius = -1;
+        glm::mat4 cachedMatrix[MAX_CASCADES] = {};
+        unsigned int texture = 0;
+        unsigned int staticTexture = 0;
+        unsigned int framebuffer = 0;
+        unsigned int momentTexture = 0;
+        unsigned int blurTexture = 0;
+        unsigned int momentFramebuffer = 0;
+        unsigned int comparisonSampler = 0;
+        Stats stats;
+
+        // outside the map counts as lit
+        static unsigned int createArray() {
+            unsigned int array;
+            glGenTextures(1, &array);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT16, RESOLUTION, RESOLUTION, MAX_CASCADES);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            return array;
+        }
+
+        // moments are filtered like colour: trilinear, clamped so edge texels don't wrap around
+        static unsigned int createMomentArray(int levels, int layers) {
+            unsigned int array;
+            glGenTextures(1, &array);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA16F, MOMENT_RESOLUTION, MOMENT_RESOLUTION, layers);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            return array;
+        }
+};
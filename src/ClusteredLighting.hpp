@@ -0,0 +1,212 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "StreamBuffer.hpp"
+
+// matches PointLightData in shader.frag (std430)
+struct ClusterLight {
+    glm::vec3 position;
+    float radius;           // influence radius, the light contributes nothing past it
+    glm::vec3 color;
+    int shadowSlot;         // PointShadowMaps slot, -1 for unshadowed lights
+};
+
+// Clustered forward lighting. The view frustum is split into GRID_X * GRID_Y screen tiles and
+// GRID_Z exponentially spaced depth slices ("froxels"); every frame each light is assigned to the
+// froxels its influence sphere touches. The fragment shader finds its froxel from gl_FragCoord and
+// its depth and only loops over that froxel's lights.
+// GPU layout: binding 0 = lights, binding 1 = per-froxel (offset, count), binding 2 = light indices.
+class ClusterGrid {
+    public:
+        static constexpr int GRID_X = 16;
+        static constexpr int GRID_Y = 9;
+        static constexpr int GRID_Z = 24;
+        static constexpr int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+        struct Stats {
+            int lights = 0;             // lights that overlap the frustum
+            int indices = 0;            // total light references in the froxel lists
+            int maxPerCluster = 0;
+            int occupiedClusters = 0;
+            float buildMs = 0.0f;       // CPU time spent assigning lights
+            int threads = 0;
+        };
+
+        ClusterGrid(){}
+        ~ClusterGrid(){}
+
+        // assign lights to froxels for a perspective camera looking down -z in view space
+        void build(const std::vector<ClusterLight>& lights, const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, JobSystem& jobs) {
+            auto start = std::chrono::high_resolution_clock::now();
+            zNear = nearPlane;
+            zFar = farPlane;
+            tanHalfY = std::tan(fovY * 0.5f);
+            tanHalfX = tanHalfY * aspect;
+            logFarOverNear = std::log(zFar / zNear);
+
+            // cull and bound every light once; the froxel tests below only look at these
+            culled.clear();
+            for (size_t i = 0; i < lights.size(); i++) {
+                const ClusterLight& light = lights[i];
+                glm::vec3 p = glm::vec3(view * glm::vec4(light.position, 1.0f));
+                float depth = -p.z;
+                float r = light.radius;
+                if (depth + r < zNear || depth - r > zFar) continue;
+                Bounds b;
+                b.index = (uint32_t)i;
+                b.center = p;
+                b.radius = r;
+                b.sliceMin = sliceFor(std::max(depth - r, zNear));
+                b.sliceMax = sliceFor(std::min(depth + r, zFar));
+                if (!tileRange(p, r, b)) continue;
+                culled.push_back(b);
+            }
+
+            // slices are independent, so jobs each take a contiguous run of them
+            int threadCount = std::clamp(jobs.threadCount(), 1, MAX_THREADS);
+            if (culled.size() < 64) threadCount = 1;
+            std::vector<Partial> partials(threadCount);
+            auto work = [&](int t) {
+                int s0 = GRID_Z * t / threadCount;
+                int s1 = GRID_Z * (t + 1) / threadCount;
+                assignSlices(s0, s1, partials[t]);
+            };
+            jobs.parallelFor(0, threadCount, 1, [&](size_t first, size_t last) { for (size_t t = first; t < last; t++) work((int)t); });
+
+            // stitch the per-thread lists together; clusters are slice-major so the order holds
+            records.assign(CLUSTER_COUNT * 2, 0);
+            indices.clear();
+            stats = Stats{};
+            for (int t = 0; t < threadCount; t++) {
+                const Partial& part = partials[t];
+                int s0 = GRID_Z * t / threadCount;
+                int first = s0 * GRID_X * GRID_Y;
+                for (size_t c = 0; c < part.counts.size(); c++) {
+                    uint32_t count = part.counts[c];
+                    records[(first + c) * 2 + 0] = (uint32_t)indices.size() + part.offsets[c];
+                    records[(first + c) * 2 + 1] = count;
+                    stats.maxPerCluster = std::max(stats.maxPerCluster, (int)count);
+                    if (count) stats.occupiedClusters++;
+                }
+                indices.insert(indices.end(), part.indices.begin(), part.indices.end());
+            }
+            stats.lights = (int)culled.size();
+            stats.indices = (int)indices.size();
+            stats.threads = threadCount;
+            stats.buildMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        // write the lights and the last build into this frame's stream region and bind the three ranges
+        void upload(const std::vector<ClusterLight>& lights, StreamBuffer& stream) {
+            StreamBuffer::Allocation ranges[3] = { stream.upload(lights), stream.upload(records), stream.upload(indices) };
+            for (int i = 0; i < 3; i++) { glBindBufferRange(GL_SHADER_STORAGE_BUFFER, i, ranges[i].buffer, ranges[i].offset, ranges[i].size); }
+        }
+
+        // the slice straight from window depth (gl_FragCoord.z or the depth buffer), the same one
+        // sliceFor() gives the view depth: slice = floor(log(x - y * depth) * z + w). the camera's
+        // projection is zero-to-one (GLM_FORCE_DEPTH_ZERO_TO_ONE) under GL's default clip control,
+        // so NDC depth is 2 * depth - 1 and view depth is n*f / (f - ndc * (f - n)), which is
+        // n*f / (x - y * depth); log(n*f) is folded into w
+        glm::vec4 getDepthSlicing() const {
+            const float scale = GRID_Z / logFarOverNear;
+            const float bias = -GRID_Z * std::log(zNear) / logFarOverNear;
+            return glm::vec4(2.0f * zFar - zNear, 2.0f * (zFar - zNear), -scale, bias + scale * std::log(zNear * zFar));
+        }
+        const Stats& getStats() const { return stats; }
+
+    private:
+        static constexpr int MAX_THREADS = 8;
+
+        struct Bounds {
+            uint32_t index;
+            glm::vec3 center;   // view space
+            float radius;
+            int sliceMin, sliceMax;
+            int tileMinX, tileMaxX, tileMinY, tileMaxY;
+        };
+
+        struct Partial {
+            std::vector<uint32_t> counts;
+            std::vector<uint32_t> offsets;     // into this partial's indices
+            std::vector<uint32_t> indices;
+        };
+
+        float zNear = 0.1f, zFar = 100.0f;
+        float tanHalfX = 1.0f, tanHalfY = 1.0f;
+        float logFarOverNear = 1.0f;
+
+        std::vector<Bounds> culled;
+        std::vector<uint32_t> records;
+        std::vector<uint32_t> indices;
+        Stats stats;
+
+        int sliceFor(float depth) const {
+            int slice = (int)std::floor(std::log(depth / zNear) / logFarOverNear * GRID_Z);
+            return std::clamp(slice, 0, GRID_Z - 1);
+        }
+
+        float sliceDepth(int slice) const {
+            return zNear * std::pow(zFar / zNear, (float)slice / GRID_Z);
+        }
+
+        // conservative screen tile range of the sphere's view-space box: x/z is smallest at the
+        // near side of the box for negative x and at the far side for positive x (same for y)
+        bool tileRange(const glm::vec3& p, float r, Bounds& b) const {
+            float zMin = std::max(-p.z - r, zNear);
+            float zMax = std::max(-p.z + r, zNear);
+            auto ndcMin = [&](float v, float tanHalf) { return (v < 0.0f ? v / zMin : v / zMax) / tanHalf; };
+            auto ndcMax = [&](float v, float tanHalf) { return (v > 0.0f ? v / zMin : v / zMax) / tanHalf; };
+            float x0 = ndcMin(p.x - r, tanHalfX), x1 = ndcMax(p.x + r, tanHalfX);
+            float y0 = ndcMin(p.y - r, tanHalfY), y1 = ndcMax(p.y + r, tanHalfY);
+            if (x0 > 1.0f || x1 < -1.0f || y0 > 1.0f || y1 < -1.0f) return false;
+            auto tile = [](float ndc, int count) { return std::clamp((int)std::floor((ndc * 0.5f + 0.5f) * count), 0, count - 1); };
+            b.tileMinX = tile(x0, GRID_X); b.tileMaxX = tile(x1, GRID_X);
+            b.tileMinY = tile(y0, GRID_Y); b.tileMaxY = tile(y1, GRID_Y);
+            return true;
+        }
+
+        void assignSlices(int s0, int s1, Partial& out) const {
+            const int perSlice = GRID_X * GRID_Y;
+            std::vector<std::vector<uint32_t>> lists((s1 - s0) * perSlice);
+            for (const Bounds& b : culled) {
+                if (b.sliceMax < s0 || b.sliceMin >= s1) continue;
+                int k0 = std::max(b.sliceMin, s0), k1 = std::min(b.sliceMax, s1 - 1);
+                for (int k = k0; k <= k1; k++) {
+                    float zn = sliceDepth(k), zf = sliceDepth(k + 1);
+                    for (int y = b.tileMinY; y <= b.tileMaxY; y++) {
+                        for (int x = b.tileMinX; x <= b.tileMaxX; x++) {
+                            if (!sphereTouchesFroxel(b.center, b.radius, x, y, zn, zf)) continue;
+                            lists[(k - s0) * perSlice + y * GRID_X + x].push_back(b.index);
+                        }
+                    }
+                }
+            }
+            out.counts.resize(lists.size());
+            out.offsets.resize(lists.size());
+            for (size_t c = 0; c < lists.size(); c++) {
+                out.offsets[c] = (uint32_t)out.indices.size();
+                out.counts[c] = (uint32_t)lists[c].size();
+                out.indices.insert(out.indices.end(), lists[c].begin(), lists[c].end());
+            }
+        }
+
+        // sphere against the view-space AABB of the froxel
+        bool sphereTouchesFroxel(const glm::vec3& c, float r, int x, int y, float zn, float zf) const {
+            float nx0 = -1.0f + 2.0f * x / GRID_X, nx1 = -1.0f + 2.0f * (x + 1) / GRID_X;
+            float ny0 = -1.0f + 2.0f * y / GRID_Y, ny1 = -1.0f + 2.0f * (y + 1) / GRID_Y;
+            glm::vec3 lo(std::min(nx0 * tanHalfX * zn, nx0 * tanHalfX * zf), std::min(ny0 * tanHalfY * zn, ny0 * tanHalfY * zf), -zf);
+            glm::vec3 hi(std::max(nx1 * tanHalfX * zn, nx1 * tanHalfX * zf), std::max(ny1 * tanHalfY * zn, ny1 * tanHalfY * zf), -zn);
+            glm::vec3 closest = glm::clamp(c, lo, hi);
+            glm::vec3 d = c - closest;
+            return glm::dot(d, d) <= r * r;
+        }
+};
@@ -20,7 +20,15 @@ class Controller {
         Controller(){}
         ~Controller(){}
 
-        void processInput(GLFWwindow *window, float deltaTime, Camera *camera) {
+        // the movement keys held this frame; applied separately so a fixed-rate simulation can
+        // step it as often as it needs
+        struct Input {
+            bool forward = false, backward = false, left = false, right = false, up = false, down = false;
+            bool fast = false;
+        };
+
+        // reads the keyboard (GLFW wants the main thread for this) and handles the cursor toggle
+        Input pollInput(GLFWwindow *window) {
             if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS && !cursorDisabled && !justPressed) {
                 glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
                 justPressed = true;
@@ -34,13 +42,27 @@ class Controller {
             }
             if(glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) fast = true;
             if(glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE) fast = false;
-            if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && lockMovement) camera->ProcessKeyboard(FORWARD, deltaTime, fast);
-            if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && lockMovement) camera->ProcessKeyboard(BACKWARD, deltaTime, fast);
-            if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && lockMovement) camera->ProcessKeyboard(LEFT, deltaTime, fast);
-            if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && lockMovement) camera->ProcessKeyboard(RIGHT, deltaTime, fast);
-            if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && lockMovement) camera->ProcessKeyboard(UP, deltaTime, fast);
-            if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS && lockMovement) camera->ProcessKeyboard(DOWN, deltaTime, fast);
+            Input input;
+            input.fast = fast;
+            if (lockMovement) {
+                input.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+                input.backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+                input.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+                input.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+                input.up = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+                input.down = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+            }
             if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_RELEASE) justPressed = false;
+            return input;
+        }
+
+        static void applyMovement(const Input& input, float deltaTime, Camera *camera) {
+            if (input.forward) camera->ProcessKeyboard(FORWARD, deltaTime, input.fast);
+            if (input.backward) camera->ProcessKeyboard(BACKWARD, deltaTime, input.fast);
+            if (input.left) camera->ProcessKeyboard(LEFT, deltaTime, input.fast);
+            if (input.right) camera->ProcessKeyboard(RIGHT, deltaTime, input.fast);
+            if (input.up) camera->ProcessKeyboard(UP, deltaTime, input.fast);
+            if (input.down) camera->ProcessKeyboard(DOWN, deltaTime, input.fast);
         }
 
         bool isCursorDisabled() { return cursorDisabled; }
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Picks the scale the scene is rendered at so the GPU frame time stays within a budget. The
+// frame is bracketed by two GL_TIMESTAMP queries (a ring of them, read back once available like
+// GpuTimer, which can't be used here since its GL_TIME_ELAPSED queries would nest with the
+// per-pass timers). The cost of a frame is roughly proportional to its pixel count, so the
+// controller aims for scale * sqrt(budget / time), moves towards it a limited step per frame,
+// ignores differences within a deadband and waits for the measurements of a new scale to come in
+// before reacting again. Every change resizes the scene targets (and resamples the TAA history),
+// so the scale settles rather than chasing every frame.
+class DynamicResolution {
+    public:
+        static constexpr int RING_SIZE = 4;
+        static constexpr float MIN_SCALE = 0.25f;       // lowest any setting can go
+        static constexpr float MAX_STEP = 0.05f;        // largest change per adjustment
+        static constexpr float DEADBAND = 0.02f;        // smaller corrections are ignored
+        static constexpr int SETTLE_FRAMES = RING_SIZE + 2;
+
+        // what the UI can change, handed over whole every frame
+        struct Settings {
+            bool enabled = true;
+            float targetMs = 16.6f;
+            float minScale = 0.5f;
+            float maxScale = 1.0f;
+            bool manualOverride = false;
+            float manualScale = 1.0f;
+            float sharpness = 0.25f;    // of the sharpening after the upscale, 0 is the strongest
+        };
+
+        Settings settings;
+
+        DynamicResolution(){}
+        ~DynamicResolution(){}
+
+        void destroy() {
+            for (auto& pair : queries) { if (pair[0]) glDeleteQueries(2, pair.data()); pair = {0, 0}; }
+            pending.fill(false);
+            active = false;
+        }
+
+        // read back finished frames and decide this frame's scale
+        float update() {
+            collect();
+            float desired = scale;
+            if (!settings.enabled) { desired = 1.0f; }
+            else if (settings.manualOverride) { desired = std::clamp(settings.manualScale, MIN_SCALE, 1.0f); }
+            else {
+                if (hasValue && framesSinceChange >= SETTLE_FRAMES && gpuMs > 0.0f) {
+                    float ideal = scale * std::sqrt(settings.targetMs / gpuMs);
+                    if (std::abs(ideal - scale) > DEADBAND) { desired = scale + std::clamp(ideal - scale, -MAX_STEP, MAX_STEP); }
+                }
+                desired = std::clamp(desired, settings.minScale, std::max(settings.minScale, settings.maxScale));
+            }
+            framesSinceChange++;
+            if (desired != scale) {
+                scale = desired;
+                framesSinceChange = 0;
+                hasValue = false;       // the old measurements were taken at another scale
+            }
+            return scale;
+        }
+
+        // bracket the frame's GPU work
+        void beginFrame() {
+            if (!queries[0][0]) { for (auto& pair : queries) glGenQueries(2, pair.data()); }
+            collect();
+            if (pending[head]) return;
+            glQueryCounter(queries[head][0], GL_TIMESTAMP);
+            active = true;
+        }
+
+        void endFrame() {
+            if (!active) return;
+            glQueryCounter(queries[head][1], GL_TIMESTAMP);
+            pending[head] = true;
+            head = (head + 1) % RING_SIZE;
+            active = false;
+        }
+
+        // size to render a display of the given size at
+        void renderSize(int displayWidth, int displayHeight, int& width, int& height) const {
+            width = std::max(1, (int)std::lround(displayWidth * scale));
+            height = std::max(1, (int)std::lround(displayHeight * scale));
+        }
+
+        float getScale() const { return scale; }
+        float getGpuMilliseconds() const { return gpuMs; }
+        bool hasMeasurement() const { return hasValue; }
+
+    private:
+        static constexpr float SMOOTHING = 0.2f;
+
+        std::array<std::array<unsigned int, 2>, RING_SIZE> queries{};
+        std::array<bool, RING_SIZE> pending{};
+        int head = 0;
+        bool active = false;
+        bool hasValue = false;
+        float gpuMs = 0.0f;
+        float scale = 1.0f;
+        int framesSinceChange = 0;
+
+        void collect() {
+            for (int i = 0; i < RING_SIZE; i++) {
+                if (!pending[i]) continue;
+                GLuint available = 0;
+                glGetQueryObjectuiv(queries[i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) continue;
+                GLuint64 start = 0, end = 0;
+                glGetQueryObjectui64v(queries[i][0], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(queries[i][1], GL_QUERY_RESULT, &end);
+                pending[i] = false;
+                float ms = (float)((double)(end - start) / 1.0e6);
+                gpuMs = hasValue ? gpuMs + (ms - gpuMs) * SMOOTHING : ms;
+                hasValue = true;
+            }
+        }
+};
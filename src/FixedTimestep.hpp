@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+
+// Accumulator for a fixed-rate simulation. Every frame adds its real duration and gets back how
+// many whole steps are due; what is left over, as a fraction of a step, is how far the renderer
+// should interpolate from the previous step's state towards the newest. A frame that comes back
+// after a long stall would otherwise have to simulate all the time it missed (and take longer
+// still, and fall further behind), so no more than maxStepsPerFrame are run and the rest of the
+// backlog is dropped: the world slows down instead of spiralling.
+class FixedTimestep {
+    public:
+        static constexpr double MAX_FRAME_SECONDS = 0.25;   // longer frames count as this long
+
+        float stepHz = 60.0f;
+        int maxStepsPerFrame = 8;
+
+        struct Stats {
+            int steps = 0;                  // last frame
+            long long totalSteps = 0;
+            long long droppedSteps = 0;     // skipped by the catch-up limit
+        };
+
+        FixedTimestep(){}
+        ~FixedTimestep(){}
+
+        // add a frame's duration, returns how many steps to run now
+        int advance(double frameSeconds) {
+            const double step = stepSeconds();
+            accumulator += std::clamp(frameSeconds, 0.0, MAX_FRAME_SECONDS);
+            int steps = (int)(accumulator / step);
+            const int limit = std::max(maxStepsPerFrame, 1);
+            if (steps > limit) {
+                stats.droppedSteps += steps - limit;
+                accumulator -= (steps - limit) * step;
+                steps = limit;
+            }
+            accumulator -= steps * step;
+            stats.steps = steps;
+            stats.totalSteps += steps;
+            return steps;
+        }
+
+        float stepSeconds() const { return 1.0f / std::max(stepHz, 1.0f); }
+
+        // between the previous step (0) and the newest (1)
+        float alpha() const { return std::clamp((float)(accumulator / stepSeconds()), 0.0f, 1.0f); }
+
+        const Stats& getStats() const { return stats; }
+
+    private:
+        double accumulator = 0.0;
+        Stats stats;
+};
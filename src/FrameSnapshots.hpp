@@ -0,0 +1,258 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <imGui/imgui.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Camera.hpp"
+#include "CascadedShadowMaps.hpp"
+#include "ClusteredLighting.hpp"
+#include "GpuTimer.hpp"
+#include "JobSystem.hpp"
+#include "Object.hpp"
+#include "ObjectPicker.hpp"
+#include "OcclusionCulling.hpp"
+#include "OcclusionQueries.hpp"
+#include "PointShadowMaps.hpp"
+#include "PostProcessStack.hpp"
+#include "RenderGraph.hpp"
+#include "RenderSettings.hpp"
+#include "StreamBuffer.hpp"
+#include "VisibilityBuffer.hpp"
+
+// The hand-off between the main thread (input, UI) and the render thread, which owns the GL
+// context. There are two snapshots: the main thread fills the back one while the render thread
+// draws from the front one, and publish() swaps them. The main thread only waits in
+// waitForRenderer() until the render thread has picked up what was published last, so the UI of
+// frame N+1 is built while frame N is drawn and the render thread is never more than one frame
+// behind. Whatever the render thread needs that the UI can edit goes into the snapshot by value:
+// the settings, the camera, every object's transform and flags, the lights, the selection and the
+// pick requests, so a frame sees one consistent set however often it looks. Objects the UI deletes
+// ride along too and are freed by the render thread, which is done with the previous frame by then.
+// What comes back (the scene texture, pick results, the stats and lists the debug UI shows) is
+// copied into Results; the UI never reads the render thread's objects.
+// The UI's draw lists are rebuilt by every ImGui::NewFrame, so the snapshot keeps a deep copy.
+class FrameSnapshots {
+    public:
+        struct Pick {
+            ObjectPicker::Request kind;
+            int x, y, width, height;    // region in framebuffer pixels
+        };
+
+        struct Snapshot {
+            RenderSettings settings;
+            Camera camera;
+            glm::vec3 lightPos = glm::vec3(0.0f);
+            int displayWidth = 1, displayHeight = 1;    // the Scene window, in pixels
+            unsigned int sceneTexture = 0;              // what the UI's scene image was given
+            ImDrawData drawData;                        // owns its draw lists
+
+            std::vector<RenderObject> objects;
+            std::vector<const RenderObject*> lights;    // the uniform point lights, into objects
+            std::vector<std::unique_ptr<Object>> retired;   // deleted since the last snapshot
+            std::vector<Pick> picks;
+            unsigned int hoveredID = 0;
+            std::vector<unsigned int> selectedIDs;
+
+            // one-off requests from the UI's buttons
+            struct Requests {
+                bool resetTemporalHistory = false;
+                bool startShadowBenchmark = false;
+            } requests;
+        };
+
+        // what the render thread hands back for the next UI frame
+        struct Results {
+            unsigned int viewportTexture = 0;
+            glm::vec2 viewportUV = glm::vec2(1.0f);
+            int fbWidth = 1, fbHeight = 1;
+            std::vector<ObjectPicker::Result> picks;    // read back since the results were last taken
+
+            // copies of what the debug UI lists, the render thread rebuilds the originals every frame
+            RenderGraph::Stats graphStats;
+            std::vector<std::pair<std::string, bool>> passList;
+            std::vector<PostProcessStack::Timing> postTimings;
+            struct ShadowFaces {
+                int light;
+                int size;
+                std::array<int, 6> ages;
+            };
+            std::vector<ShadowFaces> shadowFaces;
+
+            // the render thread's counters as of the end of the frame
+            JobSystem::Stats jobs;
+            float packetWaitMs = 0.0f;
+            float packetBuildMs = 0.0f;
+            int staticCasters = 0, dynamicCasters = 0, drawOrder = 0;
+            int trackedStaticCasters = 0;
+            size_t shadowTriangles = 0, shadowTrianglesUnculled = 0;
+            CascadedShadowMaps::Stats cascadeStats;
+            std::array<CascadedShadowMaps::Cascade, CascadedShadowMaps::MAX_CASCADES> cascades{};
+            float cascadeMemoryMB = 0.0f;
+            PointShadowMaps::Stats pointShadowStats;
+            struct ShadowBenchmark {
+                int method = -1;            // being measured, -1 when idle
+                int faces = 0;              // per frame while measuring, 0 before the first run
+                float ms[POINT_SHADOW_METHODS] = {};
+            } shadowBenchmark;
+            ClusterGrid::Stats clusterStats;
+            VisibilityBuffer::Stats visibilityStats;
+            OcclusionCuller::Stats occlusionStats;
+            OcclusionQueries::Stats queryStats;
+            int objectsDrawn = 0;
+            bool prePassActive = false;
+            bool overdrawMeasured = false;
+            float overdraw = 0.0f;
+            int taaWidth = 0, taaHeight = 0, taaResamples = 0;
+            int postVariants = 0;
+            float resolutionScale = 1.0f;
+            bool gpuFrameMeasured = false;
+            float gpuFrameMs = 0.0f;
+            StreamBuffer::Stats streamStats;
+            unsigned int pickLatency = 0;
+            struct GpuTimes {
+                GpuTimer::Reading prePass, mainPass[2];     // main pass indexed by whether the pre-pass ran
+                GpuTimer::Reading gBuffer, visibility, materialResolve, deferredLighting, deferredForward;
+                GpuTimer::Reading fxaa, smaa[3], taa[3], upscale[2];
+                GpuTimer::Reading shadowMoments, pointShadows[POINT_SHADOW_METHODS];
+            } gpu;
+        };
+
+        struct Stats {
+            float mainWaitMs = 0.0f;        // main thread waiting for the render thread
+            float renderWaitMs = 0.0f;      // render thread waiting for a snapshot
+            float renderFrameMs = 0.0f;     // render thread, snapshot to swap
+        };
+
+        FrameSnapshots(){}
+        ~FrameSnapshots() {
+            for (Snapshot& snapshot : snapshots) { releaseDrawData(snapshot.drawData); }
+        }
+
+        FrameSnapshots(const FrameSnapshots&) = delete;
+        FrameSnapshots& operator=(const FrameSnapshots&) = delete;
+
+        // MARK: main thread
+        Snapshot& back() { return snapshots[backIndex]; }
+
+        // blocks until the render thread has picked up everything published so far; the back
+        // snapshot is free again then, the render thread may still be drawing the front one
+        void waitForRenderer() {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [this]() { return !pending; });
+            if (resultsReady) {
+                current = std::move(lastResults);
+                lastResults.picks.clear();
+                resultsReady = false;
+            } else {
+                current.picks.clear();
+            }
+            stats.mainWaitMs = elapsedMs(start);
+        }
+
+        // the newest finished frame's, as of the last waitForRenderer()
+        const Results& results() const { return current; }
+
+        Stats getStats() {
+            std::lock_guard<std::mutex> guard(lock);
+            return stats;
+        }
+
+        // deep copy of the UI's draw data into the back snapshot, the old copy is released
+        void captureDrawData(const ImDrawData* source) {
+            ImDrawData& target = back().drawData;
+            releaseDrawData(target);
+            if (!source) return;
+            target = *source;
+            target.CmdLists.clear();
+            for (ImDrawList* list : source->CmdLists) { target.CmdLists.push_back(list->CloneOutput()); }
+            target.CmdListsCount = target.CmdLists.Size;
+        }
+
+        // the back snapshot becomes the render thread's next frame
+        void publish() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                frontIndex = backIndex;
+                backIndex ^= 1;
+                pending = true;
+            }
+            changed.notify_all();
+        }
+
+        // wakes the render thread for good; anything still published is drawn first
+        void stop() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            changed.notify_all();
+        }
+
+        // MARK: render thread
+        // the next frame, null once stopped
+        Snapshot* acquire() {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [this]() { return pending || stopping; });
+            if (!pending) return nullptr;
+            pending = false;
+            stats.renderWaitMs = elapsedMs(start);
+            frameStart = std::chrono::high_resolution_clock::now();
+            Snapshot* frame = &snapshots[frontIndex];
+            guard.unlock();
+            changed.notify_all();
+            return frame;
+        }
+
+        // the frame is submitted; pick results the main thread hasn't taken yet are kept
+        void finish(Results&& results) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (resultsReady) { results.picks.insert(results.picks.begin(), lastResults.picks.begin(), lastResults.picks.end()); }
+            lastResults = std::move(results);
+            resultsReady = true;
+            stats.renderFrameMs = elapsedMs(frameStart);
+        }
+
+        // the UI was built against an older frame's scene texture; the render graph may have
+        // reused that texture for something else by now, so the image is pointed at this frame's
+        static void retargetTexture(ImDrawData& drawData, unsigned int from, unsigned int to) {
+            for (ImDrawList* list : drawData.CmdLists) {
+                for (ImDrawCmd& cmd : list->CmdBuffer) {
+                    if (!cmd.TexRef._TexData && cmd.TexRef._TexID == (ImTextureID)from) { cmd.TexRef._TexID = (ImTextureID)to; }
+                }
+            }
+        }
+
+    private:
+        Snapshot snapshots[2];
+        int backIndex = 0;
+        int frontIndex = 1;
+        bool pending = false;       // published, not yet picked up
+        bool stopping = false;
+        Results lastResults;        // from the render thread, under the lock
+        bool resultsReady = false;  // lastResults not taken yet
+        Results current;            // the main thread's copy
+        Stats stats;
+        std::chrono::high_resolution_clock::time_point frameStart;
+        std::mutex lock;
+        std::condition_variable changed;
+
+        static void releaseDrawData(ImDrawData& drawData) {
+            for (ImDrawList* list : drawData.CmdLists) { IM_DELETE(list); }
+            drawData.Clear();
+        }
+
+        static float elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+            return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+};
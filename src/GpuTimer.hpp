@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+
+// Wraps a small ring of GPU queries (GL_TIME_ELAPSED unless told otherwise) so results can be
+// read without stalling: a slot is only read back once GL_QUERY_RESULT_AVAILABLE says so,
+// usually a frame or two later. If every slot is still in flight the measurement is skipped.
+// Queries of the same target can't nest, so only time passes that run one after the other.
+class GpuTimer {
+    public:
+        static const int RING_SIZE = 4;
+
+        // a copy of the current result, for readers on another thread than the one timing
+        struct Reading {
+            bool measured = false;
+            float ms = 0.0f;
+        };
+
+        GpuTimer(GLenum target = GL_TIME_ELAPSED) : target(target) {}
+        ~GpuTimer(){}
+
+        void begin() {
+            if (!queries[0]) { glGenQueries(RING_SIZE, queries.data()); }
+            collect();
+            if (pending[head]) { return; }
+            glBeginQuery(target, queries[head]);
+            active = true;
+        }
+
+        void end() {
+            if (!active) return;
+            glEndQuery(target);
+            pending[head] = true;
+            head = (head + 1) % RING_SIZE;
+            active = false;
+        }
+
+        // read back whatever has finished; called by begin() but can be called on its own
+        void collect() {
+            for (int i = 0; i < RING_SIZE; i++) {
+                if (!pending[i]) continue;
+                GLuint available = 0;
+                glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) continue;
+                GLuint64 value = 0;
+                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &value);
+                pending[i] = false;
+                last = (double)value;
+                average = hasValue ? average + (last - average) * SMOOTHING : last;
+                hasValue = true;
+            }
+        }
+
+        void destroy() {
+            if (queries[0]) { glDeleteQueries(RING_SIZE, queries.data()); }
+            queries.fill(0);
+            pending.fill(false);
+            active = false;
+        }
+
+        // forget the history, e.g. when what's being measured changes; results still in flight
+        // belong to the old measurement and are dropped too (their queries are simply reused)
+        void reset() {
+            pending.fill(false);
+            hasValue = false;
+            last = average = 0.0;
+        }
+
+        bool hasResult() const { return hasValue; }
+        double getLast() const { return last; }
+        double getAverage() const { return average; }
+        // only meaningful for GL_TIME_ELAPSED
+        float getMilliseconds() const { return (float)(average / 1.0e6); }
+        Reading getReading() const { return {hasValue, getMilliseconds()}; }
+
+    private:
+        static constexpr double SMOOTHING = 0.1;
+
+        GLenum target;
+        std::array<unsigned int, RING_SIZE> queries{};
+        std::array<bool, RING_SIZE> pending{};
+        int head = 0;
+        bool active = false;
+        bool hasValue = false;
+        double last = 0.0;
+        double average = 0.0;
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job scheduler. Every thread owns a deque: it pushes and pops its own jobs at the
+// back (newest first, still warm in cache) while idle threads steal from the front of the others'
+// (oldest first, usually the biggest pieces of work). The thread that creates the system is the
+// main thread and owns deque 0; workers sleep on a condition variable when there is nothing to
+// steal. Jobs report to a Counter that can be waited on, and jobs can be started once another
+// counter reaches zero, which is how dependencies are expressed. A thread waiting on a counter
+// runs jobs itself instead of blocking, so nested waits can't deadlock and the main thread
+// contributes too. GL calls are only allowed on the main thread: runOnMainThread queues them and
+// the main thread runs them in drainMainThread() or whenever it waits. "Main thread" means the one
+// holding the GL context; a render thread the context is handed to takes the role over with
+// adoptMainThread() and gets a deque of its own (the last one), so its jobs and the creating
+// thread's stay apart.
+class JobSystem {
+    public:
+        using Job = std::function<void()>;
+
+        // pending work; waiting on it returns once everything added to it has finished
+        class Counter {
+            public:
+                bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+            private:
+                friend class JobSystem;
+                std::atomic<int> pending{0};
+                std::mutex lock;
+                std::vector<std::pair<Job, Counter*>> continuations;   // started when pending hits zero
+        };
+
+        struct Stats {
+            int jobs = 0;           // run on any thread
+            int stolen = 0;         // of those, taken from another thread's deque
+            int mainThreadJobs = 0; // run from the main-thread queue
+        };
+
+        struct ScalingResult {
+            int threads;
+            float tinyJobsMs;       // many near-empty jobs: scheduling overhead
+            float parallelForMs;    // a compute-bound loop: throughput
+            float speedup;          // of the loop, against one thread
+        };
+
+        // workerCount < 0 picks one worker per remaining hardware thread
+        explicit JobSystem(int workerCount = -1) {
+            if (workerCount < 0) { workerCount = (int)std::max(std::thread::hardware_concurrency(), 1u) - 1; }
+            queues.resize(workerCount + 2);    // creating thread, workers, adopting thread
+            for (auto& queue : queues) { queue = std::make_unique<Queue>(); }
+            // a system created while another is current (the benchmark's) hands it back when done
+            previous = current;
+            previousIndex = currentIndex;
+            current = this;
+            currentIndex = 0;
+            mainThread = std::this_thread::get_id();
+            for (int i = 1; i <= workerCount; i++) { workers.emplace_back(&JobSystem::workerLoop, this, i); }
+        }
+
+        ~JobSystem() {
+            {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers) { worker.join(); }
+            if (current == this) {
+                current = previous;
+                currentIndex = previousIndex;
+            }
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        int threadCount() const { return (int)workers.size() + 1; }
+
+        // the calling thread becomes the main thread: it runs the main-thread queue from now on and
+        // pushes to the adopting thread's deque
+        void adoptMainThread() {
+            current = this;
+            currentIndex = (int)queues.size() - 1;
+            mainThread = std::this_thread::get_id();
+        }
+
+        // queue a job on the calling thread's deque
+        void run(Job job, Counter* counter = nullptr) {
+            if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+            push(Task{std::move(job), counter});
+        }
+
+        // queue a job once dependency has no work left
+        void runAfter(Counter& dependency, Job job, Counter* counter = nullptr) {
+            if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> guard(dependency.lock);
+                if (!dependency.done()) {
+                    dependency.continuations.emplace_back(std::move(job), counter);
+                    return;
+                }
+            }
+            push(Task{std::move(job), counter});
+        }
+
+        // queue a job that must run on the main thread (anything touching GL)
+        void runOnMainThread(Job job, Counter* counter = nullptr) {
+            if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> guard(mainLock);
+            mainQueue.push_back(Task{std::move(job), counter});
+        }
+
+        // main thread only: run what other threads queued for it
+        void drainMainThread() {
+            std::vector<Task> tasks;
+            {
+                std::lock_guard<std::mutex> guard(mainLock);
+                tasks.swap(mainQueue);
+            }
+            for (Task& task : tasks) {
+                mainThreadJobs.fetch_add(1, std::memory_order_relaxed);
+                execute(task);
+            }
+        }
+
+        // run jobs until counter is done
+        void wait(Counter& counter) {
+            const bool onMain = std::this_thread::get_id() == mainThread;
+            while (!counter.done()) {
+                if (onMain) drainMainThread();
+                Task task;
+                if (tryTake(task)) { execute(task); }
+                else { std::this_thread::yield(); }
+            }
+            // the thread that finished the last job may still hold the lock
+            std::lock_guard<std::mutex> guard(counter.lock);
+        }
+
+        // body(first, last) over [begin, end) in chunks of grain; 0 picks a few chunks per thread
+        template <typename Body>
+        void parallelFor(size_t begin, size_t end, size_t grain, Body&& body) {
+            if (end <= begin) return;
+            const size_t count = end - begin;
+            if (grain == 0) { grain = std::max<size_t>(1, count / (threadCount() * 4)); }
+            if (count <= grain) {
+                body(begin, end);
+                return;
+            }
+            Counter counter;
+            // the first chunk is kept for the calling thread
+            for (size_t first = begin + grain; first < end; first += grain) {
+                size_t last = std::min(end, first + grain);
+                run([&body, first, last]() { body(first, last); }, &counter);
+            }
+            body(begin, std::min(end, begin + grain));
+            wait(counter);
+        }
+
+        // counts since the last call
+        Stats takeStats() {
+            Stats s;
+            s.jobs = jobsRun.exchange(0, std::memory_order_relaxed);
+            s.stolen = jobsStolen.exchange(0, std::memory_order_relaxed);
+            s.mainThreadJobs = mainThreadJobs.exchange(0, std::memory_order_relaxed);
+            return s;
+        }
+
+        // the same workloads with 1, 2, 4, ... threads up to maxThreads, each on a fresh system
+        static std::vector<ScalingResult> scalingBenchmark(int maxThreads) {
+            constexpr int TINY_JOBS = 20000;
+            constexpr size_t LOOP_SIZE = 1 << 22;
+            maxThreads = std::max(maxThreads, 1);
+            std::vector<ScalingResult> results;
+            std::vector<float> data(LOOP_SIZE);
+            for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+                JobSystem js(threads - 1);
+                ScalingResult r{threads, 0.0f, 0.0f, 1.0f};
+
+                auto start = std::chrono::high_resolution_clock::now();
+                Counter counter;
+                std::atomic<int> sum{0};
+                for (int i = 0; i < TINY_JOBS; i++) { js.run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, &counter); }
+                js.wait(counter);
+                r.tinyJobsMs = elapsedMs(start);
+
+                // best of a few runs, the first one also faults the pages in
+                r.parallelForMs = 1e9f;
+                for (int run = 0; run < 3; run++) {
+                    start = std::chrono::high_resolution_clock::now();
+                    js.parallelFor(0, LOOP_SIZE, 0, [&data](size_t first, size_t last) {
+                        for (size_t i = first; i < last; i++) { data[i] = std::sqrt((float)i) * std::sin((float)i * 0.001f); }
+                    });
+                    r.parallelForMs = std::min(r.parallelForMs, elapsedMs(start));
+                }
+                if (!results.empty()) { r.speedup = results.front().parallelForMs / std::max(r.parallelForMs, 1e-6f); }
+                results.push_back(r);
+                if (threads >= maxThreads) break;
+            }
+            return results;
+        }
+
+    private:
+        struct Task {
+            Job job;
+            Counter* counter = nullptr;
+        };
+
+        struct Queue {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;     // [0] the creating thread's, [last] the adopting thread's
+        std::vector<std::thread> workers;
+        JobSystem* previous = nullptr;
+        int previousIndex = 0;
+        std::atomic<std::thread::id> mainThread;
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        std::atomic<int> queued{0};
+        bool stopping = false;
+
+        std::mutex mainLock;
+        std::vector<Task> mainQueue;
+
+        std::atomic<int> jobsRun{0};
+        std::atomic<int> jobsStolen{0};
+        std::atomic<int> mainThreadJobs{0};
+
+        // which system and deque the calling thread belongs to
+        inline static thread_local JobSystem* current = nullptr;
+        inline static thread_local int currentIndex = 0;
+
+        static float elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+            return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        // threads outside the system hand their jobs to the main thread's deque
+        int ownQueue() const { return current == this ? currentIndex : 0; }
+
+        void push(Task task) {
+            Queue& queue = *queues[ownQueue()];
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                queue.tasks.push_back(std::move(task));
+            }
+            queued.fetch_add(1, std::memory_order_release);
+            if (!workers.empty()) {
+                // taking the lock orders this against a worker about to sleep
+                { std::lock_guard<std::mutex> guard(sleepLock); }
+                wake.notify_one();
+            }
+        }
+
+        // own deque from the back, then the others' from the front
+        bool tryTake(Task& task) {
+            if (queued.load(std::memory_order_acquire) == 0) return false;
+            const int own = ownQueue();
+            {
+                Queue& queue = *queues[own];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (!queue.tasks.empty()) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            const int count = (int)queues.size();
+            for (int offset = 1; offset < count; offset++) {
+                Queue& queue = *queues[(own + offset) % count];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (queue.tasks.empty()) continue;
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                jobsStolen.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        void execute(Task& task) {
+            task.job();
+            jobsRun.fetch_add(1, std::memory_order_relaxed);
+            if (task.counter) finish(*task.counter);
+        }
+
+        // the count drops under the counter's lock and the counter isn't touched after it is
+        // released, so a waiter that takes the lock once more before returning (see wait) may
+        // destroy it straight away, stack counters included
+        void finish(Counter& counter) {
+            std::vector<std::pair<Job, Counter*>> continuations;
+            {
+                std::lock_guard<std::mutex> guard(counter.lock);
+                if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                continuations.swap(counter.continuations);
+            }
+            for (auto& [job, next] : continuations) { push(Task{std::move(job), next}); }
+        }
+
+        void workerLoop(int index) {
+            current = this;
+            currentIndex = index;
+            while (true) {
+                Task task;
+                if (tryTake(task)) {
+                    execute(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> guard(sleepLock);
+                wake.wait(guard, [this]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+                if (stopping) return;
+            }
+        }
+};
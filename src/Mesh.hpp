@@ -40,19 +40,23 @@ class Mesh {
         vector<unsigned int> indices;
         vector<Texture>      textures;
         unsigned int VAO;
+        // depth and shadow passes only read positions, so they get their own tightly packed
+        // stream: 12 bytes a vertex instead of sizeof(Vertex)
+        unsigned int depthVAO;
 
-        // constructor
-        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
+        // constructor; an import running off the GL thread passes upload = false and calls
+        // setupMesh() on the GL thread later
+        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, bool upload = true) {
             this->vertices = vertices;
             this->indices = indices;
             this->textures = textures;
 
             // now that we have all the required data, set the vertex buffers and its attribute pointers.
-            setupMesh();
+            if (upload) setupMesh();
         }
 
         // render the mesh
-        void Draw(Shader &shader, glm::mat4 object) {
+        void Draw(Shader &shader, glm::mat4 object, int instances = 1) {
             shader.use();
             shader.setMat4("model", object);
             // bind appropriate textures
@@ -82,16 +86,23 @@ class Mesh {
             
             // draw mesh
             glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+            if (instances == 1) { glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0); }
+            else { glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0, instances); }
             glBindVertexArray(0);
 
             // always good practice to set everything back to defaults once configured.
             glActiveTexture(GL_TEXTURE0);
         }
 
-    private:
-        // render data 
-        unsigned int VBO, EBO;
+        // depth-only draw: no material textures
+        void DrawDepth(Shader &shader, glm::mat4 object, int instances = 1) {
+            shader.use();
+            shader.setMat4("model", object);
+            glBindVertexArray(depthVAO);
+            if (instances == 1) { glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0); }
+            else { glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0, instances); }
+            glBindVertexArray(0);
+        }
 
         // initializes all the buffer objects/arrays
         void setupMesh() {
@@ -132,5 +143,23 @@ class Mesh {
             glEnableVertexAttribArray(6);
             glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
             glBindVertexArray(0);
+
+            // the depth stream shares the index buffer; the attribute location matches the full VAO
+            vector<glm::vec3> positions(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) { positions[i] = vertices[i].Position; }
+            glGenVertexArrays(1, &depthVAO);
+            glGenBuffers(1, &depthVBO);
+            glBindVertexArray(depthVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, depthVBO);
+            glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+            glBindVertexArray(0);
         }
+
+    private:
+        // render data 
+        unsigned int VBO, EBO;
+        unsigned int depthVBO;
 };
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "JobSystem.hpp"
 #include "Mesh.hpp"
 
 #include <string>
@@ -17,12 +18,19 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <cfloat>
 
 class Shader;
 
 using namespace std;
 
-inline unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+// a texture file decoded to memory; the upload to GL is a separate step so the decoding can run on any thread
+struct DecodedImage {
+    unsigned char* data = nullptr;
+    int width = 0, height = 0, components = 0;
+};
+inline DecodedImage DecodeTextureFile(const char *path, const string &directory);
+inline unsigned int UploadTexture(DecodedImage& image, const char *path);
 
 class Model {
     public:
@@ -32,18 +40,55 @@ class Model {
         vector<Mesh>    meshes;
         string directory;
         bool gammaCorrection;
+        // model-space bounds of every vertex, empty (min > max) if nothing loaded
+        glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+        glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+        // geometry for the CPU occlusion culling, built at import: the positions of every mesh
+        // welded together (the import splits vertices by normal and uv) with degenerate triangles
+        // dropped. nothing is decimated, an occluder must not stick out of the surface it stands for
+        vector<glm::vec3> occluderPositions;
+        vector<unsigned int> occluderIndices;
+
+        // constructor, expects a filepath to a 3D model. given a job system the import (file, meshes,
+        // texture decoding) runs as a job and the GL uploads are queued for the main thread; loaded
+        // counts both, and the model must not move until it is done. the vertical flip is global in
+        // stb_image, so whoever queues imports sets it before the first one starts
+        Model(string const &path, bool gamma = false, JobSystem* jobs = nullptr, JobSystem::Counter* loaded = nullptr) : gammaCorrection(gamma) {
+            if (!jobs) {
+                stbi_set_flip_vertically_on_load(1);
+                loadModel(path);
+                upload();
+                return;
+            }
+            jobs->run([this, path, jobs, loaded]() {
+                loadModel(path);
+                jobs->runOnMainThread([this]() { upload(); }, loaded);
+            }, loaded);
+        }
 
-        // constructor, expects a filepath to a 3D model.
-        Model(string const &path, bool gamma = false) : gammaCorrection(gamma) { loadModel(path); }
+        size_t getTriangleCount() const {
+            size_t triangles = 0;
+            for (const Mesh& mesh : meshes) { triangles += mesh.indices.size() / 3; }
+            return triangles;
+        }
 
         // draws the model, and thus all its meshes
-        void Draw(Shader &shader, glm::mat4 object) {
+        void Draw(Shader &shader, glm::mat4 object, int instances = 1) {
             for(unsigned int i = 0; i < meshes.size(); i++) {
-                meshes[i].Draw(shader, object);
+                meshes[i].Draw(shader, object, instances);
+            }
+        }
+
+        // depth and shadow passes: position-only streams, no material setup
+        void DrawDepth(Shader &shader, glm::mat4 object, int instances = 1) {
+            for(unsigned int i = 0; i < meshes.size(); i++) {
+                meshes[i].DrawDepth(shader, object, instances);
             }
         }
         
     private:
+        vector<DecodedImage> decoded;   // per textures_loaded entry, until upload()
+
         // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
         void loadModel(string const &path) {
             // read file via ASSIMP
@@ -59,6 +104,43 @@ class Model {
 
             // process ASSIMP's root node recursively
             processNode(scene->mRootNode, scene);
+            buildOccluderMesh();
+        }
+
+        // the GL half of the import: the decoded textures, then every mesh's buffers
+        void upload() {
+            for (size_t i = 0; i < textures_loaded.size(); i++) { textures_loaded[i].id = UploadTexture(decoded[i], textures_loaded[i].path.c_str()); }
+            decoded.clear();
+            for (Mesh& mesh : meshes) {
+                for (Texture& texture : mesh.textures) {
+                    for (const Texture& loaded : textures_loaded) { if (loaded.path == texture.path) texture.id = loaded.id; }
+                }
+                mesh.setupMesh();
+            }
+        }
+
+        void buildOccluderMesh() {
+            auto less = [](const glm::vec3& a, const glm::vec3& b) {
+                if (a.x != b.x) return a.x < b.x;
+                if (a.y != b.y) return a.y < b.y;
+                return a.z < b.z;
+            };
+            map<glm::vec3, unsigned int, decltype(less)> welded(less);
+            occluderPositions.clear();
+            occluderIndices.clear();
+            for (const Mesh& mesh : meshes) {
+                vector<unsigned int> remap(mesh.vertices.size());
+                for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                    auto it = welded.emplace(mesh.vertices[i].Position, (unsigned int)occluderPositions.size());
+                    if (it.second) occluderPositions.push_back(mesh.vertices[i].Position);
+                    remap[i] = it.first->second;
+                }
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    unsigned int a = remap[mesh.indices[i]], b = remap[mesh.indices[i + 1]], c = remap[mesh.indices[i + 2]];
+                    if (a == b || b == c || a == c) continue;
+                    occluderIndices.insert(occluderIndices.end(), {a, b, c});
+                }
+            }
         }
 
         // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -92,6 +174,8 @@ class Model {
                 vector.y = mesh->mVertices[i].y;
                 vector.z = mesh->mVertices[i].z;
                 vertex.Position = vector;
+                boundsMin = glm::min(boundsMin, vector);
+                boundsMax = glm::max(boundsMax, vector);
                 // normals
                 if (mesh->HasNormals()) {
                     vector.x = mesh->mNormals[i].x;
@@ -153,7 +237,7 @@ class Model {
             textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
             
             // return a mesh object created from the extracted mesh data
-            return Mesh(vertices, indices, textures);
+            return Mesh(vertices, indices, textures, false);
         }
 
         // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -172,9 +256,10 @@ class Model {
                         break;
                     }
                 }
-                if(!skip) {   // if texture hasn't been loaded already, load it
+                if(!skip) {   // if texture hasn't been loaded already, load it; the GL texture is made in upload()
                     Texture texture;
-                    texture.id = TextureFromFile(str.C_Str(), this->directory);
+                    texture.id = 0;
+                    decoded.push_back(DecodeTextureFile(str.C_Str(), this->directory));
                     texture.type = typeName;
                     texture.path = str.C_Str();
                     textures.push_back(texture);
@@ -186,39 +271,42 @@ class Model {
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma) {
+DecodedImage DecodeTextureFile(const char *path, const string &directory) {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    DecodedImage image;
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+    return image;
+}
+
+// GL thread only; frees the decoded pixels
+unsigned int UploadTexture(DecodedImage& image, const char *path) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    stbi_set_flip_vertically_on_load(1);
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
+    if (image.data) {
         GLenum format;
-        if (nrComponents == 1)
+        if (image.components == 1)
             format = GL_RED;
-        else if (nrComponents == 3)
+        else if (image.components == 3)
             format = GL_RGB;
-        else if (nrComponents == 4)
+        else if (image.components == 4)
             format = GL_RGBA;
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     } else {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
     }
+    stbi_image_free(image.data);
+    image.data = nullptr;
 
     return textureID;
-}
\ No newline at end of file
+}
@@ -8,6 +8,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <random>
+#include <algorithm>
 
 class Shader;
 
@@ -24,7 +25,11 @@ private:
     Model model;
     Shader* shaderStored;
     bool isLight;
-    glm::vec3 lightColor;
+    glm::vec3 lightColor = glm::vec3(0.0f);
+    unsigned int id;
+    bool staticCaster = true;           // static casters are baked into the shadow caches
+    bool occluder = false;              // rasterized for the CPU occlusion culling
+    unsigned int transformVersion = 0;  // bumped on every transform change
 
     // Recalculate the model matrix whenever transformations change
     void updateModelMatrix() {
@@ -32,6 +37,7 @@ private:
         modelMatrix = glm::translate(modelMatrix, position);
         modelMatrix *= glm::mat4(rotation);
         modelMatrix = glm::scale(modelMatrix, scale);
+        transformVersion++;
     }
 
 public:
@@ -41,17 +47,23 @@ public:
         glm::vec3 objPos   = glm::vec3(0.0f),
         glm::vec3 objScale = glm::vec3(1.0f),
         glm::quat objRot   = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
-        bool is_light      = false)
+        bool is_light      = false,
+        JobSystem* jobs    = nullptr,   // imports the model as a job, see Model
+        JobSystem::Counter* loaded = nullptr)
         :
         position(objPos),
         rotation(objRot),
         scale(objScale),
         modelMatrix(glm::mat4(1.0f)),
         name(objName),
-        model(modelPath),
+        model(modelPath, false, jobs, loaded),
         shaderStored(shaderIn),
         isLight(is_light)
     {
+        // unique, never reused id written into the object-ID buffer (0 means "nothing")
+        static unsigned int nextID = 1;
+        id = nextID++;
+
         updateModelMatrix();
 
         if (isLight) {
@@ -84,10 +96,48 @@ public:
        model.Draw(shader, this->getModelMatrix());
     }
 
+    // for depth-only passes; only positions are fetched
+    void DrawDepth(Shader& shader, int instances = 1) {
+       model.DrawDepth(shader, this->getModelMatrix(), instances);
+    }
+
     void Draw() {
+        shaderStored->use();
+        shaderStored->setUInt("objectID", id);
         model.Draw(*shaderStored, this->getModelMatrix());
     }
 
+    unsigned int getID() const { return id; }
+
+    Shader* getShader() const { return shaderStored; }
+    Model& getModel() { return model; }
+    size_t getTriangleCount() const { return model.getTriangleCount(); }
+
+    bool isStatic() const { return staticCaster; }
+    void setStatic(bool value) { staticCaster = value; }
+    unsigned int getTransformVersion() const { return transformVersion; }
+
+    bool isOccluder() const { return occluder; }
+    void setOccluder(bool value) { occluder = value; }
+
+    // world-space sphere around the model's bounding box
+    void getBoundingSphere(glm::vec3& center, float& radius) const {
+        boundingSphere(model, modelMatrix, center, radius);
+    }
+
+    static void boundingSphere(const Model& model, const glm::mat4& modelMatrix, glm::vec3& center, float& radius) {
+        if (model.boundsMin.x > model.boundsMax.x) {
+            center = glm::vec3(modelMatrix[3]);
+            radius = 0.0f;
+            return;
+        }
+        glm::vec3 localCenter = (model.boundsMin + model.boundsMax) * 0.5f;
+        glm::vec3 halfExtent = (model.boundsMax - model.boundsMin) * 0.5f;
+        center = glm::vec3(modelMatrix * glm::vec4(localCenter, 1.0f));
+        float maxScale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        radius = glm::length(halfExtent) * maxScale;
+    }
+
     void setPosition(const glm::vec3& newPosition) {
         position = newPosition;
         updateModelMatrix();
@@ -117,6 +167,7 @@ public:
 
     void setModelMatrix(glm::mat4 matrix) {
         modelMatrix = matrix;
+        transformVersion++;
     }
 
     string getName() {
@@ -126,3 +177,63 @@ public:
     void setName(const std::string& s) { name = s; }
 };
 
+// what the render thread sees of an Object: its transform, flags and light colour as they were when
+// the frame was published, so the UI can go on editing the Object meanwhile. the model is shared,
+// its geometry doesn't change once loaded; the Object is kept alive until no frame refers to it
+class RenderObject {
+private:
+    Model* model;
+    Shader* shaderStored;
+    glm::mat4 modelMatrix;
+    glm::vec3 position;
+    glm::vec3 lightColor;
+    unsigned int id;
+    bool isLight;
+    bool staticCaster;
+    bool occluder;
+    unsigned int transformVersion;
+
+public:
+    RenderObject(Object& object) :
+        model(&object.getModel()),
+        shaderStored(object.getShader()),
+        modelMatrix(object.getModelMatrix()),
+        position(object.getPosition()),
+        lightColor(object.getLightColor()),
+        id(object.getID()),
+        isLight(object.is_light()),
+        staticCaster(object.isStatic()),
+        occluder(object.isOccluder()),
+        transformVersion(object.getTransformVersion())
+    {}
+
+    void Draw(Shader shader) const {
+        model->Draw(shader, modelMatrix);
+    }
+
+    void DrawDepth(Shader& shader, int instances = 1) const {
+        model->DrawDepth(shader, modelMatrix, instances);
+    }
+
+    void Draw() const {
+        shaderStored->use();
+        shaderStored->setUInt("objectID", id);
+        model->Draw(*shaderStored, modelMatrix);
+    }
+
+    unsigned int getID() const { return id; }
+    Shader* getShader() const { return shaderStored; }
+    Model& getModel() const { return *model; }
+    size_t getTriangleCount() const { return model->getTriangleCount(); }
+    bool is_light() const { return isLight; }
+    const glm::vec3& getLightColor() const { return lightColor; }
+    const glm::vec3& getPosition() const { return position; }
+    bool isStatic() const { return staticCaster; }
+    bool isOccluder() const { return occluder; }
+    unsigned int getTransformVersion() const { return transformVersion; }
+    const glm::mat4& getModelMatrix() const { return modelMatrix; }
+
+    void getBoundingSphere(glm::vec3& center, float& radius) const {
+        Object::boundingSphere(*model, modelMatrix, center, radius);
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Reads the object-ID attachment back to the CPU without stalling the pipeline.
+// Each read goes into its own pixel pack buffer guarded by a fence, and is only
+// mapped once the GPU has signalled it, usually one or two frames later.
+class ObjectPicker {
+    public:
+        enum class Request { Click, Hover, Rect };
+
+        struct Result {
+            Request kind;
+            std::vector<unsigned int> ids;   // unique, non-zero ids found in the region
+        };
+
+        static const int RING_SIZE = 4;
+
+        ObjectPicker(){}
+        ~ObjectPicker(){}
+
+        void init() {
+            for (Slot& slot : ring) {
+                glGenBuffers(1, &slot.pbo);
+            }
+        }
+
+        void destroy() {
+            for (Slot& slot : ring) {
+                if (slot.fence) { glDeleteSync(slot.fence); }
+                glDeleteBuffers(1, &slot.pbo);
+                slot = Slot{};
+            }
+        }
+
+        // queue an asynchronous read of a region of an R32UI object-ID texture.
+        // returns false (and drops the request) when every slot is still in flight.
+        bool request(Request kind, unsigned int texture, int x, int y, int width, int height) {
+            if (width <= 0 || height <= 0) return false;
+            Slot* slot = nullptr;
+            for (int i = 0; i < RING_SIZE && !slot; i++) {
+                Slot& candidate = ring[(head + i) % RING_SIZE];
+                if (!candidate.fence) { slot = &candidate; head = (head + i + 1) % RING_SIZE; }
+            }
+            if (!slot) return false;
+
+            GLsizeiptr bytes = (GLsizeiptr)width * height * sizeof(unsigned int);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+            if (bytes > slot->capacity) {
+                glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+                slot->capacity = bytes;
+            }
+            // with a pack buffer bound the copy is queued on the GPU and the pointer is an offset
+            glGetTextureSubImage(texture, 0, x, y, 0, width, height, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (GLsizei)bytes, (void*)0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            slot->kind = kind;
+            slot->count = width * height;
+            slot->issuedFrame = frame;
+            return true;
+        }
+
+        // collect every read whose fence has signalled. never blocks.
+        std::vector<Result> poll() {
+            frame++;
+            std::vector<Result> results;
+            for (Slot& slot : ring) {
+                if (!slot.fence) continue;
+                GLenum status = glClientWaitSync(slot.fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+
+                Result result;
+                result.kind = slot.kind;
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+                const unsigned int* data = (const unsigned int*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.count * sizeof(unsigned int), GL_MAP_READ_BIT);
+                if (data) {
+                    for (int i = 0; i < slot.count; i++) {
+                        if (data[i] != 0) { result.ids.push_back(data[i]); }
+                    }
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                }
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                std::sort(result.ids.begin(), result.ids.end());
+                result.ids.erase(std::unique(result.ids.begin(), result.ids.end()), result.ids.end());
+                lastLatency = frame - slot.issuedFrame;
+                results.push_back(std::move(result));
+            }
+            return results;
+        }
+
+        // frames between issuing the most recent completed read and getting its result
+        unsigned int getLastLatency() const { return lastLatency; }
+
+    private:
+        struct Slot {
+            unsigned int pbo = 0;
+            GLsync fence = nullptr;
+            GLsizeiptr capacity = 0;
+            Request kind = Request::Click;
+            int count = 0;
+            unsigned int issuedFrame = 0;
+        };
+
+        std::array<Slot, RING_SIZE> ring{};
+        int head = 0;
+        unsigned int frame = 0;
+        unsigned int lastLatency = 0;
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "JobSystem.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_CULLING_SSE 1
+#endif
+
+// CPU occlusion culling in the style of masked occlusion culling. Designated occluders are
+// rasterized into a small depth buffer of 32x8 pixel tiles; a tile doesn't store per-pixel depth
+// but a coverage bit per pixel and two depths: zMax0, which every pixel of the tile is in front of,
+// and zMax1, which the pixels in the mask are in front of. A triangle ORs its coverage into the
+// mask and raises zMax1 to its own farthest depth in the tile (or starts the mask over when it is
+// much farther away than what is there); once the mask is full, zMax1 becomes the new zMax0.
+// Objects are then tested with their screen rectangle and nearest depth, tile by tile, against
+// zMax0 and, where they overlap the mask, zMax1.
+// Rasterization is in two parallel phases on the job system: triangles are transformed, clipped to
+// the near plane, backface culled and binned into horizontal bands of tiles, then every band is
+// rasterized by one job, so no two jobs touch the same tile. Row spans are found with SSE where available.
+// Uses no GL at all; depth is OpenGL's, 0 at the near plane and 1 at the far plane.
+class OcclusionCuller {
+    public:
+        static constexpr int WIDTH = 320;
+        static constexpr int HEIGHT = 192;
+        static constexpr int TILE_WIDTH = 32;       // one 32-bit mask word per row
+        static constexpr int TILE_HEIGHT = 8;
+        static constexpr int TILES_X = WIDTH / TILE_WIDTH;
+        static constexpr int TILES_Y = HEIGHT / TILE_HEIGHT;
+        static constexpr int BIN_ROWS = 2;          // tile rows per bin
+        static constexpr int BINS = TILES_Y / BIN_ROWS;
+        static constexpr int MAX_THREADS = 8;
+
+        enum Result { Visible, Occluded, OutsideFrustum };
+
+        // a mesh to rasterize: positions and triangle indices in model space
+        struct Occluder {
+            const std::vector<glm::vec3>* positions;
+            const std::vector<unsigned int>* indices;
+            glm::mat4 model;
+        };
+
+        struct Stats {
+            int occluders = 0;
+            int occluderTriangles = 0;      // submitted
+            int rasterizedTriangles = 0;    // left after near clipping, backface and screen culling
+            int tested = 0;
+            int occluded = 0;
+            int outside = 0;                // outside the view frustum
+            float rasterMs = 0.0f;
+            float testMs = 0.0f;
+            int threads = 0;
+        };
+
+        OcclusionCuller() : tiles(TILES_X * TILES_Y) { clear(); }
+        ~OcclusionCuller(){}
+
+        // rebuild the depth buffer from this frame's occluders
+        void rasterize(const std::vector<Occluder>& occluders, const glm::mat4& viewProjection, JobSystem& jobs) {
+            auto start = std::chrono::high_resolution_clock::now();
+            stats = Stats{};
+            clear();
+
+            // triangles are spread evenly over the threads, whichever occluder they belong to
+            std::vector<size_t> firstTriangle(occluders.size() + 1, 0);
+            for (size_t i = 0; i < occluders.size(); i++) {
+                firstTriangle[i + 1] = firstTriangle[i] + occluders[i].indices->size() / 3;
+            }
+            const size_t triangleCount = firstTriangle.back();
+            int threadCount = std::clamp(jobs.threadCount(), 1, MAX_THREADS);
+            if (triangleCount < 256) threadCount = 1;
+            bins.resize((size_t)threadCount * BINS);
+            for (auto& bin : bins) bin.clear();
+
+            auto binTriangles = [&](int t) {
+                size_t t0 = triangleCount * t / threadCount;
+                size_t t1 = triangleCount * (t + 1) / threadCount;
+                size_t o = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), t0) - firstTriangle.begin() - 1;
+                glm::mat4 mvp;
+                size_t mvpFor = SIZE_MAX;
+                for (size_t tri = t0; tri < t1; tri++) {
+                    while (tri >= firstTriangle[o + 1]) o++;
+                    if (mvpFor != o) { mvp = viewProjection * occluders[o].model; mvpFor = o; }
+                    const std::vector<glm::vec3>& positions = *occluders[o].positions;
+                    const unsigned int* index = &(*occluders[o].indices)[(tri - firstTriangle[o]) * 3];
+                    glm::vec4 clip[3];
+                    for (int k = 0; k < 3; k++) { clip[k] = mvp * glm::vec4(positions[index[k]], 1.0f); }
+                    setupTriangle(clip, &bins[(size_t)t * BINS]);
+                }
+            };
+            runJobs(jobs, threadCount, binTriangles);
+
+            // a band's tiles belong to one thread; triangles keep their submission order
+            auto rasterizeBins = [&](int t) {
+                for (int b = t; b < BINS; b += threadCount) {
+                    for (int source = 0; source < threadCount; source++) {
+                        for (const ScreenTriangle& tri : bins[(size_t)source * BINS + b]) {
+                            rasterizeTriangle(tri, b * BIN_ROWS, (b + 1) * BIN_ROWS);
+                        }
+                    }
+                }
+            };
+            runJobs(jobs, threadCount, rasterizeBins);
+
+            stats.occluders = (int)occluders.size();
+            stats.occluderTriangles = (int)triangleCount;
+            for (int t = 0; t < threadCount; t++) {
+                for (int b = 0; b < BINS; b++) {
+                    for (const ScreenTriangle& tri : bins[(size_t)t * BINS + b]) { if (tri.firstBin == b) stats.rasterizedTriangles++; }
+                }
+            }
+            stats.threads = threadCount;
+            stats.rasterMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        // test a model-space box against the depth buffer; anything crossing the near plane is visible
+        Result test(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelViewProjection) {
+            auto start = std::chrono::high_resolution_clock::now();
+            Result result = testBox(boundsMin, boundsMax, modelViewProjection);
+            stats.tested++;
+            if (result == Occluded) stats.occluded++;
+            if (result == OutsideFrustum) stats.outside++;
+            stats.testMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            return result;
+        }
+
+        const Stats& getStats() const { return stats; }
+
+        // farthest guaranteed depth of a tile, for visualising the buffer
+        float getTileDepth(int tx, int ty) const { return tiles[ty * TILES_X + tx].zMax0; }
+
+        // the same tiles bit for bit; the threaded rasterizer has to match a single thread exactly
+        bool sameBuffer(const OcclusionCuller& other) const {
+            return std::memcmp(tiles.data(), other.tiles.data(), tiles.size() * sizeof(Tile)) == 0;
+        }
+
+    private:
+        struct Tile {
+            float zMax0;
+            float zMax1;
+            uint32_t mask[TILE_HEIGHT];
+        };
+
+        // a triangle in buffer pixels (y up) with OpenGL depth, counter-clockwise
+        struct ScreenTriangle {
+            glm::vec2 v[3];
+            float z[3];
+            int firstBin;       // the triangle is binned into every band it touches
+        };
+
+        std::vector<Tile> tiles;
+        std::vector<std::vector<ScreenTriangle>> bins;  // [thread * BINS + bin]
+        Stats stats;
+
+        template <typename Work>
+        static void runJobs(JobSystem& jobs, int count, Work& work) {
+            jobs.parallelFor(0, count, 1, [&](size_t first, size_t last) { for (size_t t = first; t < last; t++) work((int)t); });
+        }
+
+        void clear() {
+            for (Tile& tile : tiles) {
+                tile.zMax0 = 1.0f;
+                tile.zMax1 = 0.0f;
+                std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+            }
+        }
+
+        // clip to the near plane (z > -w), project, cull and bin; a clipped triangle can become two
+        void setupTriangle(const glm::vec4 clip[3], std::vector<ScreenTriangle>* threadBins) const {
+            glm::vec4 polygon[4];
+            int count = 0;
+            for (int k = 0; k < 3; k++) {
+                const glm::vec4& a = clip[k];
+                const glm::vec4& b = clip[(k + 1) % 3];
+                float da = a.z + a.w, db = b.z + b.w;
+                if (da >= 0.0f) polygon[count++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f)) polygon[count++] = a + (b - a) * (da / (da - db));
+            }
+            if (count < 3) return;
+            glm::vec2 screen[4];
+            float depth[4];
+            for (int k = 0; k < count; k++) {
+                float w = std::max(polygon[k].w, 1e-6f);
+                screen[k] = glm::vec2((polygon[k].x / w * 0.5f + 0.5f) * WIDTH, (polygon[k].y / w * 0.5f + 0.5f) * HEIGHT);
+                depth[k] = polygon[k].z / w * 0.5f + 0.5f;
+            }
+            for (int k = 1; k + 1 < count; k++) {
+                ScreenTriangle tri{{screen[0], screen[k], screen[k + 1]}, {depth[0], depth[k], depth[k + 1]}, 0};
+                glm::vec2 e1 = tri.v[1] - tri.v[0], e2 = tri.v[2] - tri.v[0];
+                if (e1.x * e2.y - e1.y * e2.x <= 0.0f) continue;     // back facing or degenerate
+                float minX = std::min({tri.v[0].x, tri.v[1].x, tri.v[2].x}), maxX = std::max({tri.v[0].x, tri.v[1].x, tri.v[2].x});
+                float minY = std::min({tri.v[0].y, tri.v[1].y, tri.v[2].y}), maxY = std::max({tri.v[0].y, tri.v[1].y, tri.v[2].y});
+                if (maxX <= 0.0f || minX >= WIDTH || maxY <= 0.0f || minY >= HEIGHT) continue;
+                if (std::min({tri.z[0], tri.z[1], tri.z[2]}) > 1.0f) continue;     // beyond the far plane
+                int row0 = std::clamp((int)std::floor(minY) / TILE_HEIGHT, 0, TILES_Y - 1);
+                int row1 = std::clamp((int)std::ceil(maxY) / TILE_HEIGHT, 0, TILES_Y - 1);
+                tri.firstBin = row0 / BIN_ROWS;
+                for (int b = row0 / BIN_ROWS; b <= row1 / BIN_ROWS; b++) { threadBins[b].push_back(tri); }
+            }
+        }
+
+        // cover the triangle's pixels in tile rows [tileRow0, tileRow1)
+        void rasterizeTriangle(const ScreenTriangle& tri, int tileRow0, int tileRow1) {
+            const float minX = std::min({tri.v[0].x, tri.v[1].x, tri.v[2].x}), maxX = std::max({tri.v[0].x, tri.v[1].x, tri.v[2].x});
+            const float minY = std::min({tri.v[0].y, tri.v[1].y, tri.v[2].y}), maxY = std::max({tri.v[0].y, tri.v[1].y, tri.v[2].y});
+            const float minZ = std::min({tri.z[0], tri.z[1], tri.z[2]}), maxZ = std::max({tri.z[0], tri.z[1], tri.z[2]});
+
+            // counter-clockwise with y up: edges going down bound the span on the left, edges going
+            // up on the right; horizontal edges are the triangle's y range. unused slots never bind
+            float edgeX[4] = {-1e30f, -1e30f, 1e30f, 1e30f}, edgeY[4] = {0.0f, 0.0f, 0.0f, 0.0f}, edgeSlope[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            int left = 0, right = 2;
+            for (int k = 0; k < 3; k++) {
+                glm::vec2 a = tri.v[k], b = tri.v[(k + 1) % 3];
+                float dy = b.y - a.y;
+                if (dy == 0.0f) continue;
+                int slot = dy < 0.0f ? left++ : right++;
+                edgeX[slot] = a.x;
+                edgeY[slot] = a.y;
+                edgeSlope[slot] = (b.x - a.x) / dy;
+            }
+
+            // depth plane z = z0 + dzdx * (x - x0) + dzdy * (y - y0)
+            glm::vec3 e1(tri.v[1] - tri.v[0], tri.z[1] - tri.z[0]);
+            glm::vec3 e2(tri.v[2] - tri.v[0], tri.z[2] - tri.z[0]);
+            glm::vec3 n = glm::cross(e1, e2);
+            const float dzdx = -n.x / n.z, dzdy = -n.y / n.z;
+            auto depthAt = [&](float x, float y) { return tri.z[0] + dzdx * (x - tri.v[0].x) + dzdy * (y - tri.v[0].y); };
+
+            const int pixelX0 = std::max(0, (int)std::floor(minX)), pixelX1 = std::min(WIDTH, (int)std::ceil(maxX));
+            const int tileX0 = pixelX0 / TILE_WIDTH, tileX1 = (pixelX1 + TILE_WIDTH - 1) / TILE_WIDTH;
+            const int firstRow = std::max(tileRow0, (int)std::floor(minY) / TILE_HEIGHT);
+            const int lastRow = std::min(tileRow1, ((int)std::ceil(maxY) + TILE_HEIGHT - 1) / TILE_HEIGHT);
+            for (int ty = std::max(firstRow, 0); ty < lastRow; ty++) {
+                const float rowY = (float)(ty * TILE_HEIGHT);
+                float spanLeft[TILE_HEIGHT], spanRight[TILE_HEIGHT];
+                edgeSpans(edgeX, edgeY, edgeSlope, rowY + 0.5f, spanLeft, spanRight);
+
+                // pixels whose centre lies in [left, right), as start/end columns per row
+                int spanStart[TILE_HEIGHT], spanEnd[TILE_HEIGHT];
+                bool anyRow = false;
+                for (int r = 0; r < TILE_HEIGHT; r++) {
+                    float y = rowY + r + 0.5f;
+                    spanStart[r] = spanEnd[r] = 0;
+                    if (y < minY || y >= maxY) continue;
+                    float l = std::clamp(spanLeft[r], -1.0f, WIDTH + 1.0f), rr = std::clamp(spanRight[r], -1.0f, WIDTH + 1.0f);
+                    spanStart[r] = std::max(pixelX0, (int)std::ceil(l - 0.5f));
+                    spanEnd[r] = std::min(pixelX1, (int)std::ceil(rr - 0.5f));
+                    anyRow |= spanEnd[r] > spanStart[r];
+                }
+                if (!anyRow) continue;
+
+                const float clipY0 = std::max(rowY, minY), clipY1 = std::min(rowY + TILE_HEIGHT, maxY);
+                for (int tx = tileX0; tx < tileX1; tx++) {
+                    const int x0 = tx * TILE_WIDTH;
+                    uint32_t coverage[TILE_HEIGHT];
+                    uint32_t any = 0;
+                    for (int r = 0; r < TILE_HEIGHT; r++) {
+                        int s = std::clamp(spanStart[r] - x0, 0, TILE_WIDTH), e = std::clamp(spanEnd[r] - x0, 0, TILE_WIDTH);
+                        coverage[r] = e > s ? (uint32_t)(((1ull << e) - 1) ^ ((1ull << s) - 1)) : 0u;
+                        any |= coverage[r];
+                    }
+                    if (!any) continue;
+                    // the plane is linear, so its farthest point over the covered rectangle is a corner
+                    const float clipX0 = std::max((float)x0, minX), clipX1 = std::min((float)(x0 + TILE_WIDTH), maxX);
+                    float tileZ = std::max({depthAt(clipX0, clipY0), depthAt(clipX1, clipY0), depthAt(clipX0, clipY1), depthAt(clipX1, clipY1)});
+                    updateTile(tiles[ty * TILES_X + tx], coverage, std::clamp(tileZ, minZ, maxZ));
+                }
+            }
+        }
+
+        // left and right span bounds of TILE_HEIGHT consecutive pixel rows starting at centre y
+        static void edgeSpans(const float edgeX[4], const float edgeY[4], const float edgeSlope[4], float y, float* spanLeft, float* spanRight) {
+#ifdef OCCLUSION_CULLING_SSE
+            for (int half = 0; half < TILE_HEIGHT; half += 4) {
+                __m128 rows = _mm_add_ps(_mm_set1_ps(y + half), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+                __m128 x[4];
+                for (int k = 0; k < 4; k++) {
+                    x[k] = _mm_add_ps(_mm_set1_ps(edgeX[k]), _mm_mul_ps(_mm_set1_ps(edgeSlope[k]), _mm_sub_ps(rows, _mm_set1_ps(edgeY[k]))));
+                }
+                _mm_storeu_ps(spanLeft + half, _mm_max_ps(x[0], x[1]));
+                _mm_storeu_ps(spanRight + half, _mm_min_ps(x[2], x[3]));
+            }
+#else
+            for (int r = 0; r < TILE_HEIGHT; r++) {
+                float x[4];
+                for (int k = 0; k < 4; k++) { x[k] = edgeX[k] + edgeSlope[k] * (y + r - edgeY[k]); }
+                spanLeft[r] = std::max(x[0], x[1]);
+                spanRight[r] = std::min(x[2], x[3]);
+            }
+#endif
+        }
+
+        // merge a triangle's coverage of the tile, at most triangleZ deep, into the tile
+        static void updateTile(Tile& tile, const uint32_t coverage[TILE_HEIGHT], float triangleZ) {
+            if (triangleZ >= tile.zMax0) return;     // the tile already guarantees as much
+            // closer to the reference layer than to the working one: start the working layer over
+            if (triangleZ - tile.zMax1 > tile.zMax0 - triangleZ) {
+                tile.zMax1 = 0.0f;
+                std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+            }
+            tile.zMax1 = std::max(tile.zMax1, triangleZ);
+            uint32_t full = ~0u;
+            for (int r = 0; r < TILE_HEIGHT; r++) {
+                tile.mask[r] |= coverage[r];
+                full &= tile.mask[r];
+            }
+            if (full == ~0u) {
+                tile.zMax0 = std::min(tile.zMax0, tile.zMax1);
+                tile.zMax1 = 0.0f;
+                std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+            }
+        }
+
+        Result testBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& mvp) const {
+            glm::vec4 clip[8];
+            int outside[6] = {0, 0, 0, 0, 0, 0};
+            bool crossesNear = false;
+            for (int k = 0; k < 8; k++) {
+                glm::vec3 corner((k & 1) ? boundsMax.x : boundsMin.x, (k & 2) ? boundsMax.y : boundsMin.y, (k & 4) ? boundsMax.z : boundsMin.z);
+                glm::vec4 c = mvp * glm::vec4(corner, 1.0f);
+                clip[k] = c;
+                outside[0] += c.x < -c.w;
+                outside[1] += c.x > c.w;
+                outside[2] += c.y < -c.w;
+                outside[3] += c.y > c.w;
+                outside[4] += c.z < -c.w;
+                outside[5] += c.z > c.w;
+                crossesNear |= c.z < -c.w;
+            }
+            for (int plane = 0; plane < 6; plane++) { if (outside[plane] == 8) return OutsideFrustum; }
+            if (crossesNear) return Visible;
+
+            float minX = FLT_BIG, maxX = -FLT_BIG, minY = FLT_BIG, maxY = -FLT_BIG, minZ = FLT_BIG;
+            for (const glm::vec4& c : clip) {
+                float x = (c.x / c.w * 0.5f + 0.5f) * WIDTH, y = (c.y / c.w * 0.5f + 0.5f) * HEIGHT;
+                minX = std::min(minX, x); maxX = std::max(maxX, x);
+                minY = std::min(minY, y); maxY = std::max(maxY, y);
+                minZ = std::min(minZ, c.z / c.w * 0.5f + 0.5f);
+            }
+            // every pixel whose centre the rectangle could touch
+            const int x0 = std::max(0, (int)std::floor(minX - 0.5f)), x1 = std::min(WIDTH, (int)std::ceil(maxX + 0.5f));
+            const int y0 = std::max(0, (int)std::floor(minY - 0.5f)), y1 = std::min(HEIGHT, (int)std::ceil(maxY + 0.5f));
+            if (x0 >= x1 || y0 >= y1) return OutsideFrustum;
+
+            for (int ty = y0 / TILE_HEIGHT; ty * TILE_HEIGHT < y1; ty++) {
+                for (int tx = x0 / TILE_WIDTH; tx * TILE_WIDTH < x1; tx++) {
+                    const Tile& tile = tiles[ty * TILES_X + tx];
+                    // pixels outside the mask are bounded by zMax0, those inside by zMax1 as well
+                    if (minZ >= tile.zMax0) continue;
+                    if (minZ < tile.zMax1) return Visible;
+                    // behind the mask only: visible where the rectangle leaves the mask
+                    int s = std::clamp(x0 - tx * TILE_WIDTH, 0, TILE_WIDTH), e = std::clamp(x1 - tx * TILE_WIDTH, 0, TILE_WIDTH);
+                    uint32_t columns = (uint32_t)(((1ull << e) - 1) ^ ((1ull << s) - 1));
+                    for (int r = 0; r < TILE_HEIGHT; r++) {
+                        int y = ty * TILE_HEIGHT + r;
+                        if (y < y0 || y >= y1) continue;
+                        if (columns & ~tile.mask[r]) return Visible;
+                    }
+                }
+            }
+            return Occluded;
+        }
+
+        static constexpr float FLT_BIG = 3.0e38f;
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.hpp"
+
+// GPU occlusion culling with hardware queries, after CHC++: every object remembers whether it was
+// visible, and results are only read once GL says they are available, so the CPU never waits.
+// Objects that were visible are drawn straight away; every visibleCheckInterval frames (staggered
+// by id, and at once for objects never seen before) the draw is wrapped in a query to notice when
+// they become hidden. Objects that were hidden are handled at the end of the pass, in a batch:
+// first a GL_ANY_SAMPLES_PASSED_CONSERVATIVE query on each bounding box against the depth laid
+// down so far (no colour or depth writes), then each object drawn under glBeginConditionalRender
+// on its query, so the GPU skips it unless the box passed, whatever the CPU knows yet. A box query
+// that comes back positive makes the object visible again from the next frame on. An object none
+// of last frame's passes drew (deleted, or culled before it got here) gives its queries back; if it
+// returns it starts over as never seen.
+// SAMPLES_PASSED style queries can't overlap, so nothing else may count samples around these draws.
+class OcclusionQueries {
+    public:
+        static constexpr int QUERIES_PER_OBJECT = 3;    // results in flight per object
+
+        struct Stats {
+            int drawnVisible = 0;       // drawn directly, last known visible
+            int conditional = 0;        // drawn under conditional render
+            int occluded = 0;           // last known result says hidden
+            int queriesIssued = 0;
+            int resultsRead = 0;
+            float latencyFrames = 0.0f; // frames from issuing a query to reading it, averaged
+        };
+
+        // a hidden object's bounding box: the unit cube [-1, 1]^3 is transformed by box
+        struct Candidate {
+            unsigned int id;
+            glm::mat4 box;
+        };
+
+        OcclusionQueries(){}
+        ~OcclusionQueries(){}
+
+        void destroy() {
+            for (auto& [id, state] : states) { glDeleteQueries(QUERIES_PER_OBJECT, state.queries.data()); }
+            states.clear();
+        }
+
+        // read back whatever has finished and start counting a new frame, checking visible objects
+        // every checkInterval frames
+        void beginFrame(int checkInterval) {
+            visibleCheckInterval = std::max(checkInterval, 1);
+            frame++;
+            stats = Stats{};
+            for (auto it = states.begin(); it != states.end();) {
+                if (it->second.usedFrame >= frame - 1) { ++it; continue; }
+                glDeleteQueries(QUERIES_PER_OBJECT, it->second.queries.data());
+                it = states.erase(it);
+            }
+            for (auto& [id, state] : states) {
+                // only the newest available result matters
+                int newest = -1;
+                for (int q = 0; q < QUERIES_PER_OBJECT; q++) {
+                    if (!state.pending[q]) continue;
+                    GLuint available = 0;
+                    glGetQueryObjectuiv(state.queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (!available) continue;
+                    if (newest < 0 || state.issuedFrame[q] > state.issuedFrame[newest]) newest = q;
+                    GLuint passed = 0;
+                    glGetQueryObjectuiv(state.queries[q], GL_QUERY_RESULT, &passed);
+                    state.pending[q] = false;
+                    state.result[q] = passed != 0;
+                    float latency = (float)(frame - state.issuedFrame[q]);
+                    latencySum += latency;
+                    latencyCount++;
+                    stats.resultsRead++;
+                }
+                if (newest >= 0 && state.issuedFrame[newest] > state.resultFrame) {
+                    state.visible = state.result[newest];
+                    state.resultFrame = state.issuedFrame[newest];
+                }
+                if (!state.visible) stats.occluded++;
+            }
+            if (latencyCount > 0) { averageLatency = latencySum / latencyCount; }
+            stats.latencyFrames = averageLatency;
+            // keep the average to recent frames
+            if (latencyCount > 256) { latencySum *= 0.5f; latencyCount *= 0.5f; }
+        }
+
+        // last known visibility; objects never queried count as visible
+        bool isVisible(unsigned int id) const {
+            auto it = states.find(id);
+            return it == states.end() || it->second.visible;
+        }
+
+        // draw an object that was visible, inside a query on the frames it is due for a check
+        template <typename Draw>
+        void drawVisible(unsigned int id, Draw&& draw) {
+            stats.drawnVisible++;
+            State& state = stateFor(id);
+            // objects without a result yet are checked right away
+            bool due = state.resultFrame < 0 || (frame + id) % visibleCheckInterval == 0;
+            int slot = due ? freeSlot(state) : -1;
+            if (slot < 0) {
+                draw();
+                return;
+            }
+            glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, state.queries[slot]);
+            draw();
+            glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+            markIssued(state, slot);
+        }
+
+        // hidden objects: query every box against the depth so far, then draw each object under its
+        // query. draw(i) draws candidates[i] with whatever shader and state the pass uses
+        template <typename Draw>
+        void drawHidden(const std::vector<Candidate>& candidates, Shader& boxShader, unsigned int cubeVAO, Draw&& draw) {
+            if (candidates.empty()) return;
+            std::vector<int> slots(candidates.size(), -1);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthMask(GL_FALSE);
+            glDepthFunc(GL_LEQUAL);
+            glDisable(GL_CULL_FACE);
+            boxShader.use();
+            glBindVertexArray(cubeVAO);
+            for (size_t i = 0; i < candidates.size(); i++) {
+                State& state = stateFor(candidates[i].id);
+                slots[i] = freeSlot(state);
+                if (slots[i] < 0) continue;
+                boxShader.setMat4("model", candidates[i].box);
+                glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, state.queries[slots[i]]);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+                markIssued(state, slots[i]);
+            }
+            glBindVertexArray(0);
+            glEnable(GL_CULL_FACE);
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            // every query is in flight by now; the GPU resolves them in order without the CPU
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (slots[i] < 0) {
+                    // no query free: draw it unconditionally rather than lose it
+                    draw(i);
+                    continue;
+                }
+                stats.conditional++;
+                glBeginConditionalRender(states[candidates[i].id].queries[slots[i]], GL_QUERY_WAIT);
+                draw(i);
+                glEndConditionalRender();
+            }
+        }
+
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct State {
+            std::array<unsigned int, QUERIES_PER_OBJECT> queries{};
+            std::array<bool, QUERIES_PER_OBJECT> pending{};
+            std::array<bool, QUERIES_PER_OBJECT> result{};
+            std::array<long long, QUERIES_PER_OBJECT> issuedFrame{};
+            long long resultFrame = -1;
+            long long usedFrame = 0;    // last frame a pass drew the object
+            bool visible = true;
+        };
+
+        std::unordered_map<unsigned int, State> states;     // by object ID
+        long long frame = 0;
+        int visibleCheckInterval = 1;
+        Stats stats;
+        float latencySum = 0.0f;
+        float latencyCount = 0.0f;
+        float averageLatency = 0.0f;
+
+        State& stateFor(unsigned int id) {
+            auto it = states.find(id);
+            if (it == states.end()) {
+                it = states.emplace(id, State{}).first;
+                glGenQueries(QUERIES_PER_OBJECT, it->second.queries.data());
+            }
+            it->second.usedFrame = frame;
+            return it->second;
+        }
+
+        static int freeSlot(const State& state) {
+            for (int q = 0; q < QUERIES_PER_OBJECT; q++) { if (!state.pending[q]) return q; }
+            return -1;
+        }
+
+        void markIssued(State& state, int slot) {
+            state.pending[slot] = true;
+            state.issuedFrame[slot] = frame;
+            stats.queriesIssued++;
+        }
+};
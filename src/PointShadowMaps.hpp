@@ -0,0 +1,406 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// Point-light shadow storage: one GL_TEXTURE_CUBE_MAP_ARRAY of 16-bit depth per resolution tier.
+// The memory budget is split between the tiers up front and only reallocated when the budget
+// changes; every frame the lights are ranked by how large their influence sphere appears on
+// screen and handed out layers, the biggest ones in the sharpest tier that still has room.
+// A light's slot is (tier << 16) | layer, which is what the shaders decode; -1 = unshadowed.
+// Every tier has a twin array caching the static casters only: a light keeps its layer while it
+// stays in the same tier, so the cache survives until the light moves or a static object in
+// its range changes, and each frame only the dynamic casters are drawn over a copy of it.
+// Updates are scheduled per cube face under a per-frame face budget: the most important lights
+// are refreshed whole, the rest one face at a time, stalest face first.
+class PointShadowMaps {
+    public:
+        static constexpr int TIER_COUNT = 3;
+        static constexpr int TIER_SIZES[TIER_COUNT] = { 1024, 512, 256 };
+        // share of the budget each tier gets, and the on-screen radius (pixels) a light needs
+        // before it's worth that tier
+        static constexpr float TIER_BUDGET_SHARE[TIER_COUNT] = { 0.5f, 0.3f, 0.2f };
+        static constexpr float TIER_MIN_SCREEN_RADIUS[TIER_COUNT] = { 384.0f, 96.0f, 0.0f };
+        static constexpr unsigned int ALL_FACES = 0x3F;
+
+        struct Candidate {
+            glm::vec3 position;
+            float radius;           // how far the light's shadows reach
+            unsigned int key;       // stable identity, lets a light keep its layer between frames
+        };
+
+        struct Stats {
+            int candidates = 0;
+            int visible = 0;        // candidates whose influence overlaps the view
+            int shadowed = 0;
+            int perTier[TIER_COUNT] = {};
+            int capacity[TIER_COUNT] = {};
+            float memoryMB = 0.0f;
+            int staticRenders = 0;  // cache faces rebuilt this frame
+            int composites = 0;     // live faces refreshed this frame
+            int fullUpdates = 0;    // lights refreshed whole this frame
+            int pendingFaces = 0;   // faces that needed an update but didn't fit the budget
+            int maxAge = 0;         // frames the stalest pending face has waited
+        };
+
+        // what the shadow passes should do for one light this frame
+        struct FaceWork {
+            int candidate;              // index into the last assign() call's candidates
+            int slot;
+            unsigned int rebuildFaces;  // cache faces to re-render from the static casters
+            unsigned int refreshFaces;  // live faces to copy from the cache and draw dynamics over
+        };
+
+        PointShadowMaps(){}
+        ~PointShadowMaps(){}
+
+        static int encodeSlot(int tier, int layer) { return (tier << 16) | layer; }
+        static int slotTier(int slot) { return slot >> 16; }
+        static int slotLayer(int slot) { return slot & 0xFFFF; }
+
+        // faces of a cube centred on lightPosition (GL order +X -X +Y -Y +Z -Z) that a sphere
+        // overlaps. face +X holds the points with x >= |y| and x >= |z|, so the sphere reaches it
+        // when x - |y| and x - |z| are both at least -radius * sqrt(2)
+        static unsigned int facesOverlapping(const glm::vec3& lightPosition, const glm::vec3& center, float radius) {
+            glm::vec3 d = center - lightPosition;
+            float reach = -radius * 1.41421356f;
+            unsigned int faces = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                float a = std::abs(d[(axis + 1) % 3]), b = std::abs(d[(axis + 2) % 3]);
+                for (int sign = 0; sign < 2; sign++) {
+                    float u = sign ? -d[axis] : d[axis];
+                    if (u - a >= reach && u - b >= reach) faces |= 1u << (axis * 2 + sign);
+                }
+            }
+            return faces;
+        }
+
+        // a shadowed light costs its live cube plus its static cache
+        static size_t bytesPerCube(int size) { return (size_t)size * size * 6 * 2; }
+        static size_t bytesPerLight(int size) { return 2 * bytesPerCube(size); }
+
+        // (re)allocates the tier arrays when the budget changed since the last call
+        void setBudget(float budgetMB) {
+            if (budgetMB == allocatedBudgetMB && textures[0]) return;
+            destroy();
+            allocatedBudgetMB = budgetMB;
+            stats.memoryMB = 0.0f;
+            for (int t = 0; t < TIER_COUNT; t++) {
+                double bytes = budgetMB * TIER_BUDGET_SHARE[t] * 1024.0 * 1024.0;
+                capacity[t] = (int)(bytes / bytesPerLight(TIER_SIZES[t]));
+                // an empty tier still gets one cube so the sampler always has a complete texture
+                int layers = std::max(1, capacity[t]);
+                textures[t] = createArray(TIER_SIZES[t], layers);
+                staticTextures[t] = createArray(TIER_SIZES[t], layers);
+                layerState[t].assign(layers, LayerState{});
+                stats.memoryMB += layers * bytesPerLight(TIER_SIZES[t]) / (1024.0f * 1024.0f);
+            }
+            glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+        }
+
+        void destroy() {
+            for (int t = 0; t < TIER_COUNT; t++) {
+                if (textures[t]) { glDeleteTextures(1, &textures[t]); }
+                if (staticTextures[t]) { glDeleteTextures(1, &staticTextures[t]); }
+                textures[t] = staticTextures[t] = 0;
+                layerState[t].clear();
+            }
+            slotByKey.clear();
+            capacity.fill(0);
+            if (faceFramebuffer) { glDeleteFramebuffers(1, &faceFramebuffer); }
+            faceFramebuffer = 0;
+            allocatedBudgetMB = -1.0f;
+        }
+
+        // rank the candidates by projected radius and hand out slots; off-screen lights get none
+        std::vector<int> assign(const std::vector<Candidate>& candidates, const glm::mat4& view, float fovY, float aspect, float viewportHeight) {
+            std::vector<int> slots(candidates.size(), -1);
+            std::vector<float> screenRadius(candidates.size(), 0.0f);
+            lastDistance.assign(candidates.size(), 0.0f);
+            float tanHalfY = std::tan(fovY * 0.5f);
+            float tanHalfX = tanHalfY * aspect;
+            int visible = 0;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                glm::vec3 p = glm::vec3(view * glm::vec4(candidates[i].position, 1.0f));
+                float r = candidates[i].radius;
+                if (!sphereInFrustum(p, r, tanHalfX, tanHalfY)) continue;
+                float depth = -p.z;
+                lastDistance[i] = glm::length(p);
+                // with the camera inside the sphere it covers the whole screen
+                screenRadius[i] = depth > r ? viewportHeight * 0.5f * r / (std::sqrt(depth * depth - r * r) * tanHalfY) : viewportHeight;
+                visible++;
+            }
+
+            std::vector<int> order(candidates.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return screenRadius[a] > screenRadius[b]; });
+
+            // pick every light's tier first, so layers can be handed out in a second pass
+            std::array<int, TIER_COUNT> used{};
+            std::vector<int> tiers(candidates.size(), -1);
+            for (int i : order) {
+                if (screenRadius[i] <= 0.0f) break;
+                // the sharpest tier the light qualifies for, or the next one down that has room
+                int tier = 0;
+                while (tier < TIER_COUNT - 1 && screenRadius[i] < TIER_MIN_SCREEN_RADIUS[tier]) tier++;
+                while (tier < TIER_COUNT && used[tier] >= capacity[tier]) tier++;
+                if (tier == TIER_COUNT) continue;
+                tiers[i] = tier;
+                used[tier]++;
+            }
+
+            // lights that stay in their tier keep their layer (and its cache), the rest fill the gaps
+            std::array<std::vector<bool>, TIER_COUNT> taken;
+            for (int t = 0; t < TIER_COUNT; t++) { taken[t].assign(layerState[t].size(), false); }
+            std::unordered_map<unsigned int, int> previous;
+            previous.swap(slotByKey);
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (tiers[i] < 0) continue;
+                auto it = previous.find(candidates[i].key);
+                if (it == previous.end() || slotTier(it->second) != tiers[i]) continue;
+                int layer = slotLayer(it->second);
+                if (layer >= (int)taken[tiers[i]].size() || taken[tiers[i]][layer]) continue;
+                taken[tiers[i]][layer] = true;
+                slots[i] = it->second;
+            }
+            std::array<int, TIER_COUNT> nextFree{};
+            for (size_t i = 0; i < candidates.size(); i++) {
+                int tier = tiers[i];
+                if (tier < 0 || slots[i] >= 0) continue;
+                while (taken[tier][nextFree[tier]]) nextFree[tier]++;
+                taken[tier][nextFree[tier]] = true;
+                slots[i] = encodeSlot(tier, nextFree[tier]);
+            }
+
+            // a layer's cache is only good for the light that rendered it, from where it rendered it
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (slots[i] < 0) continue;
+                slotByKey[candidates[i].key] = slots[i];
+                LayerState& state = layerState[slotTier(slots[i])][slotLayer(slots[i])];
+                if (state.key != candidates[i].key || state.position != candidates[i].position || state.radius != candidates[i].radius) {
+                    state.key = candidates[i].key;
+                    state.position = candidates[i].position;
+                    state.radius = candidates[i].radius;
+                    state.staticFaces = 0;
+                    state.liveStaticFaces = 0;
+                    state.lastUpdate.fill(NEVER);
+                }
+            }
+            lastSlots = slots;
+            lastScreenRadius = screenRadius;
+
+            stats.candidates = (int)candidates.size();
+            stats.visible = visible;
+            stats.shadowed = 0;
+            stats.staticRenders = 0;
+            stats.composites = 0;
+            stats.fullUpdates = 0;
+            stats.pendingFaces = 0;
+            stats.maxAge = 0;
+            for (int t = 0; t < TIER_COUNT; t++) {
+                stats.perTier[t] = used[t];
+                stats.capacity[t] = capacity[t];
+                stats.shadowed += used[t];
+            }
+            return slots;
+        }
+
+        // drops the static cache of every light whose range touches the sphere
+        void invalidate(const glm::vec3& center, float radius) {
+            for (auto& states : layerState) {
+                for (LayerState& state : states) {
+                    float reach = state.radius + radius;
+                    glm::vec3 d = state.position - center;
+                    if (glm::dot(d, d) <= reach * reach) state.staticFaces = 0;
+                }
+            }
+        }
+
+        void invalidateAll() {
+            for (auto& states : layerState) {
+                for (LayerState& state : states) { state.staticFaces = 0; }
+            }
+        }
+
+        // decide which faces of the lights from the last assign() get updated this frame.
+        // dynamicFaces holds, per candidate, the faces a dynamic caster can reach. a face needs
+        // work when its cache is stale, a dynamic caster is on it, or it still shows one from an
+        // earlier frame. lights are taken by priority (new lights, then on-screen size, then
+        // distance) and refreshed whole while the full-update share of the budget lasts; the
+        // rest of the budget is handed out a face per light at a time, longest waiting first.
+        std::vector<FaceWork> schedule(const std::vector<unsigned int>& dynamicFaces, int faceBudget) {
+            frame++;
+            std::vector<int> pending;
+            std::vector<unsigned int> need(lastSlots.size(), 0);
+            for (size_t i = 0; i < lastSlots.size(); i++) {
+                if (lastSlots[i] < 0) continue;
+                const LayerState& st = state(lastSlots[i]);
+                need[i] = (~st.staticFaces | dynamicFaces[i] | ~st.liveStaticFaces) & ALL_FACES;
+                if (need[i]) pending.push_back((int)i);
+            }
+            auto isNew = [&](int i) {
+                const auto& updates = state(lastSlots[i]).lastUpdate;
+                return std::find(updates.begin(), updates.end(), NEVER) != updates.end();
+            };
+            std::stable_sort(pending.begin(), pending.end(), [&](int a, int b) {
+                if (isNew(a) != isNew(b)) return isNew(a);
+                if (lastScreenRadius[a] != lastScreenRadius[b]) return lastScreenRadius[a] > lastScreenRadius[b];
+                return lastDistance[a] < lastDistance[b];
+            });
+
+            std::vector<unsigned int> granted(lastSlots.size(), 0);
+            int budget = std::max(faceBudget, 6);
+            int fullBudget = std::max(6, budget * 3 / 4);
+            std::vector<int> sliced;
+            for (int i : pending) {
+                int faces = std::popcount(need[i]);
+                if (sliced.empty() && faces <= fullBudget) {
+                    granted[i] = need[i];
+                    fullBudget -= faces;
+                    budget -= faces;
+                    stats.fullUpdates++;
+                } else {
+                    sliced.push_back(i);
+                }
+            }
+            // each remaining light offers its stalest face, never-rendered faces counting as the
+            // oldest; the stalest offers win, and rounds repeat while budget is left
+            auto stalestFace = [&](int i) {
+                const LayerState& st = state(lastSlots[i]);
+                int best = -1;
+                for (int f = 0; f < 6; f++) {
+                    if (!(need[i] & ~granted[i] & (1u << f))) continue;
+                    if (best < 0 || st.lastUpdate[f] < st.lastUpdate[best]) best = f;
+                }
+                return best;
+            };
+            while (budget > 0) {
+                std::vector<std::pair<long long, int>> offers;
+                for (int i : sliced) {
+                    int face = stalestFace(i);
+                    if (face >= 0) offers.push_back({state(lastSlots[i]).lastUpdate[face], i});
+                }
+                if (offers.empty()) break;
+                std::stable_sort(offers.begin(), offers.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                for (const auto& offer : offers) {
+                    if (budget <= 0) break;
+                    granted[offer.second] |= 1u << stalestFace(offer.second);
+                    budget--;
+                }
+            }
+
+            std::vector<FaceWork> work;
+            for (size_t i = 0; i < lastSlots.size(); i++) {
+                if (lastSlots[i] < 0) continue;
+                LayerState& st = state(lastSlots[i]);
+                unsigned int waiting = need[i] & ~granted[i];
+                for (int f = 0; f < 6; f++) {
+                    st.age[f] = 0;
+                    if (!(waiting & (1u << f))) continue;
+                    st.age[f] = st.lastUpdate[f] == NEVER ? -1 : (int)(frame - st.lastUpdate[f]);
+                    stats.pendingFaces++;
+                    stats.maxAge = std::max(stats.maxAge, st.age[f]);
+                }
+                if (!granted[i]) continue;
+                work.push_back({(int)i, lastSlots[i], granted[i] & ~st.staticFaces, granted[i]});
+            }
+            return work;
+        }
+
+        // bookkeeping for the shadow passes, called as they run
+        void markStaticRendered(int slot, unsigned int faces) {
+            state(slot).staticFaces |= faces;
+            stats.staticRenders += std::popcount(faces);
+        }
+        void markComposited(int slot, unsigned int faces, unsigned int dynamicFaces) {
+            LayerState& st = state(slot);
+            st.liveStaticFaces = (st.liveStaticFaces & ~faces) | (faces & ~dynamicFaces);
+            for (int f = 0; f < 6; f++) { if (faces & (1u << f)) st.lastUpdate[f] = frame; }
+            stats.composites += std::popcount(faces);
+        }
+
+        // frames each face of the slot has been waiting for an update, 0 = current, -1 = never drawn
+        const std::array<int, 6>& getFaceAges(int slot) const { return state(slot).age; }
+
+        // binds a framebuffer with just one face layer of a tier array attached, for drawing the
+        // faces one at a time
+        void bindFace(unsigned int texture, int layer, int size) {
+            if (!faceFramebuffer) {
+                glGenFramebuffers(1, &faceFramebuffer);
+                glBindFramebuffer(GL_FRAMEBUFFER, faceFramebuffer);
+                glDrawBuffer(GL_NONE);
+                glReadBuffer(GL_NONE);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, faceFramebuffer);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+            glViewport(0, 0, size, size);
+        }
+
+        unsigned int getTexture(int tier) const { return textures[tier]; }
+        unsigned int getStaticTexture(int tier) const { return staticTextures[tier]; }
+        int getCapacity(int tier) const { return capacity[tier]; }
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct LayerState {
+            unsigned int key = 0;
+            glm::vec3 position = glm::vec3(0.0f);
+            float radius = -1.0f;
+            unsigned int staticFaces = 0;       // cache faces holding this light's static casters
+            unsigned int liveStaticFaces = 0;   // live faces that are untouched copies of the cache
+            std::array<long long, 6> lastUpdate = { NEVER, NEVER, NEVER, NEVER, NEVER, NEVER };
+            std::array<int, 6> age = {};
+        };
+        static constexpr long long NEVER = -1;
+
+        std::array<unsigned int, TIER_COUNT> textures{};
+        std::array<unsigned int, TIER_COUNT> staticTextures{};
+        std::array<std::vector<LayerState>, TIER_COUNT> layerState;
+        std::unordered_map<unsigned int, int> slotByKey;    // last frame's slot of each light
+        unsigned int faceFramebuffer = 0;
+        std::vector<int> lastSlots;
+        std::vector<float> lastScreenRadius;
+        std::vector<float> lastDistance;
+        long long frame = 0;
+        std::array<int, TIER_COUNT> capacity{};
+        float allocatedBudgetMB = -1.0f;
+        Stats stats;
+
+        LayerState& state(int slot) { return layerState[slotTier(slot)][slotLayer(slot)]; }
+        const LayerState& state(int slot) const { return layerState[slotTier(slot)][slotLayer(slot)]; }
+
+        static unsigned int createArray(int size, int layers) {
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, texture);
+            glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_DEPTH_COMPONENT16, size, size, layers * 6);
+            // shaders only ever compare against it, so every fetch is a bilinear 2x2 PCF
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            return texture;
+        }
+
+        // view-space sphere against the four side planes and the near plane
+        static bool sphereInFrustum(const glm::vec3& p, float r, float tanHalfX, float tanHalfY) {
+            float depth = -p.z;
+            if (depth + r < 0.0f) return false;
+            float nx = 1.0f / std::sqrt(1.0f + tanHalfX * tanHalfX);
+            float ny = 1.0f / std::sqrt(1.0f + tanHalfY * tanHalfY);
+            if ((std::abs(p.x) - depth * tanHalfX) * nx > r) return false;
+            if ((std::abs(p.y) - depth * tanHalfY) * ny > r) return false;
+            return true;
+        }
+};
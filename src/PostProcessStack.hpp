@@ -0,0 +1,326 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Shader.hpp"
+#include "RenderGraph.hpp"
+#include "GpuTimer.hpp"
+
+// Post-processing as an ordered list of effects, turned into render graph passes every frame.
+// Runs of adjacent per-pixel effects (tonemap, grading, invert, grayscale) become one pass with a
+// shader generated for exactly that sequence from screenBuffer.frag and cached. Kernel effects
+// get passes of their own: the blur is a separable gaussian with bilinear tap merging, run at
+// full, half or quarter resolution; sharpen and edge detection build their 3x3 kernels from four
+// bilinear fetches. The stack always ends with a per-pixel pass, which writes the output and
+// draws the selection outline. Every pass is GPU timed.
+class PostProcessStack {
+    public:
+        enum EffectType { Tonemap, ColorGrading, Invert, Grayscale, Sharpen, Blur, EdgeDetection, EFFECT_TYPES };
+        static constexpr const char* EFFECT_NAMES[EFFECT_TYPES] = { "Tonemap", "Color Grading", "Invert", "Grayscale", "Sharpen", "Blur", "Edge Detection" };
+        static constexpr int MAX_BLUR_TAPS = 8;     // merged taps either side, matches postBlur.frag
+
+        struct Effect {
+            EffectType type;
+            bool enabled = false;
+            float amount = 1.0f;            // exposure, sharpen/edge strength, or blur sigma in full-res pixels
+            int downsample = 1;             // blur only: 1, 2 or 4
+            int tonemapOperator = 0;        // 0 = Reinhard, 1 = ACES
+            float contrast = 1.0f;
+            float saturation = 1.0f;
+            glm::vec3 colorFilter = glm::vec3(1.0f);
+        };
+
+        // one line of the timing readout: a fused run or a kernel effect with all its passes
+        struct Timing {
+            std::string label;
+            int passes = 0;
+            float ms = 0.0f;
+            bool measured = false;
+        };
+
+        PostProcessStack(){}
+        ~PostProcessStack(){}
+
+        static bool isPerPixel(EffectType type) { return type == Tonemap || type == ColorGrading || type == Invert || type == Grayscale; }
+
+        void init(const std::string& shaderDirectory) {
+            vertexCode = readFile(shaderDirectory + "screenBuffer.vert");
+            fusedTemplate = readFile(shaderDirectory + "screenBuffer.frag");
+            std::string vertexPath = shaderDirectory + "screenBuffer.vert";
+            blurShader = std::make_unique<Shader>(vertexPath.c_str(), (shaderDirectory + "postBlur.frag").c_str());
+            downsampleShader = std::make_unique<Shader>(vertexPath.c_str(), (shaderDirectory + "postDownsample.frag").c_str());
+            kernelShader = std::make_unique<Shader>(vertexPath.c_str(), (shaderDirectory + "postKernel.frag").c_str());
+        }
+
+        // every effect once, all off; the order is the order of application
+        static std::vector<Effect> defaultEffects() {
+            std::vector<Effect> effects;
+            for (int type : { Tonemap, ColorGrading, Sharpen, Blur, EdgeDetection, Invert, Grayscale }) {
+                Effect effect;
+                effect.type = (EffectType)type;
+                if (type == Blur) { effect.amount = 2.0f; effect.downsample = 2; }
+                effects.push_back(effect);
+            }
+            return effects;
+        }
+
+        void destroy() {
+            for (auto& [key, shader] : fusedShaders) { glDeleteProgram(shader.ID); }
+            fusedShaders.clear();
+            for (Shader* shader : { blurShader.get(), downsampleShader.get(), kernelShader.get() }) { if (shader) glDeleteProgram(shader->ID); }
+            blurShader.reset();
+            downsampleShader.reset();
+            kernelShader.reset();
+            for (auto& [name, timer] : timers) { timer.destroy(); }
+            timers.clear();
+        }
+
+        // swap an effect with its neighbour
+        static void move(std::vector<Effect>& effects, int index, int direction) {
+            int other = index + direction;
+            if (index < 0 || other < 0 || index >= (int)effects.size() || other >= (int)effects.size()) return;
+            std::swap(effects[index], effects[other]);
+        }
+
+        // declare the passes applying effects, in order, from input to output (both width x height).
+        // the last pass is per-pixel; finish sets up whatever else it needs (the selection outline)
+        // and extraReads are the graph resources that uses
+        void addPasses(RenderGraph& rg, const std::vector<Effect>& effects, int input, int output, int width, int height, unsigned int quadVAO,
+                       std::function<void(Shader&, RenderGraph::PassContext&)> finish, const std::vector<int>& extraReads) {
+            // group the enabled effects: runs of per-pixel ones fuse, kernels stand alone
+            std::vector<std::vector<Effect>> nodes;
+            for (const Effect& effect : effects) {
+                if (!effect.enabled) continue;
+                bool fuses = isPerPixel(effect.type) && !nodes.empty() && isPerPixel(nodes.back().front().type);
+                if (fuses) { nodes.back().push_back(effect); }
+                else { nodes.push_back({ effect }); }
+            }
+            if (nodes.empty() || !isPerPixel(nodes.back().front().type)) { nodes.push_back({}); }
+
+            timings.clear();
+            timingPasses.clear();
+            int current = input;
+            for (size_t n = 0; n < nodes.size(); n++) {
+                const std::vector<Effect>& node = nodes[n];
+                bool last = n + 1 == nodes.size();
+                if (node.empty() || isPerPixel(node.front().type)) {
+                    std::string label;
+                    for (const Effect& effect : node) { label += (label.empty() ? "" : " + ") + std::string(EFFECT_NAMES[effect.type]); }
+                    if (last) { label += label.empty() ? "Composite" : " + Composite"; }
+                    int target = last ? output : rg.createTexture("Post " + label, {width, height, GL_RGBA16F, 0});
+                    Shader& shader = fusedShader(node);
+                    std::string timerName = "Post " + label;
+                    auto pass = rg.addPass(timerName, [=, this, &shader](RenderGraph::PassContext& ctx) {
+                        GpuTimer& timer = timers[timerName];
+                        timer.begin();
+                        shader.use();
+                        shader.setInt("screenTexture", 0);
+                        shader.setVec2("uvScale", ctx.uvScale(current));
+                        for (const Effect& effect : node) { setEffectUniforms(shader, effect); }
+                        shader.setBool("showSelection", false);
+                        if (last && finish) { finish(shader, ctx); }
+                        drawFullscreen(quadVAO, ctx.texture(current));
+                        timer.end();
+                    });
+                    pass.read(current).write(target, RenderGraph::DontCare);
+                    if (last) { for (int r : extraReads) { pass.read(r); } }
+                    timings.push_back({label, 1});
+                    timingPasses.push_back({timerName});
+                    current = target;
+                } else if (node.front().type == Blur) {
+                    current = addBlurPasses(rg, node.front(), current, width, height, quadVAO);
+                } else {
+                    const Effect effect = node.front();
+                    std::string name = std::string("Post ") + EFFECT_NAMES[effect.type];
+                    int target = rg.createTexture(name, {width, height, GL_RGBA16F, 0});
+                    rg.addPass(name, [=, this](RenderGraph::PassContext& ctx) {
+                        GpuTimer& timer = timers[name];
+                        timer.begin();
+                        kernelShader->use();
+                        kernelShader->setInt("source", 0);
+                        kernelShader->setVec2("uvScale", ctx.uvScale(current));
+                        kernelShader->setVec2("targetSize", (float)width, (float)height);
+                        kernelShader->setInt("mode", effect.type == Sharpen ? 0 : 1);
+                        kernelShader->setFloat("amount", effect.amount);
+                        drawFullscreen(quadVAO, ctx.texture(current));
+                        timer.end();
+                    }).read(current).write(target, RenderGraph::DontCare);
+                    timings.push_back({EFFECT_NAMES[effect.type], 1});
+                    timingPasses.push_back({name});
+                    current = target;
+                }
+            }
+        }
+
+        // per fused run or kernel effect of the last declared stack, summed over its passes
+        std::vector<Timing> getTimings() {
+            for (size_t i = 0; i < timings.size(); i++) {
+                timings[i].ms = 0.0f;
+                timings[i].measured = true;
+                for (const std::string& name : timingPasses[i]) {
+                    GpuTimer& timer = timers[name];
+                    timings[i].ms += timer.getMilliseconds();
+                    timings[i].measured &= timer.hasResult();
+                }
+            }
+            return timings;
+        }
+
+        int getCompiledVariants() const { return (int)fusedShaders.size(); }
+
+        // gaussian weights for sigma (in texels), with neighbouring taps merged into one bilinear
+        // fetch: offset at their weighted centre, weight their sum. returns the merged tap count
+        static int blurKernel(float sigma, float weights[MAX_BLUR_TAPS + 1], float offsets[MAX_BLUR_TAPS + 1]) {
+            sigma = std::max(sigma, 0.5f);
+            int radius = std::clamp((int)std::ceil(3.0f * sigma), 1, 2 * MAX_BLUR_TAPS);
+            std::vector<float> g(radius + 2, 0.0f);
+            float sum = 0.0f;
+            for (int k = 0; k <= radius; k++) {
+                g[k] = std::exp(-(float)(k * k) / (2.0f * sigma * sigma));
+                sum += k == 0 ? g[k] : 2.0f * g[k];
+            }
+            weights[0] = g[0] / sum;
+            offsets[0] = 0.0f;
+            int taps = 0;
+            for (int k = 1; k <= radius; k += 2) {
+                float a = g[k] / sum, b = g[k + 1] / sum;
+                taps++;
+                weights[taps] = a + b;
+                offsets[taps] = (k * a + (k + 1) * b) / (a + b);
+            }
+            return taps;
+        }
+
+    private:
+        std::string vertexCode;
+        std::string fusedTemplate;
+        std::map<std::string, Shader> fusedShaders;     // by effect sequence
+        std::unique_ptr<Shader> blurShader;
+        std::unique_ptr<Shader> downsampleShader;
+        std::unique_ptr<Shader> kernelShader;
+        std::map<std::string, GpuTimer> timers;         // by pass name
+        std::vector<Timing> timings;
+        std::vector<std::vector<std::string>> timingPasses;     // pass names behind each timing
+
+        static std::string readFile(const std::string& path) {
+            std::ifstream file(path);
+            if (!file) {
+                std::cout << "ERROR::POSTPROCESS::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+                return "";
+            }
+            std::stringstream stream;
+            stream << file.rdbuf();
+            return stream.str();
+        }
+
+        static void drawFullscreen(unsigned int quadVAO, unsigned int texture) {
+            glDisable(GL_DEPTH_TEST);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glEnable(GL_DEPTH_TEST);
+        }
+
+        // the variant of screenBuffer.frag applying this run of effects, compiled on first use
+        Shader& fusedShader(const std::vector<Effect>& run) {
+            std::string key;
+            std::string calls;
+            for (const Effect& effect : run) {
+                key += std::to_string(effect.type) + ",";
+                std::string function = EFFECT_NAMES[effect.type];
+                function.erase(std::remove(function.begin(), function.end(), ' '), function.end());
+                calls += "    color = apply" + function + "(color);\n";
+            }
+            auto it = fusedShaders.find(key);
+            if (it != fusedShaders.end()) return it->second;
+            std::string source = fusedTemplate;
+            size_t marker = source.find("    // EFFECTS");
+            if (marker != std::string::npos) { source.insert(marker, calls); }
+            return fusedShaders.emplace(key, Shader::fromSource(vertexCode, source)).first->second;
+        }
+
+        static void setEffectUniforms(Shader& shader, const Effect& effect) {
+            switch (effect.type) {
+                case Tonemap:
+                    shader.setFloat("exposure", effect.amount);
+                    shader.setInt("tonemapOperator", effect.tonemapOperator);
+                    break;
+                case ColorGrading:
+                    shader.setFloat("contrast", effect.contrast);
+                    shader.setFloat("saturation", effect.saturation);
+                    shader.setVec3("colorFilter", effect.colorFilter);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // [downsample,] horizontal, vertical; the next pass samples the result bilinearly, which
+        // upsamples it again. each pass gets its own logical target so the graph sees no cycle,
+        // the pool aliases the downsampled one and the vertical output (same size and format,
+        // disjoint lifetimes) so physically the passes ping-pong between two textures
+        int addBlurPasses(RenderGraph& rg, const Effect& effect, int input, int width, int height, unsigned int quadVAO) {
+            const int factor = std::clamp(effect.downsample, 1, 4);
+            const int w = std::max(1, width / factor), h = std::max(1, height / factor);
+            const std::string suffix = factor == 1 ? "" : " (1/" + std::to_string(factor) + ")";
+            std::vector<std::string> names;
+            int source = input;
+            if (factor > 1) {
+                std::string name = "Post Blur Downsample" + suffix;
+                int downsampled = rg.createTexture(name, {w, h, GL_RGBA16F, 0});
+                rg.addPass(name, [=, this](RenderGraph::PassContext& ctx) {
+                    GpuTimer& timer = timers[name];
+                    timer.begin();
+                    downsampleShader->use();
+                    downsampleShader->setInt("source", 0);
+                    downsampleShader->setVec2("uvScale", ctx.uvScale(input));
+                    downsampleShader->setVec2("targetSize", (float)w, (float)h);
+                    downsampleShader->setFloat("footprint", (float)factor);
+                    drawFullscreen(quadVAO, ctx.texture(input));
+                    timer.end();
+                }).read(input).write(downsampled, RenderGraph::DontCare);
+                names.push_back(name);
+                source = downsampled;
+            }
+            // sigma is given in full-resolution pixels
+            const float sigma = effect.amount / factor;
+            auto blurPass = [&](const std::string& name, int from, int to, glm::vec2 direction) {
+                rg.addPass(name, [=, this](RenderGraph::PassContext& ctx) {
+                    GpuTimer& timer = timers[name];
+                    timer.begin();
+                    float weights[MAX_BLUR_TAPS + 1], offsets[MAX_BLUR_TAPS + 1];
+                    int taps = blurKernel(sigma, weights, offsets);
+                    blurShader->use();
+                    blurShader->setInt("source", 0);
+                    blurShader->setVec2("uvScale", ctx.uvScale(from));
+                    blurShader->setVec2("targetSize", (float)w, (float)h);
+                    blurShader->setVec2("direction", direction);
+                    blurShader->setInt("tapCount", taps);
+                    glUniform1fv(glGetUniformLocation(blurShader->ID, "weights"), taps + 1, weights);
+                    glUniform1fv(glGetUniformLocation(blurShader->ID, "offsets"), taps + 1, offsets);
+                    drawFullscreen(quadVAO, ctx.texture(from));
+                    timer.end();
+                }).read(from).write(to, RenderGraph::DontCare);
+                names.push_back(name);
+            };
+            int horizontal = rg.createTexture("Post Blur Horizontal" + suffix, {w, h, GL_RGBA16F, 0});
+            int vertical = rg.createTexture("Post Blur Vertical" + suffix, {w, h, GL_RGBA16F, 0});
+            blurPass("Post Blur Horizontal" + suffix, source, horizontal, glm::vec2(1.0f, 0.0f));
+            blurPass("Post Blur Vertical" + suffix, horizontal, vertical, glm::vec2(0.0f, 1.0f));
+            timings.push_back({"Blur" + suffix, (int)names.size()});
+            timingPasses.push_back(names);
+            return vertical;
+        }
+};
@@ -0,0 +1,641 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Declarative frame graph. Every frame the renderer declares its passes together with the
+// textures they read and write; compile() then
+//  - orders the passes so each one runs after the passes producing what it reads,
+//  - culls passes that don't (transitively) contribute to an output,
+//  - inserts MSAA resolves in front of passes that sample a multisampled texture,
+//  - clears a target only on its first write of the frame,
+//  - aliases transient textures with matching descriptions and disjoint lifetimes.
+// Physical textures and framebuffers are cached across frames, so rebuilding the graph
+// every frame is cheap. Transient textures are allocated in size buckets with headroom and
+// passes render into the bottom-left sub-rectangle, so resizing the viewport doesn't
+// reallocate anything until a bucket is outgrown (or the size settles well below it).
+class RenderGraph {
+    public:
+        enum LoadOp {
+            DontCare,   // the pass overwrites every pixel
+            Clear,      // the pass expects a cleared target (only cleared on the first write)
+            Load        // the pass builds on the existing contents
+        };
+
+        struct TextureDesc {
+            int width = 0;
+            int height = 0;
+            GLenum format = GL_RGBA8;
+            int samples = 0;
+
+            bool operator==(const TextureDesc& o) const {
+                return width == o.width && height == o.height && format == o.format && samples == o.samples;
+            }
+        };
+
+        struct PassContext {
+            RenderGraph* graph;
+            int pass;
+            unsigned int framebuffer;
+            int width;
+            int height;
+
+            // physical texture for a handle; reads of multisampled textures return the resolved copy
+            unsigned int texture(int handle) const { return graph->textureForRead(pass, handle); }
+            // scale from [0,1] screen uvs to the valid part of a (possibly larger) pooled texture
+            glm::vec2 uvScale(int handle) const { return graph->getUVScale(handle); }
+        };
+
+        class PassBuilder {
+            public:
+                PassBuilder(RenderGraph* g, int p) : graph(g), pass(p) {}
+                PassBuilder& read(int handle) { graph->passes[pass].reads.push_back(handle); return *this; }
+                PassBuilder& write(int handle, LoadOp load = Clear) { graph->passes[pass].writes.push_back({handle, load}); return *this; }
+                // keep the pass (and everything it reads) alive even though nothing reads its outputs
+                PassBuilder& sideEffect() { graph->passes[pass].sideEffect = true; return *this; }
+            private:
+                RenderGraph* graph;
+                int pass;
+        };
+
+        RenderGraph(){}
+        ~RenderGraph(){}
+
+        // MARK: declaration
+        void beginFrame() {
+            passes.clear();
+            resources.clear();
+            order.clear();
+            finalResolves.clear();
+            frame++;
+        }
+
+        int createTexture(const std::string& name, const TextureDesc& desc) {
+            Resource r;
+            r.name = name;
+            r.desc = desc;
+            resources.push_back(r);
+            return (int)resources.size() - 1;
+        }
+
+        int importTexture(const std::string& name, unsigned int texture, GLenum target, int width, int height, GLenum format) {
+            Resource r;
+            r.name = name;
+            r.desc = {width, height, format, 0};
+            r.target = target;
+            r.physical = texture;
+            r.physicalWidth = width;
+            r.physicalHeight = height;
+            r.imported = true;
+            resources.push_back(r);
+            return (int)resources.size() - 1;
+        }
+
+        // the default framebuffer; passes writing it render straight to the window
+        int importBackbuffer(int width, int height) {
+            int handle = importTexture("Backbuffer", 0, GL_NONE, width, height, GL_RGBA8);
+            resources[handle].backbuffer = true;
+            return handle;
+        }
+
+        PassBuilder addPass(const std::string& name, std::function<void(PassContext&)> execute) {
+            Pass p;
+            p.name = name;
+            p.execute = std::move(execute);
+            passes.push_back(std::move(p));
+            return PassBuilder(this, (int)passes.size() - 1);
+        }
+
+        // textures consumed outside the graph (e.g. by ImGui) after execute()
+        void markOutput(int handle) { resources[handle].output = true; }
+
+        // MARK: compile
+        void compile() {
+            orderPasses();
+            cullPasses();
+            planResolvesAndClears();
+            computeLifetimes();
+            assignPhysicalTextures();
+        }
+
+        // MARK: execute
+        void execute() {
+            for (int p : order) {
+                Pass& pass = passes[p];
+                if (pass.culled) continue;
+
+                for (int r : pass.resolves) { resolve(r); }
+
+                PassContext ctx{this, p, 0, 0, 0};
+                bindTargets(pass, ctx);
+                pass.execute(ctx);
+            }
+            for (int r : finalResolves) { resolve(r); }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            releaseUnused();
+        }
+
+        // physical texture of a handle after execute(); outputs are resolved if needed
+        unsigned int getTexture(int handle) const {
+            const Resource& r = resources[handle];
+            if (r.resolved >= 0) return resources[r.resolved].physical;
+            return r.physical;
+        }
+
+        // fraction of the physical texture covered by the declared size
+        glm::vec2 getUVScale(int handle) const {
+            const Resource& r = resources[handle].resolved >= 0 ? resources[resources[handle].resolved] : resources[handle];
+            if (r.physicalWidth <= 0 || r.physicalHeight <= 0) return glm::vec2(1.0f);
+            return glm::vec2((float)r.desc.width / r.physicalWidth, (float)r.desc.height / r.physicalHeight);
+        }
+
+        // MARK: statistics
+        struct Stats {
+            int passes = 0;
+            int culledPasses = 0;
+            int clears = 0;
+            int resolves = 0;
+            int transientTextures = 0;
+            int physicalTextures = 0;
+            size_t bytesWithoutAliasing = 0;   // every transient at its declared size
+            size_t bytesAllocated = 0;         // pooled textures this frame, bucket headroom included
+            unsigned int reallocations = 0;    // physical textures created since startup
+        };
+
+        Stats getStats() const {
+            Stats s;
+            s.passes = (int)passes.size();
+            std::vector<unsigned int> used;
+            for (const Pass& pass : passes) {
+                if (pass.culled) { s.culledPasses++; continue; }
+                s.resolves += (int)pass.resolves.size();
+                for (const Write& w : pass.writes) { if (w.clear) s.clears++; }
+            }
+            s.resolves += (int)finalResolves.size();
+            for (const Resource& r : resources) {
+                if (r.imported || r.firstUse == INT_MAX) continue;
+                s.transientTextures++;
+                s.bytesWithoutAliasing += byteSize(r.desc);
+                if (std::find(used.begin(), used.end(), r.physical) == used.end()) {
+                    used.push_back(r.physical);
+                    TextureDesc allocated = r.desc;
+                    allocated.width = r.physicalWidth;
+                    allocated.height = r.physicalHeight;
+                    s.bytesAllocated += byteSize(allocated);
+                }
+            }
+            s.physicalTextures = (int)used.size();
+            s.reallocations = allocations;
+            return s;
+        }
+
+        // pass names in execution order, with culled passes flagged
+        std::vector<std::pair<std::string, bool>> getPassList() const {
+            std::vector<std::pair<std::string, bool>> list;
+            for (int p : order) { list.push_back({passes[p].name, passes[p].culled}); }
+            return list;
+        }
+
+        // free every cached texture and framebuffer
+        void destroy() {
+            for (auto& [key, fbo] : framebufferCache) { glDeleteFramebuffers(1, &fbo); }
+            framebufferCache.clear();
+            for (Physical& ph : pool) { glDeleteTextures(1, &ph.texture); }
+            pool.clear();
+            if (resolveFramebuffers[0]) { glDeleteFramebuffers(2, resolveFramebuffers); }
+            resolveFramebuffers[0] = resolveFramebuffers[1] = 0;
+        }
+
+        static bool isDepthFormat(GLenum format) {
+            return format == GL_DEPTH_COMPONENT || format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 ||
+                   format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+        }
+
+        static bool isIntegerFormat(GLenum format) {
+            return format == GL_R32UI || format == GL_RG32UI || format == GL_RGBA32UI || format == GL_R32I || format == GL_R16UI;
+        }
+
+        static size_t bytesPerPixel(GLenum format) {
+            switch (format) {
+                case GL_R8: return 1;
+                case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: case GL_R16UI: return 2;
+                case GL_RGB8: case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_R32UI: case GL_R32I: case GL_R32F:
+                case GL_RG16F: case GL_RGB10_A2: case GL_R11F_G11F_B10F: case GL_DEPTH24_STENCIL8:
+                case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F: case GL_DEPTH_COMPONENT: return 4;
+                case GL_RGBA16F: case GL_RG32F: case GL_RG32UI: case GL_DEPTH32F_STENCIL8: return 8;
+                case GL_RGBA32F: case GL_RGBA32UI: return 16;
+                default: return 4;
+            }
+        }
+
+        static size_t byteSize(const TextureDesc& d) {
+            return bytesPerPixel(d.format) * (size_t)d.width * d.height * std::max(1, d.samples);
+        }
+
+    private:
+        struct Write {
+            int resource;
+            LoadOp load;
+            bool clear = false;     // decided in compile: first write of the frame that asked for a clear
+        };
+
+        struct Pass {
+            std::string name;
+            std::function<void(PassContext&)> execute;
+            std::vector<int> reads;
+            std::vector<Write> writes;
+            std::vector<int> resolves;  // multisampled resources to resolve before this pass runs
+            bool sideEffect = false;
+            bool culled = false;
+        };
+
+        struct Resource {
+            std::string name;
+            TextureDesc desc;
+            GLenum target = GL_TEXTURE_2D;
+            unsigned int physical = 0;
+            int physicalWidth = 0;      // allocated size, >= desc size for pooled textures
+            int physicalHeight = 0;
+            bool imported = false;
+            bool backbuffer = false;
+            bool output = false;
+            int resolved = -1;          // single-sampled copy of a multisampled resource
+            int firstUse = INT_MAX;
+            int lastUse = -1;
+        };
+
+        struct Physical {
+            unsigned int texture;
+            TextureDesc desc;           // bucketed size
+            int busyUntil;              // last pass position using it this frame
+            unsigned int lastFrame;     // last frame it was assigned
+        };
+
+        std::vector<Pass> passes;
+        std::vector<Resource> resources;
+        std::vector<int> order;
+        std::vector<int> finalResolves;
+
+        std::vector<Physical> pool;
+        std::map<std::vector<unsigned int>, unsigned int> framebufferCache;
+        unsigned int resolveFramebuffers[2] = {0, 0};
+        unsigned int frame = 0;
+        unsigned int allocations = 0;
+
+        // viewport-size tracking for shrinking the buckets once a resize has finished
+        int lastWidth = 0;
+        int lastHeight = 0;
+        unsigned int stableFrames = 0;
+
+        static constexpr unsigned int RELEASE_AFTER_FRAMES = 3;
+        static constexpr int BUCKET_STEP = 128;             // bucket granularity in pixels
+        static constexpr float BUCKET_HEADROOM = 0.25f; // grow past the request so a drag fits in one bucket
+        static constexpr unsigned int SHRINK_AFTER_FRAMES = 60;
+
+        static int bucketSize(int size) {
+            int padded = (int)(size * (1.0f + BUCKET_HEADROOM));
+            return std::max(BUCKET_STEP, (padded + BUCKET_STEP - 1) / BUCKET_STEP * BUCKET_STEP);
+        }
+
+        bool passWrites(const Pass& pass, int resource) const {
+            for (const Write& w : pass.writes) { if (w.resource == resource) return true; }
+            return false;
+        }
+
+        bool passReads(const Pass& pass, int resource) const {
+            return std::find(pass.reads.begin(), pass.reads.end(), resource) != pass.reads.end();
+        }
+
+        // stable topological sort: a reader runs after every writer of what it reads,
+        // writers of the same resource keep their declaration order
+        void orderPasses() {
+            const int n = (int)passes.size();
+            std::vector<std::vector<int>> edges(n);
+            std::vector<int> inDegree(n, 0);
+            auto addEdge = [&](int from, int to) {
+                if (std::find(edges[from].begin(), edges[from].end(), to) != edges[from].end()) return;
+                edges[from].push_back(to);
+                inDegree[to]++;
+            };
+            for (int a = 0; a < n; a++) {
+                for (int b = 0; b < n; b++) {
+                    if (a == b) continue;
+                    for (const Write& w : passes[a].writes) {
+                        bool bReads = passReads(passes[b], w.resource);
+                        bool bWrites = passWrites(passes[b], w.resource);
+                        if (bReads && !bWrites) { addEdge(a, b); }
+                        else if (bWrites && a < b) { addEdge(a, b); }
+                    }
+                }
+            }
+
+            std::vector<int> ready;
+            for (int i = 0; i < n; i++) { if (inDegree[i] == 0) ready.push_back(i); }
+            while (!ready.empty()) {
+                auto it = std::min_element(ready.begin(), ready.end());
+                int p = *it;
+                ready.erase(it);
+                order.push_back(p);
+                for (int next : edges[p]) { if (--inDegree[next] == 0) ready.push_back(next); }
+            }
+            if ((int)order.size() != n) {
+                std::cout << "ERROR::RENDERGRAPH:: dependency cycle, falling back to declaration order" << std::endl;
+                order.clear();
+                for (int i = 0; i < n; i++) order.push_back(i);
+            }
+        }
+
+        // walk backwards from the outputs and side-effect passes, keeping the passes they need
+        void cullPasses() {
+            std::vector<bool> needed(resources.size(), false);
+            for (size_t r = 0; r < resources.size(); r++) { needed[r] = resources[r].output; }
+            for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                Pass& pass = passes[*it];
+                bool keep = pass.sideEffect;
+                for (const Write& w : pass.writes) { if (needed[w.resource]) keep = true; }
+                pass.culled = !keep;
+                if (!keep) continue;
+                for (int r : pass.reads) { needed[r] = true; }
+                for (const Write& w : pass.writes) { if (w.load == Load) needed[w.resource] = true; }
+            }
+        }
+
+        void planResolvesAndClears() {
+            std::vector<bool> written(resources.size(), false);
+            std::vector<bool> dirty(resources.size(), false);   // multisampled and written since its last resolve
+            for (int p : order) {
+                Pass& pass = passes[p];
+                pass.resolves.clear();
+                if (pass.culled) continue;
+                for (int r : pass.reads) {
+                    if (resources[r].desc.samples > 0 && dirty[r]) {
+                        ensureResolveTarget(r);
+                        pass.resolves.push_back(r);
+                        dirty[r] = false;
+                    }
+                }
+                for (Write& w : pass.writes) {
+                    w.clear = (w.load == Clear) && !written[w.resource];
+                    written[w.resource] = true;
+                    if (resources[w.resource].desc.samples > 0) dirty[w.resource] = true;
+                }
+            }
+            // outputs are handed over resolved, after the last pass
+            finalResolves.clear();
+            const size_t declared = resources.size();
+            for (size_t r = 0; r < declared; r++) {
+                if (resources[r].output && dirty[r]) {
+                    ensureResolveTarget((int)r);
+                    finalResolves.push_back((int)r);
+                }
+            }
+        }
+
+        void ensureResolveTarget(int r) {
+            if (resources[r].resolved >= 0) return;
+            TextureDesc desc = resources[r].desc;
+            desc.samples = 0;
+            int handle = createTexture(resources[r].name + " (resolved)", desc);
+            resources[r].resolved = handle;
+            resources[handle].output = resources[r].output;
+        }
+
+        void computeLifetimes() {
+            int position = 0;
+            for (int p : order) {
+                Pass& pass = passes[p];
+                if (pass.culled) continue;
+                auto use = [&](int r) {
+                    resources[r].firstUse = std::min(resources[r].firstUse, position);
+                    resources[r].lastUse = std::max(resources[r].lastUse, position);
+                };
+                for (int r : pass.resolves) { use(r); use(resources[r].resolved); }
+                for (int r : pass.reads) { use(r); if (resources[r].resolved >= 0) use(resources[r].resolved); }
+                for (const Write& w : pass.writes) { use(w.resource); }
+                position++;
+            }
+            for (int r : finalResolves) {
+                resources[r].lastUse = std::max(resources[r].lastUse, position);
+                int resolved = resources[r].resolved;
+                resources[resolved].firstUse = std::min(resources[resolved].firstUse, position);
+            }
+            for (Resource& r : resources) {
+                if (r.output && r.firstUse != INT_MAX) r.lastUse = INT_MAX;
+            }
+        }
+
+        // greedy interval allocation: reuse the smallest pooled texture of the same format that is
+        // big enough and whose previous user is already dead, otherwise create one at bucket size.
+        // oversized textures keep being reused while the viewport is changing; once it has been
+        // stable for a while they're skipped, go unused and get released.
+        void assignPhysicalTextures() {
+            for (Physical& ph : pool) { ph.busyUntil = -1; }
+            std::vector<int> transient;
+            int width = 0, height = 0;
+            for (size_t r = 0; r < resources.size(); r++) {
+                if (!resources[r].imported && resources[r].firstUse != INT_MAX) {
+                    transient.push_back((int)r);
+                    width = std::max(width, resources[r].desc.width);
+                    height = std::max(height, resources[r].desc.height);
+                }
+            }
+            if (width != lastWidth || height != lastHeight) { stableFrames = 0; }
+            else { stableFrames++; }
+            lastWidth = width;
+            lastHeight = height;
+            const bool allowShrink = stableFrames >= SHRINK_AFTER_FRAMES;
+            std::stable_sort(transient.begin(), transient.end(), [&](int a, int b) { return resources[a].firstUse < resources[b].firstUse; });
+
+            for (int r : transient) {
+                Resource& res = resources[r];
+                TextureDesc bucket = res.desc;
+                bucket.width = bucketSize(res.desc.width);
+                bucket.height = bucketSize(res.desc.height);
+                Physical* match = nullptr;
+                for (Physical& ph : pool) {
+                    if (ph.desc.format != res.desc.format || ph.desc.samples != res.desc.samples) continue;
+                    if (ph.busyUntil >= res.firstUse) continue;
+                    if (ph.desc.width < res.desc.width || ph.desc.height < res.desc.height) continue;
+                    if (allowShrink && (ph.desc.width > bucket.width || ph.desc.height > bucket.height)) continue;
+                    if (!match || (size_t)ph.desc.width * ph.desc.height < (size_t)match->desc.width * match->desc.height) { match = &ph; }
+                }
+                if (!match) {
+                    pool.push_back({createPhysical(bucket), bucket, -1, frame});
+                    match = &pool.back();
+                }
+                match->busyUntil = res.lastUse;
+                match->lastFrame = frame;
+                res.physical = match->texture;
+                res.physicalWidth = match->desc.width;
+                res.physicalHeight = match->desc.height;
+                res.target = res.desc.samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+            }
+        }
+
+        unsigned int createPhysical(const TextureDesc& desc) {
+            allocations++;
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            if (desc.samples > 0) {
+                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
+                glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.format, desc.width, desc.height, GL_TRUE);
+                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+            } else {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexStorage2D(GL_TEXTURE_2D, 1, desc.format, desc.width, desc.height);
+                GLenum filter = (isIntegerFormat(desc.format) || isDepthFormat(desc.format)) ? GL_NEAREST : GL_LINEAR;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+            return texture;
+        }
+
+        // textures that weren't part of a frame for a while (old sizes after a resize, disabled features)
+        void releaseUnused() {
+            for (size_t i = 0; i < pool.size();) {
+                if (frame - pool[i].lastFrame > RELEASE_AFTER_FRAMES) {
+                    forgetFramebuffersUsing(pool[i].texture);
+                    glDeleteTextures(1, &pool[i].texture);
+                    pool.erase(pool.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        void forgetFramebuffersUsing(unsigned int texture) {
+            for (auto it = framebufferCache.begin(); it != framebufferCache.end();) {
+                if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+                    glDeleteFramebuffers(1, &it->second);
+                    it = framebufferCache.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        unsigned int textureForRead(int pass, int handle) const {
+            (void)pass;
+            const Resource& r = resources[handle];
+            if (r.resolved >= 0) return resources[r.resolved].physical;
+            return r.physical;
+        }
+
+        // MARK: framebuffers
+        unsigned int framebufferFor(const std::vector<int>& colors, int depth) {
+            std::vector<unsigned int> key;
+            for (int c : colors) key.push_back(resources[c].physical);
+            key.push_back(depth >= 0 ? resources[depth].physical : 0);
+
+            auto it = framebufferCache.find(key);
+            if (it != framebufferCache.end()) return it->second;
+
+            unsigned int fbo;
+            glGenFramebuffers(1, &fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            std::vector<GLenum> drawBuffers;
+            for (size_t i = 0; i < colors.size(); i++) {
+                glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (GLenum)i, resources[colors[i]].physical, 0);
+                drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+            }
+            if (depth >= 0) {
+                GLenum format = resources[depth].desc.format;
+                GLenum attachment = (format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+                glFramebufferTexture(GL_FRAMEBUFFER, attachment, resources[depth].physical, 0);
+            }
+            if (drawBuffers.empty()) {
+                glDrawBuffer(GL_NONE);
+                glReadBuffer(GL_NONE);
+            } else {
+                glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+            }
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "ERROR::RENDERGRAPH:: Framebuffer is not complete!" << std::endl;
+            }
+            framebufferCache[key] = fbo;
+            return fbo;
+        }
+
+        void bindTargets(const Pass& pass, PassContext& ctx) {
+            std::vector<int> colors;
+            int depth = -1;
+            bool backbuffer = false;
+            for (const Write& w : pass.writes) {
+                const Resource& r = resources[w.resource];
+                if (r.backbuffer) { backbuffer = true; }
+                else if (isDepthFormat(r.desc.format)) { depth = w.resource; }
+                else { colors.push_back(w.resource); }
+            }
+            if (pass.writes.empty()) return;
+
+            const Resource& first = resources[pass.writes.front().resource];
+            ctx.width = first.desc.width;
+            ctx.height = first.desc.height;
+            ctx.framebuffer = backbuffer ? 0 : framebufferFor(colors, depth);
+            glBindFramebuffer(GL_FRAMEBUFFER, ctx.framebuffer);
+            glViewport(0, 0, ctx.width, ctx.height);
+
+            // clears ignore the scissor but respect write masks
+            bool anyClear = false;
+            for (const Write& w : pass.writes) anyClear |= w.clear;
+            if (!anyClear) return;
+            glDisable(GL_SCISSOR_TEST);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthMask(GL_TRUE);
+            glStencilMask(0xFF);
+            int colorIndex = 0;
+            for (const Write& w : pass.writes) {
+                const Resource& r = resources[w.resource];
+                bool isDepth = !r.backbuffer && isDepthFormat(r.desc.format);
+                if (w.clear) {
+                    if (r.backbuffer) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+                    } else if (isDepth) {
+                        if (r.desc.format == GL_DEPTH24_STENCIL8 || r.desc.format == GL_DEPTH32F_STENCIL8) {
+                            glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+                        } else {
+                            const float one = 1.0f;
+                            glClearBufferfv(GL_DEPTH, 0, &one);
+                        }
+                    } else if (isIntegerFormat(r.desc.format)) {
+                        const GLuint zero[4] = {0, 0, 0, 0};
+                        glClearBufferuiv(GL_COLOR, colorIndex, zero);
+                    } else {
+                        const float black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                        glClearBufferfv(GL_COLOR, colorIndex, black);
+                    }
+                }
+                if (!isDepth && !r.backbuffer) colorIndex++;
+            }
+        }
+
+        void resolve(int r) {
+            if (!resolveFramebuffers[0]) glGenFramebuffers(2, resolveFramebuffers);
+            const Resource& src = resources[r];
+            const Resource& dst = resources[src.resolved];
+            bool isDepth = isDepthFormat(src.desc.format);
+            GLenum attachment = isDepth ? GL_DEPTH_STENCIL_ATTACHMENT : GL_COLOR_ATTACHMENT0;
+            if (isDepth && src.desc.format != GL_DEPTH24_STENCIL8 && src.desc.format != GL_DEPTH32F_STENCIL8) attachment = GL_DEPTH_ATTACHMENT;
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffers[0]);
+            glFramebufferTexture(GL_READ_FRAMEBUFFER, attachment, src.physical, 0);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffers[1]);
+            glFramebufferTexture(GL_DRAW_FRAMEBUFFER, attachment, dst.physical, 0);
+            glBlitFramebuffer(0, 0, src.desc.width, src.desc.height, 0, 0, dst.desc.width, dst.desc.height,
+                              isDepth ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glFramebufferTexture(GL_READ_FRAMEBUFFER, attachment, 0, 0);
+            glFramebufferTexture(GL_DRAW_FRAMEBUFFER, attachment, 0, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+};
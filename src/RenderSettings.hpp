@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+
+#include "CascadedShadowMaps.hpp"
+#include "DynamicResolution.hpp"
+#include "PostProcessStack.hpp"
+
+// how point shadow faces are rasterised; all three produce the same maps. the geometry shader
+// copies each triangle to every face, layered instancing draws one instance per face and sets
+// gl_Layer in the vertex shader (ARB_shader_viewport_layer_array), and the fallback draws each
+// face separately into a single-layer framebuffer
+enum PointShadowMethod { GeometryShaderFaces, LayeredInstancing, PerFacePasses, POINT_SHADOW_METHODS };
+
+// depth pre-pass: lay down depth first so the main pass only shades visible fragments
+enum DepthPrePassMode { PrePassOff, PrePassOn, PrePassAuto };
+
+// render path: forward shades every object as it is rasterised, deferred writes a compact
+// G-buffer and lights each pixel once in a fullscreen pass, visibility only rasterises triangle
+// ids and rebuilds that G-buffer from the mesh data in one fullscreen pass
+enum RenderPath { ForwardPath, DeferredPath, VisibilityPath };
+
+// anti-aliasing: 4x MSAA while rasterising (forward only), or a pass over the finished scene
+// colour. FXAA and SMAA 1x only look at the image; TAA jitters the projection every frame and
+// accumulates the samples over time through a motion vector target
+enum AntiAliasing { NoAA, MSAA, FXAA, SMAA, TAA, AA_MODES };
+
+// Everything the debug UI can change about how a frame is drawn. The main thread owns one copy
+// and edits it; every snapshot carries its own copy to the render thread, which reads nothing
+// else, so a frame and the jobs it runs see one consistent set however often they look.
+struct RenderSettings {
+    // MARK: lighting
+    bool useDiffuse = true;
+    bool useSpecular = true;
+    bool useAmbient = true;
+    bool useFlashlight = false;
+    bool useDirectionalLight = true;
+    bool usePointLight = true;
+    bool useBlinn = true;
+    bool gammaCorrection = true;
+    float flashlightIntensity = 1.0f;
+    float directionLightIntensity = 0.1f;
+    float pointLightIntensity = 1.0f;
+    float pointLightRadius = 25.0;
+    float exposure = 1.0;
+    unsigned int currSkybox = 0;
+
+    // MARK: shadows
+    bool useShadows = true;
+    bool useSmoothShadows = true;
+    bool useNormalMaps = true;
+    float shadowFactor = 0.4;
+    float shadowBias = 0.05;
+    float dirShadowBias = 0.0;
+    int shadowItem = 4;
+    // static casters are rendered once per light into a cache and only the dynamic ones are drawn
+    // over a copy of it each frame
+    bool useShadowCaching = true;
+    CascadedShadowMaps::Settings cascades;
+    bool showCascades = false;                  // tint the scene by cascade
+    int cascadeViewLayer = 0;                   // cascade shown by the depth map view
+    float pointShadowBudgetMB = 128.0f;
+    int pointShadowFaceBudget = 24;             // cube faces rendered per frame, at least one cube
+    int pointShadowMethod = GeometryShaderFaces;
+
+    // MARK: debug views
+    bool showDepthBuffer = false;
+    bool wireFrame = false;
+    bool showDepthMap = false;
+
+    // MARK: clustered lighting
+    bool useClusteredLighting = true;
+    bool showClusterHeatmap = false;
+    int lightSwarmCount = 0;                    // extra lights for stress testing
+    float lightSwarmRadius = 3.0f;
+
+    // MARK: picking
+    bool useObjectIDPicking = true;
+    bool showSelectionOutline = true;
+
+    // MARK: occlusion
+    bool useOcclusionCulling = true;
+    bool useOcclusionQueries = false;
+    int occlusionCheckInterval = 8;             // frames between queries on visible objects
+
+    // MARK: depth pre-pass
+    int depthPrePassMode = PrePassAuto;
+    float overdrawEnableThreshold = 1.5f;       // auto mode turns the pre-pass on above this...
+    float overdrawDisableThreshold = 1.2f;      // ...and off again below this
+
+    // MARK: path, anti-aliasing and post-processing
+    int renderPath = ForwardPath;
+    int antiAliasing = MSAA;
+    float taaFeedback = 0.9f;                   // share of the TAA history kept each frame
+    std::vector<PostProcessStack::Effect> postEffects = PostProcessStack::defaultEffects();   // in the order they are applied
+    DynamicResolution::Settings dynamicResolution;
+};
@@ -7,6 +7,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtc/matrix_access.hpp>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <imGui/imgui.h>
@@ -22,6 +23,9 @@
 #include <cstring>
 #include <format>
 #include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <thread>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -42,6 +46,16 @@ static unsigned int cubemapTextureNight;
 static unsigned int cubemapTextureSpace1;
 static unsigned int cubemapTextureSpace2;
 
+// true if the current context advertises the extension
+static bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+    }
+    return false;
+}
+
 //UI State Machine
 struct UIState {
     Object* selected = nullptr;
@@ -49,6 +63,7 @@ struct UIState {
     char    filter[64] = "";
     char    nameBuf[256] = {};
     Object* nameBufOwner = nullptr;
+    std::vector<unsigned int> selectedIDs;  // every selected object, including rectangle selections
 } ui;
 
 //MARK: Render
@@ -59,38 +74,68 @@ void Renderer::Render(GLFWwindow* window, Camera* camera, Controller* controller
     Shader pointlightcube("../src/shaders/pointlightcube.vert", "../src/shaders/pointlightcube.frag");
     Shader transparentShader("../src/shaders/transparent.vert", "../src/shaders/transparent.frag");
     Shader grassShader("../src/shaders/grass.vert", "../src/shaders/grass.frag");
-    Shader screenShader("../src/shaders/screenBuffer.vert", "../src/shaders/screenBuffer.frag");
     Shader skyboxShader("../src/shaders/skybox.vert", "../src/shaders/skybox.frag");
     Shader reflectiveShader("../src/shaders/reflectiveCubemap.vert", "../src/shaders/reflectiveCubemap.frag");
     Shader normalShader("../src/shaders/normals.vert", "../src/shaders/normals.frag",  "../src/shaders/normals.geom");
     Shader depthShader("../src/shaders/depthShader.vert", "../src/shaders/depthShader.frag");
     Shader depthTestShader("../src/shaders/depthTestShader.vert", "../src/shaders/depthTestShader.frag");
+    Shader shadowMomentsShader("../src/shaders/screenBuffer.vert", "../src/shaders/shadowMoments.frag");
+    Shader shadowBlurShader("../src/shaders/screenBuffer.vert", "../src/shaders/shadowBlur.frag");
     Shader pointDepthShader("../src/shaders/pointDepthShader.vert", "../src/shaders/pointDepthShader.frag", "../src/shaders/pointDepthShader.geom");
+    Shader pointDepthFaceShader("../src/shaders/pointDepthFace.vert", "../src/shaders/pointDepthShader.frag");
+    // writing gl_Layer from the vertex shader needs the extension, the shader won't compile without it
+    hasVertexLayer = hasExtension("GL_ARB_shader_viewport_layer_array");
+    std::unique_ptr<Shader> pointDepthLayeredShader;
+    if (hasVertexLayer) {
+        pointDepthLayeredShader = std::make_unique<Shader>("../src/shaders/pointDepthLayered.vert", "../src/shaders/pointDepthShader.frag");
+        settings.pointShadowMethod = LayeredInstancing;
+    }
+    PointDepthShaders pointDepthShaders = { &pointDepthShader, pointDepthLayeredShader.get(), &pointDepthFaceShader };
     Shader normalMapShader("../src/shaders/normalMap.vert", "../src/shaders/normalMap.frag");
     Shader parallaxShader("../src/shaders/parallaxMapping.vert", "../src/shaders/parallaxMapping.frag");
+    Shader depthPrePassShader("../src/shaders/depthPrePass.vert", "../src/shaders/depthPrePass.frag");
+    Shader gBufferShader("../src/shaders/gBuffer.vert", "../src/shaders/gBuffer.frag");
+    Shader deferredLightingShader("../src/shaders/screenBuffer.vert", "../src/shaders/deferredLighting.frag");
+    Shader visibilityShader("../src/shaders/visibility.vert", "../src/shaders/visibility.frag");
+    Shader visibilityResolveShader("../src/shaders/screenBuffer.vert", "../src/shaders/visibilityResolve.frag");
+    Shader fxaaShader("../src/shaders/screenBuffer.vert", "../src/shaders/fxaa.frag");
+    Shader upscaleShader("../src/shaders/screenBuffer.vert", "../src/shaders/upscale.frag");
+    Shader upscaleSharpenShader("../src/shaders/screenBuffer.vert", "../src/shaders/upscaleSharpen.frag");
+    postStack.init("../src/shaders/");
+    Shader smaaEdgesShader("../src/shaders/screenBuffer.vert", "../src/shaders/smaaEdges.frag");
+    Shader smaaWeightsShader("../src/shaders/screenBuffer.vert", "../src/shaders/smaaWeights.frag");
+    Shader smaaBlendShader("../src/shaders/screenBuffer.vert", "../src/shaders/smaaBlend.frag");
+    Shader cameraMotionShader("../src/shaders/screenBuffer.vert", "../src/shaders/cameraMotion.frag");
+    Shader motionVectorShader("../src/shaders/motionVectors.vert", "../src/shaders/motionVectors.frag");
+    Shader taaResolveShader("../src/shaders/screenBuffer.vert", "../src/shaders/taaResolve.frag");
 
 
     //create game objects
+    // every model is imported by a job; the GL uploads run here while the wait below goes on
     objects.clear();
+    JobSystem::Counter modelsLoaded;
+    stbi_set_flip_vertically_on_load(1);    // the import jobs only read it
 
-    auto Spawn = [&](Shader* sh, auto&&... args) -> Object* {
-        objects.push_back(std::make_unique<Object>(sh, std::forward<decltype(args)>(args)...));
+    auto Spawn = [&](Shader* sh, const std::string& path, const std::string& name, glm::vec3 pos, glm::vec3 scale = glm::vec3(1.0f),
+                     glm::quat rot = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), bool light = false) -> Object* {
+        objects.push_back(std::make_unique<Object>(sh, path, name, pos, scale, rot, light, &jobs, &modelsLoaded));
         return objects.back().get();
     };
     Spawn(&objectShader, "../models/stormtrooper/stormtrooper.obj", "Stormtrooper", glm::vec3(4.0f, -0.9f, -2.5f));
     Spawn(&objectShader, "../models/backpack/backpack.obj", "backpack", glm::vec3(-9.5f, 0.1f, 1.5f), glm::vec3(0.5f));
-    Spawn(&objectShader, "../models/brick_wall/brick_wall.obj", "Brick Wall", glm::vec3(-7.5f, 0.5f, -3.5f), glm::vec3(0.1f));
-    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "floor", glm::vec3(0.0f, -1.0f, 0.0f));
+    Spawn(&objectShader, "../models/brick_wall/brick_wall.obj", "Brick Wall", glm::vec3(-7.5f, 0.5f, -3.5f), glm::vec3(0.1f))->setOccluder(true);
+    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "floor", glm::vec3(0.0f, -1.0f, 0.0f))->setOccluder(true);
     Spawn(&reflectiveShader, "../models/stormtrooper/stormtrooper.obj", "Reflective ST", glm::vec3(2.0f, 0.0f, 2.0f));
-    Spawn(&parallaxShader, "../models/parallax_wall/parallax.obj", "Parallax Wall", glm::vec3(-14.5f, 0.5f, -3.5f), glm::vec3(0.1f));
+    Spawn(&parallaxShader, "../models/parallax_wall/parallax.obj", "Parallax Wall", glm::vec3(-14.5f, 0.5f, -3.5f), glm::vec3(0.1f))->setOccluder(true);
     Spawn(&parallaxShader, "../models/parallax_toy/parallax.obj", "Parallax Toy", glm::vec3(-0.5f, 0.5f, -3.5f), glm::vec3(0.1f));
-    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallLeft", glm::vec3(14.0f, 1.0f, -0.3f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), false);
-    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallRight", glm::vec3(18.0f, 1.0f, -0.3f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), false);
-    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallTop", glm::vec3(16.0f, 3.0f, -0.3f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 0.0f)), false);
-    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallBack", glm::vec3(16.0f, 3.0f, -17.0f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(90.0f, 0.0f, 0.0f)), false);
-    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallTest", glm::vec3(0.0f, 1.0f, -15.0f), glm::vec3(0.25f, 0.25f, 0.25f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), false);
+    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallLeft", glm::vec3(14.0f, 1.0f, -0.3f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), false)->setOccluder(true);
+    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallRight", glm::vec3(18.0f, 1.0f, -0.3f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), false)->setOccluder(true);
+    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallTop", glm::vec3(16.0f, 3.0f, -0.3f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 0.0f)), false)->setOccluder(true);
+    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallBack", glm::vec3(16.0f, 3.0f, -17.0f), glm::vec3(0.1f, 0.1f, 1.0f), eulerDegreesToQuat(glm::vec3(90.0f, 0.0f, 0.0f)), false)->setOccluder(true);
+    Spawn(&objectShader, "../models/wood_floor/wood_floor.obj", "WallTest", glm::vec3(0.0f, 1.0f, -15.0f), glm::vec3(0.25f, 0.25f, 0.25f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), false)->setOccluder(true);
     Spawn(&objectShader, "../models/box/cube.obj", "Light 1", glm::vec3(-10.0f, 4.0f, -15.0f), glm::vec3(0.2f, 0.2f, 0.2f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), true);
     Spawn(&objectShader, "../models/box/cube.obj", "Light 2", glm::vec3(5.0f, 4.0f, -15.0f), glm::vec3(0.2f, 0.2f, 0.2f), eulerDegreesToQuat(glm::vec3(0.0f, 0.0f, 90.0f)), true);
+    jobs.wait(modelsLoaded);
 
     rebuildLights();
     objectShader.use();
@@ -106,10 +151,11 @@ void Renderer::Render(GLFWwindow* window, Camera* camera, Controller* controller
     glFrontFace(GL_CCW); 
 
     //load textures
-    cubemapTextureDay = tl.loadCubemap(faces_day);
-    cubemapTextureNight = tl.loadCubemap(faces_night);
-    cubemapTextureSpace1 = tl.loadCubemap(faces_space1);
-    cubemapTextureSpace2 = tl.loadCubemap(faces_space2);
+    std::vector<unsigned int> cubemaps = tl.loadCubemaps({faces_day, faces_night, faces_space1, faces_space2}, jobs);
+    cubemapTextureDay = cubemaps[0];
+    cubemapTextureNight = cubemaps[1];
+    cubemapTextureSpace1 = cubemaps[2];
+    cubemapTextureSpace2 = cubemaps[3];
     unsigned int transparentTexture = tl.loadTexture("../textures/red_window.png");
     unsigned int grassTexture = tl.loadTexture("../textures/grass.png");
     unsigned int brickTexture = tl.loadTexture("../textures/brick.jpg");
@@ -117,7 +163,7 @@ void Renderer::Render(GLFWwindow* window, Camera* camera, Controller* controller
     unsigned int brickwallNormalTexture = tl.loadTexture("../textures/brickwall_normal.jpg");
 
     //load skyboxes
-    currSkybox = cubemapTextureSpace2;
+    settings.currSkybox = cubemapTextureSpace2;
 
     // VAOs and VBOs
     unsigned int lightVAO, VBO, transparentVAO, transparentVBO, grassVAO, grassVBO, quadVAO, quadVBO, skyboxVAO, skyboxVBO;
@@ -142,274 +188,981 @@ void Renderer::Render(GLFWwindow* window, Camera* camera, Controller* controller
     glUniformBlockBinding(normalMapShader.ID, uniformBlockNormalMapShader, 0);
     unsigned int uniformBlockParallaxMapShader = glGetUniformBlockIndex(parallaxShader.ID, "Matrices");
     glUniformBlockBinding(parallaxShader.ID, uniformBlockParallaxMapShader, 0);
-
-    unsigned int uboMatrices;
-    glGenBuffers(1, &uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uboMatrices, 0, 2 * sizeof(glm::mat4));
+    unsigned int uniformBlockDepthPrePassShader = glGetUniformBlockIndex(depthPrePassShader.ID, "Matrices");
+    glUniformBlockBinding(depthPrePassShader.ID, uniformBlockDepthPrePassShader, 0);
+    unsigned int uniformBlockGBufferShader = glGetUniformBlockIndex(gBufferShader.ID, "Matrices");
+    glUniformBlockBinding(gBufferShader.ID, uniformBlockGBufferShader, 0);
+    unsigned int uniformBlockVisibilityShader = glGetUniformBlockIndex(visibilityShader.ID, "Matrices");
+    glUniformBlockBinding(visibilityShader.ID, uniformBlockVisibilityShader, 0);
+    unsigned int uniformBlockMotionVectorShader = glGetUniformBlockIndex(motionVectorShader.ID, "Matrices");
+    glUniformBlockBinding(motionVectorShader.ID, uniformBlockMotionVectorShader, 0);
+
+    // per-frame GPU data (the Matrices block, draw records, light lists) is streamed through a
+    // persistently mapped ring
+    streamBuffer.init();
 
     //screen resizing variables
     ImVec2 lastSceneSize = ImVec2(SCR_WIDTH, SCR_HEIGHT);
     int fbWidth = (int)lastSceneSize.x;
     int fbHeight = (int)lastSceneSize.y;
 
-    // framebuffers
-    Framebuffer framebuffer = createFramebuffer(SCR_WIDTH, SCR_HEIGHT);
-    Framebuffer msaa = createMSAAFrameBuffer(SCR_WIDTH, SCR_HEIGHT);
-    Framebuffer depthMapBuffer = createDepthMapBuffer();
-    Framebuffer postProcessFramebuffer = createFramebuffer(fbWidth, fbHeight);
-
-
-    constexpr int MAX_POINT_LIGHTS = 8;
-    std::array<Framebuffer, MAX_POINT_LIGHTS> pointLightsBuffers{};
-    for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
-        pointLightsBuffers[i] = createDepthCubemapBuffer();
-    }
+    // persistent shadow maps; every per-frame target is owned by the render graph
+    dirShadows.init();
 
     // Initialize ImGui
     ImGuiIO& io = initImGui(window);
+    picker.init();
+
+    // the ImGui backend creates its GL objects on its first NewFrame, while the context is still here
+    ImGui_ImplOpenGL3_NewFrame();
+
+    // MARK: RENDER THREAD
+    // from here on every GL call is made on the render thread, which draws the snapshots the main
+    // loop below publishes
+    glfwMakeContextCurrent(nullptr);
+    std::thread renderThread([&]() {
+        glfwMakeContextCurrent(window);
+        jobs.adoptMainThread();
+        while (FrameSnapshots::Snapshot* frame = frames.acquire()) {
+            // the snapshot's camera, light and objects stand in for the ones the main thread keeps
+            // changing; the previous frame is done, so what the UI deleted before it can go
+            Camera* camera = &frame->camera;
+            const glm::vec3 lightPos = frame->lightPos;
+            const int displayWidth = frame->displayWidth;
+            const int displayHeight = frame->displayHeight;
+            const std::vector<RenderObject>& scene = frame->objects;
+            // the settings the UI had when it published this frame; the UI's own copy is never read here
+            const RenderSettings& settings = frame->settings;
+            dirShadows.settings = settings.cascades;
+            dynamicResolution.settings = settings.dynamicResolution;
+            frame->retired.clear();
+            if (frame->requests.resetTemporalHistory) { temporalAA.reset(); }
+            if (frame->requests.startShadowBenchmark) {
+                shadowBenchmark = ShadowBenchmark{};
+                shadowBenchmark.method = GeometryShaderFaces;
+            }
 
-    // perspective (only needs to be set once unless you want to change projection)
-    glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 model;
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            // the snapshot doesn't change, so its casters are gathered (and below, the draw order
+            // sorted and the shadow packets built) alongside this frame's GL work up to the shadow passes
+            jobs.run([this, &scene, caching = settings.useShadowCaching]() { gatherCasters(scene, caching); }, &castersReady);
+
+            // GL work other threads queued since the last frame
+            jobs.drainMainThread();
+            streamBuffer.beginFrame();
+            const JobSystem::Stats jobStats = jobs.takeStats();
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_BACK);
+            glFrontFace(GL_CCW);
+
+            //gamma correction
+            if (settings.gammaCorrection) {glEnable(GL_FRAMEBUFFER_SRGB);} else { glDisable(GL_FRAMEBUFFER_SRGB);}
+
+            // the scene renders at a dynamic fraction of the Scene window's size and is upscaled to it
+            // at the end; fbWidth/fbHeight are the render size from here on
+            dynamicResolution.update();
+            if (renderToTexture) { dynamicResolution.renderSize(displayWidth, displayHeight, fbWidth, fbHeight); }
+            else { fbWidth = displayWidth; fbHeight = displayHeight; }
+
+            // Update projection matrix to match ImGui Scene window size
+            // TAA moves the projection by a different sub-pixel offset every frame
+            float aspect = (float)displayWidth / (float)displayHeight;
+            glm::mat4 view = camera->GetViewMatrix();
+            const bool temporal = settings.antiAliasing == TAA && renderToTexture;
+            if (temporal) {
+                temporalAA.beginFrame(fbWidth, fbHeight, camera->GetProjectionMatrix(aspect, false) * view);
+                camera->Jitter = temporalAA.getJitter();
+            } else {
+                temporalAA.skipFrame();
+                camera->Jitter = glm::vec2(0.0f);
+            }
+            glm::mat4 projection = camera->GetProjectionMatrix(aspect);
+
+            // wireframe
+            if (settings.wireFrame) { glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); } else { glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); }
+
+            // projection and view for the Matrices block
+            const glm::mat4 matrices[2] = { projection, view };
+            StreamBuffer::Allocation matricesRange = streamBuffer.upload(matrices, sizeof(matrices));
+            glBindBufferRange(GL_UNIFORM_BUFFER, 0, matricesRange.buffer, matricesRange.offset, matricesRange.size);
+
+            // the draw order needs this frame's camera; it is sorted while the render thread goes on
+            glm::vec3 cameraPosition = camera->Position;
+            jobs.run([this, &scene, cameraPosition]() { sortDrawOrder(scene, cameraPosition); }, &packetsReady);
+
+            // sort the transparent windows
+            // vector<glm::vec3> windows = sr.getWindows();
+            // std::map<float, glm::vec3> sorted;
+            // for (unsigned int i = 0; i < windows.size(); i++) {
+            //     float distance = glm::length(camera->Position - windows[i]);
+            //     sorted[distance] = windows[i];
+            // }
+
+            // MARK: point shadow allocation
+            // scene lights come first in clusterLights; without clustering only they are drawn
+            gatherClusterLights(scene, settings.lightSwarmCount, settings.lightSwarmRadius);
+            int shadowCandidates = settings.useClusteredLighting ? (int)clusterLights.size() : std::min((int)frame->lights.size(), (int)clusterLights.size());
+            std::vector<PointShadowMaps::Candidate> candidates;
+            for (int i = 0; i < shadowCandidates; i++) { candidates.push_back({clusterLights[i].position, std::min(clusterLights[i].radius, POINT_SHADOW_FAR), clusterLightKeys[i]}); }
+            pointShadows.setBudget(settings.pointShadowBudgetMB);
+            pointShadowSlots = pointShadows.assign(candidates, view, glm::radians(camera->Zoom), aspect, (float)fbHeight);
+            for (int i = 0; i < shadowCandidates; i++) { clusterLights[i].shadowSlot = pointShadowSlots[i]; }
+
+            // MARK: shadow caching
+            // once the casters are gathered: the cascades fit around them, static casters that changed
+            // drop the caches they are baked into (dynamic ones are drawn over them every frame) and
+            // the per-cascade and per-light lists are built, all while the GL work below goes on
+            jobs.runAfter(castersReady, [this, &scene, &settings, &candidates, view, fovY = glm::radians(camera->Zoom), aspect, lightPos]() {
+                glm::vec3 castersMin = packets.castersMin, castersMax = packets.castersMax;
+                // the cascades reach back towards the light far enough to take in every caster
+                if (castersMin.x > castersMax.x) castersMin = castersMax = glm::vec3(0.0f);
+                glm::vec3 castersCenter = 0.5f * (castersMin + castersMax);
+                dirShadows.update(view, fovY, aspect, 0.1f, -lightPos, castersCenter, glm::length(castersMax - castersCenter));
+                if (settings.useShadowCaching) {
+                    trackStaticCasters(scene);
+                } else {
+                    staticCasterStates.clear();
+                    pointShadows.invalidateAll();
+                    dirShadows.invalidateAll();
+                }
+                auto packetBuildStart = std::chrono::high_resolution_clock::now();
+                buildShadowPackets(candidates);
+                packetBuildMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - packetBuildStart).count();
+            }, &packetsReady);
+
+            // MARK: clustered lighting
+            if (settings.useClusteredLighting) {
+                clusterGrid.build(clusterLights, view, glm::radians(camera->Zoom), aspect, camera->Near, camera->Far, jobs);
+                clusterGrid.upload(clusterLights, streamBuffer);
+            }
 
-    // MARK: MAIN LOOP
-    while(!glfwWindowShouldClose(window)) {
-        glEnable(GL_CULL_FACE);  
-        glCullFace(GL_BACK); 
-        glFrontFace(GL_CCW); 
+            // MARK: occlusion culling
+            // the designated occluders go into the CPU depth buffer, then every object's box is tested
+            // against it; hidden ones are skipped by the camera passes (they may still cast shadows)
+            std::unordered_set<const RenderObject*> hiddenObjects;
+            if (settings.useOcclusionCulling) {
+                glm::mat4 cullViewProjection = camera->GetProjectionMatrix(aspect, false) * view;
+                std::vector<OcclusionCuller::Occluder> occluders;
+                for (const RenderObject& obj : scene) {
+                    if (!obj.isOccluder() || obj.getModel().occluderIndices.empty()) continue;
+                    occluders.push_back({&obj.getModel().occluderPositions, &obj.getModel().occluderIndices, obj.getModelMatrix()});
+                }
+                occlusionCuller.rasterize(occluders, cullViewProjection, jobs);
+                for (const RenderObject& obj : scene) {
+                    const Model& model = obj.getModel();
+                    if (model.boundsMin.x > model.boundsMax.x) continue;
+                    if (occlusionCuller.test(model.boundsMin, model.boundsMax, cullViewProjection * obj.getModelMatrix()) != OcclusionCuller::Visible) {
+                        hiddenObjects.insert(&obj);
+                    }
+                }
+            }
+            auto culled = [&](const RenderObject* obj) { return hiddenObjects.count(obj) > 0; };
+            objectsDrawn = (int)(scene.size() - hiddenObjects.size());
+
+            // MARK: occlusion queries
+            // the GPU alternative: objects last seen visible are drawn directly, those last seen hidden
+            // get a box query at the end of their pass and are drawn under conditional render
+            const bool hardwareQueries = settings.useOcclusionQueries && renderToTexture;
+            std::vector<OcclusionQueries::Candidate> queryCandidates;
+            std::vector<const RenderObject*> queryObjects;
+            std::unordered_set<const RenderObject*> queriedObjects;
+            if (hardwareQueries) {
+                occlusionQueries.beginFrame(settings.occlusionCheckInterval);
+                for (const RenderObject& obj : scene) {
+                    if (culled(&obj) || occlusionQueries.isVisible(obj.getID())) continue;
+                    glm::mat4 box;
+                    if (!occlusionBox(&obj, camera->Position, box)) continue;
+                    queryCandidates.push_back({obj.getID(), box});
+                    queryObjects.push_back(&obj);
+                    queriedObjects.insert(&obj);
+                }
+            }
+            auto queried = [&](const RenderObject* obj) { return queriedObjects.count(obj) > 0; };
+            // a directly drawn object, inside a query now and then to notice it getting hidden
+            auto drawTracked = [&](const RenderObject* obj, auto&& draw) {
+                if (hardwareQueries) { occlusionQueries.drawVisible(obj->getID(), draw); }
+                else { draw(); }
+            };
+            // the queried objects this pass draws, after everything else has laid down its depth
+            auto drawQueried = [&](auto&& inPass, auto&& draw) {
+                std::vector<OcclusionQueries::Candidate> candidates;
+                std::vector<const RenderObject*> drawn;
+                for (size_t i = 0; i < queryObjects.size(); i++) {
+                    if (!inPass(queryObjects[i])) continue;
+                    candidates.push_back(queryCandidates[i]);
+                    drawn.push_back(queryObjects[i]);
+                }
+                occlusionQueries.drawHidden(candidates, depthPrePassShader, skyboxVAO, [&](size_t i) { draw(drawn[i]); });
+            };
+
+            // MARK: frame packets
+            // the caster gather, the draw order sort and the shadow packets have been running
+            // alongside the GL work above
+            auto packetWaitStart = std::chrono::high_resolution_clock::now();
+            jobs.wait(packetsReady);
+            packetWaitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - packetWaitStart).count();
+
+            // MARK: render graph
+            // passes only declare what they read and write; the graph orders them, culls the ones
+            // nobody needs, allocates and aliases the transient targets and inserts clears/resolves
+
+            const size_t allCasterTriangles = packets.allCasterTriangles;
+            shadowTriangles = shadowTrianglesUnculled = 0;
+            // the G-buffer isn't multisampled, so MSAA only applies to the forward path
+            const bool deferred = settings.renderPath != ForwardPath && renderToTexture;
+            const bool visibility = deferred && settings.renderPath == VisibilityPath;
+            const int samples = (settings.antiAliasing == MSAA && !deferred) ? 4 : 0;
+            RenderGraph& rg = renderGraph;
+            rg.beginFrame();
+
+            const int cascadeSize = CascadedShadowMaps::RESOLUTION;
+            int dirShadowMap = rg.importTexture("Directional Shadow Cascades", dirShadows.getTexture(), GL_TEXTURE_2D_ARRAY, cascadeSize, cascadeSize, GL_DEPTH_COMPONENT16);
+            int dirShadowCache = rg.importTexture("Directional Shadow Cache", dirShadows.getStaticTexture(), GL_TEXTURE_2D_ARRAY, cascadeSize, cascadeSize, GL_DEPTH_COMPONENT16);
+            const int momentSize = CascadedShadowMaps::MOMENT_RESOLUTION;
+            int dirShadowMoments = rg.importTexture("Directional Shadow Moments", dirShadows.getMomentTexture(), GL_TEXTURE_2D_ARRAY, momentSize, momentSize, GL_RGBA16F);
+            std::vector<int> pointShadowMaps, pointShadowCaches;
+            for (int t = 0; t < PointShadowMaps::TIER_COUNT; t++) {
+                int size = PointShadowMaps::TIER_SIZES[t];
+                pointShadowMaps.push_back(rg.importTexture("Point Shadows " + std::to_string(size), pointShadows.getTexture(t), GL_TEXTURE_CUBE_MAP_ARRAY, size, size, GL_DEPTH_COMPONENT16));
+                pointShadowCaches.push_back(rg.importTexture("Point Shadow Cache " + std::to_string(size), pointShadows.getStaticTexture(t), GL_TEXTURE_CUBE_MAP_ARRAY, size, size, GL_DEPTH_COMPONENT16));
+            }
+            // the multisampled target keeps the 8-bit format the old MSAA framebuffer used
+            int sceneColor = rg.createTexture("Scene Color", {fbWidth, fbHeight, samples ? (GLenum)GL_RGB8 : (GLenum)GL_RGBA16F, samples});
+            int sceneIDs   = rg.createTexture("Object IDs", {fbWidth, fbHeight, GL_R32UI, samples});
+            int sceneDepth = rg.createTexture("Scene Depth", {fbWidth, fbHeight, GL_DEPTH24_STENCIL8, samples});
+            int postColor  = rg.createTexture("Post-Processed", {fbWidth, fbHeight, GL_RGBA16F, 0});
+            int depthView  = rg.createTexture("Depth Map View", {fbWidth, fbHeight, GL_RGBA8, 0});
+            int gAlbedoSpec  = rg.createTexture("G-Buffer Albedo/Specular", {fbWidth, fbHeight, GL_RGBA8, 0});
+            int gNormalGloss = rg.createTexture("G-Buffer Normal/Gloss", {fbWidth, fbHeight, GL_RGB10_A2, 0});
+            int visibilityIDs = rg.createTexture("Visibility", {fbWidth, fbHeight, GL_RG32UI, 0});
+            int backbuffer = rg.importBackbuffer(fbWidth, fbHeight);
+
+            // render scene from light's point of view (first pass)
+            // MARK: shadow passes
+            // a cache pass only runs when the cache was invalidated, the live pass only when there is
+            // something to composite; in a static scene neither runs and last frame's maps are reused
+            // every cascade gets its own culled caster lists; one pass rebuilds the stale cascade
+            // caches, another refreshes the live cascades that changed
+            struct CascadeWork {
+                int cascade;
+                bool dynamic;
+                const std::vector<ShadowCaster>* casters;  // static ones for a rebuild, dynamic ones otherwise
+            };
+            std::vector<CascadeWork> cascadeRebuilds, cascadeRefreshes;
+            for (int i = 0; i < (int)packets.cascadeDynamic.size(); i++) {
+                const std::vector<ShadowCaster>& dynamic = packets.cascadeDynamic[i];
+                bool rebuild = settings.useShadowCaching && !dirShadows.isCacheValid(i);
+                if (rebuild) cascadeRebuilds.push_back({i, false, &packets.cascadeStatic[i]});
+                if (!settings.useShadowCaching || rebuild || !dynamic.empty() || !dirShadows.isLiveStatic(i)) {
+                    cascadeRefreshes.push_back({i, !dynamic.empty(), &dynamic});
+                }
+            }
+            auto clearCascade = [](unsigned int texture, int cascade) {
+                float farDepth = 1.0f;
+                glClearTexSubImage(texture, 0, 0, 0, cascade, cascadeSize, cascadeSize, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+            };
+            if (!cascadeRebuilds.empty()) {
+                rg.addPass("Directional Shadow Cache", [&, cascadeRebuilds](RenderGraph::PassContext&) {
+                    for (const CascadeWork& work : cascadeRebuilds) {
+                        clearCascade(dirShadows.getStaticTexture(), work.cascade);
+                        renderDirectionalShadow(depthShader, dirShadows.getStaticTexture(), work.cascade, *work.casters, allCasterTriangles);
+                        dirShadows.markStaticRendered(work.cascade);
+                    }
+                }).write(dirShadowCache, RenderGraph::Load);
+            }
+            if (!cascadeRefreshes.empty()) {
+                auto pass = rg.addPass("Directional Shadow", [&, cascadeRefreshes](RenderGraph::PassContext&) {
+                    for (const CascadeWork& work : cascadeRefreshes) {
+                        if (settings.useShadowCaching) {
+                            glCopyImageSubData(dirShadows.getStaticTexture(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, work.cascade,
+                                               dirShadows.getTexture(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, work.cascade, cascadeSize, cascadeSize, 1);
+                        } else {
+                            clearCascade(dirShadows.getTexture(), work.cascade);
+                        }
+                        if (!work.casters->empty()) renderDirectionalShadow(depthShader, dirShadows.getTexture(), work.cascade, *work.casters, allCasterTriangles);
+                        dirShadows.markComposited(work.cascade, work.dynamic);
+                    }
+                });
+                if (settings.useShadowCaching) pass.read(dirShadowCache);
+                pass.write(dirShadowMap, RenderGraph::Load);
+            }
+            // refreshed cascades are prefiltered once here instead of at every shaded pixel
+            std::vector<int> momentCascades;
+            for (const CascadeWork& work : cascadeRefreshes) { dirShadows.invalidateMoments(work.cascade); }
+            for (int i = 0; i < dirShadows.settings.cascadeCount; i++) {
+                if (dirShadows.needsMoments(i)) momentCascades.push_back(i);
+            }
+            if (!momentCascades.empty()) {
+                rg.addPass("Directional Shadow Moments", [&, momentCascades](RenderGraph::PassContext&) {
+                    shadowMomentsTimer.begin();
+                    filterShadowMoments(shadowMomentsShader, shadowBlurShader, quadVAO, momentCascades);
+                    shadowMomentsTimer.end();
+                }).read(dirShadowMap).write(dirShadowMoments, RenderGraph::Load);
+            }
 
-        //gamma correction
-        if (gammaCorrection) {glEnable(GL_FRAMEBUFFER_SRGB);} else { glDisable(GL_FRAMEBUFFER_SRGB);}
+            // each light only touches its own faces, so the tier arrays are loaded, not cleared. the
+            // scheduler decides which faces get updated this frame; all cache passes are declared
+            // before the live passes that copy from the cache arrays
+            std::vector<unsigned int> dynamicFaces(pointShadowSlots.size(), 0);
+            for (size_t i = 0; i < pointShadowSlots.size(); i++) { dynamicFaces[i] = packets.pointLights[i].dynamicFaces; }
+            // while benchmarking every face of every shadowed light is redrawn from scratch
+            updateShadowBenchmark();
+            const bool benchmarking = shadowBenchmark.method >= 0;
+            if (benchmarking) pointShadows.invalidateAll();
+            int faceBudget = benchmarking ? 6 * (int)pointShadowSlots.size() : settings.pointShadowFaceBudget;
+            std::vector<PointShadowMaps::FaceWork> shadowWork = pointShadows.schedule(dynamicFaces, faceBudget);
+            int shadowMethod = benchmarking ? shadowBenchmark.method : settings.pointShadowMethod;
+            if (shadowMethod == LayeredInstancing && !hasVertexLayer) shadowMethod = GeometryShaderFaces;
+            // one timer query spans all point shadow passes, which run back to back
+            int pointPassCount = 0, pointPassesRun = 0;
+            auto beginPointPass = [&]() { if (pointPassesRun++ == 0) pointShadowTimer[shadowMethod].begin(); };
+            auto endPointPass = [&]() { if (pointPassesRun == pointPassCount) pointShadowTimer[shadowMethod].end(); };
+            // clear or copy the faces of one slot, one layer per face
+            auto forEachFace = [](int slot, unsigned int faces, auto&& fn) {
+                int size = PointShadowMaps::TIER_SIZES[PointShadowMaps::slotTier(slot)];
+                for (int face = 0; face < 6; face++) {
+                    if (faces & (1u << face)) fn(PointShadowMaps::slotLayer(slot) * 6 + face, size);
+                }
+            };
+            auto clearFaces = [&](unsigned int texture, int slot, unsigned int faces) {
+                float farDepth = 1.0f;
+                forEachFace(slot, faces, [&](int layer, int size) { glClearTexSubImage(texture, 0, 0, 0, layer, size, size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth); });
+            };
+            if (settings.useShadowCaching) {
+                for (const PointShadowMaps::FaceWork& work : shadowWork) {
+                    if (!work.rebuildFaces) continue;
+                    int tier = PointShadowMaps::slotTier(work.slot);
+                    const PointLightPacket* light = &packets.pointLights[work.candidate];
+                    pointPassCount++;
+                    rg.addPass("Point Shadow Cache " + std::to_string(work.candidate), [&, work, tier, light](RenderGraph::PassContext&) {
+                        beginPointPass();
+                        clearFaces(pointShadows.getStaticTexture(tier), work.slot, work.rebuildFaces);
+                        renderPointShadow(pointDepthShaders, shadowMethod, pointShadows.getStaticTexture(tier), *light, work.slot, work.rebuildFaces, light->staticCasters, allCasterTriangles);
+                        pointShadows.markStaticRendered(work.slot, work.rebuildFaces);
+                        endPointPass();
+                    }).write(pointShadowCaches[tier], RenderGraph::Load);
+                }
+            }
+            for (const PointShadowMaps::FaceWork& work : shadowWork) {
+                int tier = PointShadowMaps::slotTier(work.slot);
+                const PointLightPacket* light = &packets.pointLights[work.candidate];
+                unsigned int dynamic = dynamicFaces[work.candidate];
+                pointPassCount++;
+                if (!settings.useShadowCaching) {
+                    rg.addPass("Point Shadow " + std::to_string(work.candidate), [&, work, tier, light, dynamic](RenderGraph::PassContext&) {
+                        beginPointPass();
+                        clearFaces(pointShadows.getTexture(tier), work.slot, work.refreshFaces);
+                        renderPointShadow(pointDepthShaders, shadowMethod, pointShadows.getTexture(tier), *light, work.slot, work.refreshFaces, light->dynamicCasters, allCasterTriangles);
+                        pointShadows.markComposited(work.slot, work.refreshFaces, dynamic);
+                        endPointPass();
+                    }).write(pointShadowMaps[tier], RenderGraph::Load);
+                    continue;
+                }
+                rg.addPass("Point Shadow " + std::to_string(work.candidate), [&, work, tier, light, dynamic](RenderGraph::PassContext&) {
+                    beginPointPass();
+                    forEachFace(work.slot, work.refreshFaces, [&](int layer, int size) {
+                        glCopyImageSubData(pointShadows.getStaticTexture(tier), GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, layer,
+                                           pointShadows.getTexture(tier), GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, layer, size, size, 1);
+                    });
+                    if (work.refreshFaces & dynamic) renderPointShadow(pointDepthShaders, shadowMethod, pointShadows.getTexture(tier), *light, work.slot, work.refreshFaces & dynamic, light->dynamicCasters, allCasterTriangles);
+                    pointShadows.markComposited(work.slot, work.refreshFaces, dynamic);
+                    endPointPass();
+                }).read(pointShadowCaches[tier]).write(pointShadowMaps[tier], RenderGraph::Load);
+            }
 
-        //delta time
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+            // MARK: depth pre-pass
+            // parallax mapping discards fragments, so those objects can't be in the pre-pass; they
+            // are drawn with a normal depth test at the end of the opaque objects instead
+            auto inPrePass = [&](const RenderObject* obj) { return obj->getShader() != &parallaxShader; };
+            updateDepthPrePassMode(settings, fbWidth, fbHeight, samples, deferred, hardwareQueries);
+            const bool prePass = depthPrePassActive && renderToTexture && !deferred;
+            if (prePass) {
+                rg.addPass("Depth Pre-Pass", [&](RenderGraph::PassContext&) {
+                    prePassTimer.begin();
+                    glEnable(GL_DEPTH_TEST);
+                    glDepthFunc(GL_LESS);
+                    glCullFace(GL_BACK);
+                    overdrawQuery[1].begin();
+                    for (const RenderObject* obj : packets.drawOrder) { if (inPrePass(obj) && !culled(obj) && !queried(obj)) { obj->DrawDepth(depthPrePassShader); }}
+                    overdrawQuery[1].end();
+                    prePassTimer.end();
+                }).write(sceneDepth, RenderGraph::Clear);
+            }
 
-        //input
-        controller->processInput(window, deltaTime, camera);
+            // draw skybox (LAST BUT BEFORE TRANSPARENT)
+            auto drawSkybox = [&]() {
+                glDepthFunc(GL_LEQUAL);
+                skyboxShader.use();
+                skyboxShader.setMat4("view", glm::mat4(glm::mat3(camera->GetViewMatrix())));
+                skyboxShader.setMat4("projection", projection);
+                glBindVertexArray(skyboxVAO);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, settings.currSkybox);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glBindVertexArray(0);
+                glDepthFunc(GL_LESS);
+            };
+
+            // shadow maps for the lighting shaders: the cascades on unit 4 through the comparison
+            // sampler, point shadow tiers on 5.., the cascade moments on 8. unbind() drops the sampler
+            // again so later users of unit 4 get the texture's own state
+            auto bindShadowMaps = [&](RenderGraph::PassContext& ctx) {
+                glActiveTexture(GL_TEXTURE0 + 4);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, ctx.texture(dirShadowMap));
+                glBindSampler(4, dirShadows.getComparisonSampler());
+                for (int i = 0; i < (int)pointShadowMaps.size(); i++) {
+                    glActiveTexture(GL_TEXTURE0 + 5 + i);
+                    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, ctx.texture(pointShadowMaps[i]));
+                }
+                glActiveTexture(GL_TEXTURE0 + 8);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, ctx.texture(dirShadowMoments));
+            };
+            auto unbindShadowSampler = []() { glBindSampler(4, 0); };
+
+            // MARK: deferred path
+            if (deferred) {
+                // only objects using the forward object shader fit the G-buffer; parallax and reflective
+                // objects keep their own shaders and are drawn forward on top of the lit result
+                auto inGBuffer = [&](const RenderObject* obj) { return obj->getShader() == &objectShader; };
+
+                if (visibility) {
+                    // packs the meshes on first use (or when objects come and go), transforms every frame
+                    std::vector<const RenderObject*> visibleObjects;
+                    for (const RenderObject& obj : scene) { if (inGBuffer(&obj)) { visibleObjects.push_back(&obj); }}
+                    visibilityBuffer.update(visibleObjects, streamBuffer);
+
+                    // depth and ids only: overdraw costs a position transform and an 8 byte write
+                    auto visibilityPass = rg.addPass("Visibility", [&](RenderGraph::PassContext&) {
+                        visibilityTimer.begin();
+                        glEnable(GL_DEPTH_TEST);
+                        glDepthFunc(GL_LESS);
+                        glCullFace(GL_BACK);
+                        visibilityShader.use();
+                        visibilityBuffer.drawGeometry();
+                        visibilityTimer.end();
+                    });
+                    visibilityPass.write(visibilityIDs, RenderGraph::Clear);
+                    if (settings.useObjectIDPicking) { visibilityPass.write(sceneIDs, RenderGraph::Clear); }
+                    visibilityPass.write(sceneDepth, RenderGraph::Clear);
+
+                    // each covered pixel fetches its triangle and samples its textures exactly once
+                    rg.addPass("Material Resolve", [&](RenderGraph::PassContext& ctx) {
+                        materialResolveTimer.begin();
+                        glDisable(GL_DEPTH_TEST);
+                        visibilityResolveShader.use();
+                        visibilityResolveShader.setInt("visibility", 0);
+                        visibilityResolveShader.setInt("materialTextures", 1);
+                        visibilityResolveShader.setMat4("viewProjection", projection * view);
+                        visibilityResolveShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                        visibilityResolveShader.setBool("useNormalMaps", settings.useNormalMaps);
+                        visibilityResolveShader.setFloat("shininess", 32.0f);
+                        glActiveTexture(GL_TEXTURE0);
+                        glBindTexture(GL_TEXTURE_2D, ctx.texture(visibilityIDs));
+                        visibilityBuffer.bindMaterialData(1);
+                        glBindVertexArray(quadVAO);
+                        glDrawArrays(GL_TRIANGLES, 0, 6);
+                        glEnable(GL_DEPTH_TEST);
+                        materialResolveTimer.end();
+                    }).read(visibilityIDs).write(gAlbedoSpec, RenderGraph::DontCare).write(gNormalGloss, RenderGraph::DontCare);
+                } else {
+                    auto gBufferPass = rg.addPass("G-Buffer", [&](RenderGraph::PassContext&) {
+                        gBufferTimer.begin();
+                        glEnable(GL_DEPTH_TEST);
+                        glDepthFunc(GL_LESS);
+                        glCullFace(GL_BACK);
+                        gBufferShader.use();
+                        gBufferShader.setBool("useNormalMaps", settings.useNormalMaps);
+                        gBufferShader.setFloat("shininess", 32.0f);
+                        auto drawToGBuffer = [&](const RenderObject* obj) {
+                            gBufferShader.use();    // the box queries switch programs
+                            gBufferShader.setUInt("objectID", obj->getID());
+                            obj->Draw(gBufferShader);
+                        };
+                        for (const RenderObject* obj : packets.drawOrder) {
+                            if (!inGBuffer(obj) || culled(obj) || queried(obj)) continue;
+                            drawTracked(obj, [&]() { drawToGBuffer(obj); });
+                        }
+                        if (hardwareQueries) { drawQueried([&](const RenderObject* obj) { return obj->getShader() == &objectShader; }, drawToGBuffer); }
+                        gBufferTimer.end();
+                    });
+                    // attachment order follows the shader's output locations: albedo, normal, ids
+                    gBufferPass.write(gAlbedoSpec, RenderGraph::Clear).write(gNormalGloss, RenderGraph::Clear);
+                    if (settings.useObjectIDPicking) { gBufferPass.write(sceneIDs, RenderGraph::Clear); }
+                    gBufferPass.write(sceneDepth, RenderGraph::Clear);
+                }
 
-        // Start new ImGui frame early so we can query the scene window size before rendering
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        ImGuizmo::BeginFrame();
-        ImGuiWindow* sceneWindow = ImGui::FindWindowByName("Scene");
-        if (sceneWindow) {lastSceneSize = sceneWindow->ContentRegionRect.GetSize();}
-        int newWidth = (int)lastSceneSize.x;
-        int newHeight = (int)lastSceneSize.y;
-        if (newWidth != fbWidth || newHeight != fbHeight) {
-            fbWidth = newWidth;
-            fbHeight = newHeight;
-            deleteFramebuffer(framebuffer);
-            deleteFramebuffer(msaa);
-            deleteFramebuffer(postProcessFramebuffer);
-            framebuffer = createFramebuffer(fbWidth, fbHeight);
-            msaa = createMSAAFrameBuffer(fbWidth, fbHeight);
-            postProcessFramebuffer = createFramebuffer(fbWidth, fbHeight);
-        }
-
-        // Update projection matrix to match ImGui Scene window size
-        float aspect = (float)fbWidth / (float)fbHeight;
-        glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), aspect, 0.1f, 100.0f);
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-        // wireframe
-        if (wireFrame) { glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); } else { glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); }
-
-        // view
-        glm::mat4 view = camera->GetViewMatrix();
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-        // sort the transparent windows
-        // vector<glm::vec3> windows = sr.getWindows();
-        // std::map<float, glm::vec3> sorted;
-        // for (unsigned int i = 0; i < windows.size(); i++) {
-        //     float distance = glm::length(camera->Position - windows[i]);
-        //     sorted[distance] = windows[i];
-        // }
+                // one fullscreen pass: every pixel is lit exactly once, whatever the overdraw was
+                auto lightingPass = rg.addPass("Deferred Lighting", [&](RenderGraph::PassContext& ctx) {
+                    deferredLightingTimer.begin();
+                    glDisable(GL_DEPTH_TEST);
+                    bindShadowMaps(ctx);
+                    setLightingUniforms(deferredLightingShader, *frame, fbWidth, fbHeight);
+                    deferredLightingShader.setInt("gAlbedoSpec", 0);
+                    deferredLightingShader.setInt("gNormalGloss", 1);
+                    deferredLightingShader.setInt("gDepth", 2);
+                    deferredLightingShader.setMat4("invViewProjection", glm::inverse(projection * view));
+                    deferredLightingShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(gAlbedoSpec));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(gNormalGloss));
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneDepth));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    unbindShadowSampler();
+                    glEnable(GL_DEPTH_TEST);
+                    deferredLightingTimer.end();
+                });
+                lightingPass.read(gAlbedoSpec).read(gNormalGloss).read(sceneDepth).read(dirShadowMap).read(dirShadowMoments);
+                for (int shadowMap : pointShadowMaps) { lightingPass.read(shadowMap); }
+                lightingPass.write(sceneColor, RenderGraph::DontCare);
+
+                auto forwardPass = rg.addPass("Deferred Forward", [&](RenderGraph::PassContext&) {
+                    deferredForwardTimer.begin();
+                    glEnable(GL_DEPTH_TEST);
+                    glDepthFunc(GL_LESS);
+                    glCullFace(GL_BACK);
+                    parallaxShader.use();
+                    parallaxShader.setVec3("lightPos", lightPos);
+                    parallaxShader.setVec3("viewPos", camera->Position);
+                    parallaxShader.setFloat("heightScale", 0.1f);
+                    for (const RenderObject* obj : packets.drawOrder) { if (!inGBuffer(obj) && !culled(obj) && !queried(obj)) { drawTracked(obj, [&]() { obj->Draw(); }); }}
+                    if (hardwareQueries) { drawQueried([&](const RenderObject* obj) { return obj->getShader() != &objectShader; }, [](const RenderObject* obj) { obj->Draw(); }); }
+                    drawSkybox();
+                    deferredForwardTimer.end();
+                });
+                forwardPass.write(sceneColor, RenderGraph::Load);
+                if (settings.useObjectIDPicking) { forwardPass.write(sceneIDs, RenderGraph::Load); }
+                forwardPass.write(sceneDepth, RenderGraph::Load);
+            } else {
+                // MARK: main pass
+                auto mainPass = rg.addPass("Main", [&](RenderGraph::PassContext& ctx) {
+                    mainPassTimer[prePass].begin();
+                    glEnable(GL_DEPTH_TEST);
+
+                    //setting shadow textures
+                    bindShadowMaps(ctx);
+
+                    // MARK: UNIFORM HELL
+                    setLightingUniforms(objectShader, *frame, fbWidth, fbHeight);
+
+                    parallaxShader.use();
+                    parallaxShader.setVec3("lightPos", lightPos);
+                    parallaxShader.setVec3("viewPos", camera->Position);
+                    parallaxShader.setFloat("heightScale", 0.1f);
+
+                    //render the objects normally (second pass)
+                    glCullFace(GL_BACK);
+                    auto drawn = [&](const RenderObject* obj) { return !culled(obj) && !queried(obj); };
+                    if (prePass) {
+                        // depth is final already: only the visible fragment of each pixel gets shaded
+                        glDepthFunc(GL_EQUAL);
+                        glDepthMask(GL_FALSE);
+                        for (const RenderObject* obj : packets.drawOrder) { if (inPrePass(obj) && drawn(obj)) { drawTracked(obj, [&]() { obj->Draw(); }); }}
+                        glDepthMask(GL_TRUE);
+                        glDepthFunc(GL_LESS);
+                        for (const RenderObject* obj : packets.drawOrder) { if (!inPrePass(obj) && drawn(obj)) { drawTracked(obj, [&]() { obj->Draw(); }); }}
+                    } else {
+                        // sample counting queries can't overlap the occlusion queries
+                        if (!hardwareQueries) overdrawQuery[0].begin();
+                        for (const RenderObject* obj : packets.drawOrder) { if (drawn(obj)) { drawTracked(obj, [&]() { obj->Draw(); }); }}
+                        if (!hardwareQueries) overdrawQuery[0].end();
+                    }
+                    if (hardwareQueries) { drawQueried([](const RenderObject*) { return true; }, [](const RenderObject* obj) { obj->Draw(); }); }
+
+                    // Pointlight cubes
+                    // pointlightcube.use();
+                    // glDisable(GL_CULL_FACE);
+                    // glBindVertexArray(lightVAO);
+                    // vector<glm::vec3> pointLights = sr.getpointLights();
+                    // for (unsigned int i = 0; i < NUM_POINT_LIGHTS; i++) {
+                    //     glm::vec3 val;
+                    //     glGetUniformfv(objectShader.ID, glGetUniformLocation(objectShader.ID, std::format("pointLights[{}].diffuse", i).c_str()), glm::value_ptr(val));
+                    //     pointlightcube.setVec3("color", val);
+                    //     model = glm::mat4(1.0f);
+                    //     model = glm::translate(model, pointLights[i]);
+                    //     model = glm::scale(model, glm::vec3(0.2f));
+                    //     pointlightcube.setMat4("model", model);
+                    //     glDrawArrays(GL_TRIANGLES, 0, 36);
+                    // }
+
+                    // Grass
+                    // grassShader.use();
+                    // glBindVertexArray(grassVAO);
+                    // glActiveTexture(GL_TEXTURE0);
+                    // glBindTexture(GL_TEXTURE_2D, grassTexture);
+                    // vector<glm::vec3> vegetation = sr.getVegetation();
+                    // for (unsigned int i = 0; i < vegetation.size(); i++) {
+                    //     model = glm::mat4(1.0f);
+                    //     model = glm::translate(model, vegetation[i]);
+                    //     grassShader.setMat4("model", model);
+                    //     glDrawArrays(GL_TRIANGLES, 0, 6);
+                    // }
+
+                    // draw skybox (LAST BUT BEFORE TRANSPARENT)
+                    drawSkybox();
+
+                    // Windows
+                    // transparentShader.use();
+                    // glBindVertexArray(transparentVAO);
+                    // glActiveTexture(GL_TEXTURE0);
+                    // glBindTexture(GL_TEXTURE_2D, transparentTexture);
+                    // for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it) {
+                    //     model = glm::mat4(1.0f);
+                    //     model = glm::translate(model, it->second);
+                    //     transparentShader.setMat4("model", model);
+                    //     glDrawArrays(GL_TRIANGLES, 0, 6);
+                    // }
+                    unbindShadowSampler();
+                    mainPassTimer[prePass].end();
+                });
+                mainPass.read(dirShadowMap).read(dirShadowMoments);
+                for (int shadowMap : pointShadowMaps) { mainPass.read(shadowMap); }
+                if (renderToTexture) {
+                    // object ids go to the second color attachment only while picking is on
+                    mainPass.write(sceneColor, RenderGraph::Clear);
+                    if (settings.useObjectIDPicking) { mainPass.write(sceneIDs, RenderGraph::Clear); }
+                    mainPass.write(sceneDepth, prePass ? RenderGraph::Load : RenderGraph::Clear);
+                } else {
+                    mainPass.write(backbuffer, RenderGraph::Clear);
+                }
+            }
 
-        // dirLight Anim
-        if (animateDirLight) {
-            float t = glfwGetTime() * orbitSpeed;
-            float y = lightPos.y;              
-            lightPos.x = orbitCenter.x + orbitRadius * std::cos(t);
-            lightPos.z = orbitCenter.y + orbitRadius * std::sin(t);
-            lightPos.y = y;
-        }
-
-        // render scene from light's point of view (first pass)
-        // MARK: first pass
-        glm::mat4 lightSpaceMatrix = firstPass(depthShader, framebuffer, depthMapBuffer, pointLightsBuffers.data(), pointDepthShader, fbWidth, fbHeight);
-
-        
-        // draw to non-default framebuffer
-        // Only bind and clear the framebuffer if we're actually rendering to it
-        if (renderToTexture) {
-            if (useMSAA) {glBindFramebuffer(GL_FRAMEBUFFER, msaa.ID);} 
-            else {glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.ID);}
-        } else { glBindFramebuffer(GL_FRAMEBUFFER, 0);}
-        
-        // clear the buffers
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
-
-        // MARK: UNIFORM HELL
-        objectShader.use();
-        constexpr int MAX_POINT_LIGHTS = 16;
-        int depthUnits[MAX_POINT_LIGHTS];
-        for (int i = 0; i < MAX_POINT_LIGHTS; ++i) { depthUnits[i] = 5 + i; }
-        GLint depthLoc = glGetUniformLocation(objectShader.ID, "depthCubeMap[0]");
-        glUniform1iv(depthLoc, MAX_POINT_LIGHTS, depthUnits);
-        sr.setParams(objectShader, *camera);
-        sr.updatePointLights(objectShader, lights);
-        objectShader.setVec3("lightPos", lightPos);
-        objectShader.setFloat("far_plane", 25.0f);
-        objectShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-        objectShader.setInt("shadowMap", shadowItem);
-        objectShader.setInt("NR_POINT_LIGHTS", NUM_POINT_LIGHTS);
-        for (int i = 0; i < NUM_POINT_LIGHTS; i++) { objectShader.setVec3("pointLightPos[" + std::to_string(i) + "]", lights[i]->getPosition()); }
-        // for (int i = 0; i < NUM_POINT_LIGHTS; i++) { objectShader.setInt("depthCubeMap[" + std::to_string(i) + "]", 5 + i); }
-        
-        // imgui uniforms
-        objectShader.setBool("useAmbient", useAmbient);
-        objectShader.setBool("useDiffuse", useDiffuse);
-        objectShader.setBool("useSpecular", useSpecular);
-        objectShader.setBool("useBlinn", useBlinn);
-        objectShader.setBool("useFlashlight", useFlashlight);
-        objectShader.setBool("useDirectionalLight", useDirectionalLight);
-        objectShader.setBool("usePointLight", usePointLight);
-        objectShader.setBool("showDepthBuffer", showDepthBuffer);
-        objectShader.setFloat("flashlightIntensity", flashlightIntensity);
-        objectShader.setFloat("directionalLightIntensity", directionLightIntensity);
-        objectShader.setFloat("pointLightIntensity", pointLightIntensity);
-        objectShader.setBool("useShadows", useShadows);
-        objectShader.setBool("useNormalMaps", useNormalMaps);
-        objectShader.setFloat("shadowFactor", shadowFactor);
-        objectShader.setBool("useSmoothShadows", useSmoothShadows);
-        objectShader.setFloat("exposure", exposure);
-        objectShader.setFloat("shadowBias", shadowBias);
-        objectShader.setFloat("dirShadowBias", dirShadowBias);
-        objectShader.setFloat("pointLightRadius", pointLightRadius);
-
-        parallaxShader.use();
-        parallaxShader.setVec3("lightPos", lightPos);
-        parallaxShader.setVec3("viewPos", camera->Position);
-        parallaxShader.setFloat("heightScale", 0.1f);
-
-        //render the objects normally (second pass)
-        glCullFace(GL_BACK);
-        for (auto& obj : objects) {obj->Draw();}
-
-        // Pointlight cubes
-        // pointlightcube.use();
-        // glDisable(GL_CULL_FACE);
-        // glBindVertexArray(lightVAO);
-        // vector<glm::vec3> pointLights = sr.getpointLights();
-        // for (unsigned int i = 0; i < NUM_POINT_LIGHTS; i++) {
-        //     glm::vec3 val;
-        //     glGetUniformfv(objectShader.ID, glGetUniformLocation(objectShader.ID, std::format("pointLights[{}].diffuse", i).c_str()), glm::value_ptr(val));
-        //     pointlightcube.setVec3("color", val);
-        //     model = glm::mat4(1.0f);
-        //     model = glm::translate(model, pointLights[i]);
-        //     model = glm::scale(model, glm::vec3(0.2f));
-        //     pointlightcube.setMat4("model", model);
-        //     glDrawArrays(GL_TRIANGLES, 0, 36);
-        // }
+            // showing the perspective of the dirLight for testing
+            rg.addPass("Depth Map Visualisation", [&](RenderGraph::PassContext& ctx) {
+                glDisable(GL_DEPTH_TEST);
+                depthTestShader.use();
+                depthTestShader.setInt("depthMap", 0);
+                depthTestShader.setInt("layer", std::clamp(settings.cascadeViewLayer, 0, dirShadows.settings.cascadeCount - 1));
+                glBindVertexArray(quadVAO);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, ctx.texture(dirShadowMap));
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glEnable(GL_DEPTH_TEST);
+            }).read(dirShadowMap).write(depthView, RenderGraph::DontCare);
+
+            // MARK: object picking
+            // read back the UI's requests from the resolved id buffer; results land a frame or two
+            // later and go back to the main thread with this frame's results
+            std::vector<ObjectPicker::Result> pickResults;
+            queuedPicks.insert(queuedPicks.end(), frame->picks.begin(), frame->picks.end());
+            if (renderToTexture && settings.useObjectIDPicking) {
+                rg.addPass("Object Picking", [&](RenderGraph::PassContext& ctx) {
+                    pickResults = picker.poll();
+                    std::vector<FrameSnapshots::Pick> stillPending;
+                    for (const FrameSnapshots::Pick& pick : queuedPicks) {
+                        bool issued = picker.request(pick.kind, ctx.texture(sceneIDs), pick.x, pick.y, pick.width, pick.height);
+                        if (!issued && pick.kind != ObjectPicker::Request::Hover) { stillPending.push_back(pick); }
+                    }
+                    queuedPicks = stillPending;
+                }).read(sceneIDs).sideEffect();
+            } else {
+                queuedPicks.clear();
+            }
 
-        // Grass
-        // grassShader.use();
-        // glBindVertexArray(grassVAO);
-        // glActiveTexture(GL_TEXTURE0);
-        // glBindTexture(GL_TEXTURE_2D, grassTexture);
-        // vector<glm::vec3> vegetation = sr.getVegetation();
-        // for (unsigned int i = 0; i < vegetation.size(); i++) {
-        //     model = glm::mat4(1.0f);
-        //     model = glm::translate(model, vegetation[i]);
-        //     grassShader.setMat4("model", model);
-        //     glDrawArrays(GL_TRIANGLES, 0, 6);
-        // }
+            // MARK: anti-aliasing
+            // the post-process modes resolve the scene colour into their own target, which the
+            // post-process pass reads instead
+            int antiAliased = sceneColor;
+            std::vector<std::pair<const RenderObject*, glm::mat4>> movedObjects;   // with last frame's model matrix
+            if (renderToTexture && settings.antiAliasing == FXAA) {
+                antiAliased = rg.createTexture("Anti-Aliased", {fbWidth, fbHeight, GL_RGBA16F, 0});
+                rg.addPass("FXAA", [&](RenderGraph::PassContext& ctx) {
+                    fxaaTimer.begin();
+                    glDisable(GL_DEPTH_TEST);
+                    fxaaShader.use();
+                    fxaaShader.setInt("screenTexture", 0);
+                    fxaaShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneColor));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    fxaaTimer.end();
+                }).read(sceneColor).write(antiAliased, RenderGraph::DontCare);
+            } else if (renderToTexture && settings.antiAliasing == SMAA) {
+                int smaaEdges = rg.createTexture("SMAA Edges", {fbWidth, fbHeight, GL_RG8, 0});
+                int smaaWeights = rg.createTexture("SMAA Weights", {fbWidth, fbHeight, GL_RGBA8, 0});
+                antiAliased = rg.createTexture("Anti-Aliased", {fbWidth, fbHeight, GL_RGBA16F, 0});
+                // pixels without an edge are discarded and keep the cleared zero
+                rg.addPass("SMAA Edges", [&](RenderGraph::PassContext& ctx) {
+                    smaaTimer[0].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    smaaEdgesShader.use();
+                    smaaEdgesShader.setInt("screenTexture", 0);
+                    smaaEdgesShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneColor));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    smaaTimer[0].end();
+                }).read(sceneColor).write(smaaEdges, RenderGraph::Clear);
+                rg.addPass("SMAA Weights", [&](RenderGraph::PassContext& ctx) {
+                    smaaTimer[1].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    smaaWeightsShader.use();
+                    smaaWeightsShader.setInt("edgesTexture", 0);
+                    smaaWeightsShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(smaaEdges));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    smaaTimer[1].end();
+                }).read(smaaEdges).write(smaaWeights, RenderGraph::DontCare);
+                rg.addPass("SMAA Blending", [&](RenderGraph::PassContext& ctx) {
+                    smaaTimer[2].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    smaaBlendShader.use();
+                    smaaBlendShader.setInt("screenTexture", 0);
+                    smaaBlendShader.setInt("weightsTexture", 1);
+                    smaaBlendShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneColor));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(smaaWeights));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    smaaTimer[2].end();
+                }).read(sceneColor).read(smaaWeights).write(antiAliased, RenderGraph::DontCare);
+            } else if (temporal) {
+                // the history textures live across frames, so they are imported rather than pooled
+                int motionVectors = rg.createTexture("Motion Vectors", {fbWidth, fbHeight, GL_RG16F, 0});
+                int history = rg.importTexture("TAA History", temporalAA.getHistoryRead(), GL_TEXTURE_2D, fbWidth, fbHeight, GL_RGBA16F);
+                antiAliased = rg.importTexture("TAA Resolve", temporalAA.getHistoryWrite(), GL_TEXTURE_2D, fbWidth, fbHeight, GL_RGBA16F);
+                rg.addPass("Camera Motion", [&](RenderGraph::PassContext& ctx) {
+                    taaTimer[0].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    cameraMotionShader.use();
+                    cameraMotionShader.setInt("depthTexture", 0);
+                    cameraMotionShader.setMat4("invViewProjection", glm::inverse(projection * view));
+                    cameraMotionShader.setMat4("viewProjection", temporalAA.getViewProjection());
+                    cameraMotionShader.setMat4("previousViewProjection", temporalAA.getPreviousViewProjection());
+                    cameraMotionShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneDepth));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    taaTimer[0].end();
+                }).read(sceneDepth).write(motionVectors, RenderGraph::DontCare);
+
+                // objects that moved since the last frame are drawn again with both matrices over
+                // the camera motion, depth tested against the scene so only their visible parts count
+                for (const RenderObject& obj : scene) {
+                    glm::mat4 previous;
+                    if (temporalAA.previousModel(obj.getID(), obj.getModelMatrix(), previous)) { movedObjects.push_back({&obj, previous}); }
+                }
+                if (!movedObjects.empty()) {
+                    rg.addPass("Object Motion", [&](RenderGraph::PassContext&) {
+                        taaTimer[1].begin();
+                        glEnable(GL_DEPTH_TEST);
+                        glDepthFunc(GL_LEQUAL);
+                        glDepthMask(GL_FALSE);
+                        // not every scene shader computes gl_Position the same way, so don't rely on equal depths
+                        glEnable(GL_POLYGON_OFFSET_FILL);
+                        glPolygonOffset(-1.0f, -1.0f);
+                        motionVectorShader.use();
+                        motionVectorShader.setMat4("viewProjection", temporalAA.getViewProjection());
+                        motionVectorShader.setMat4("previousViewProjection", temporalAA.getPreviousViewProjection());
+                        for (auto& [object, previous] : movedObjects) {
+                            motionVectorShader.setMat4("previousModel", previous);
+                            object->DrawDepth(motionVectorShader);
+                        }
+                        glDisable(GL_POLYGON_OFFSET_FILL);
+                        glDepthMask(GL_TRUE);
+                        glDepthFunc(GL_LESS);
+                        taaTimer[1].end();
+                    }).write(motionVectors, RenderGraph::Load).write(sceneDepth, RenderGraph::Load);
+                } else {
+                    taaTimer[1].reset();
+                }
 
-        // draw skybox (LAST BUT BEFORE TRANSPARENT)
-        glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        skyboxShader.setMat4("view", glm::mat4(glm::mat3(camera->GetViewMatrix())));
-        skyboxShader.setMat4("projection", projection);
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, currSkybox);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-
-        // Windows
-        // transparentShader.use();
-        // glBindVertexArray(transparentVAO);
-        // glActiveTexture(GL_TEXTURE0);
-        // glBindTexture(GL_TEXTURE_2D, transparentTexture);
-        // for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it) {
-        //     model = glm::mat4(1.0f);
-        //     model = glm::translate(model, it->second);
-        //     transparentShader.setMat4("model", model);
-        //     glDrawArrays(GL_TRIANGLES, 0, 6);
-        // }
+                rg.addPass("TAA Resolve", [&](RenderGraph::PassContext& ctx) {
+                    taaTimer[2].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    taaResolveShader.use();
+                    taaResolveShader.setInt("currentColor", 0);
+                    taaResolveShader.setInt("history", 1);
+                    taaResolveShader.setInt("motionVectors", 2);
+                    taaResolveShader.setInt("depthTexture", 3);
+                    taaResolveShader.setVec2("viewportSize", (float)fbWidth, (float)fbHeight);
+                    taaResolveShader.setBool("hasHistory", temporalAA.hasHistory());
+                    taaResolveShader.setFloat("feedback", settings.taaFeedback);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneColor));
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(history));
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(motionVectors));
+                    glActiveTexture(GL_TEXTURE3);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneDepth));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    temporalAA.markResolved();
+                    taaTimer[2].end();
+                }).read(sceneColor).read(history).read(motionVectors).read(sceneDepth).write(antiAliased, RenderGraph::DontCare);
+            }
 
-        //blit multisampled buffer(s) to normal colorbuffer of intermediate FBO. Image is stored in screenTexture
-        if(renderToTexture && useMSAA) {
-            glBindFramebuffer(GL_READ_FRAMEBUFFER, msaa.ID);
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer.ID);
-            glBlitFramebuffer(0, 0, fbWidth, fbHeight, 0, 0, fbWidth, fbHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-        }
+            // MARK: post-processing
+            // the stack's last pass composites into postColor and draws the selection outline
+            auto drawSelection = [&](Shader& shader, RenderGraph::PassContext& ctx) {
+                shader.setBool("showSelection", settings.useObjectIDPicking && settings.showSelectionOutline);
+                shader.setInt("idTexture", 1);
+                shader.setUInt("hoveredID", frame->hoveredID);
+                int numSelected = std::min((int)frame->selectedIDs.size(), 32);
+                shader.setInt("numSelected", numSelected);
+                for (int i = 0; i < numSelected; i++) { shader.setUInt("selectedIDs[" + std::to_string(i) + "]", frame->selectedIDs[i]); }
+                if (settings.useObjectIDPicking) {
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(sceneIDs));
+                }
+            };
+            std::vector<int> selectionReads;
+            if (settings.useObjectIDPicking) { selectionReads.push_back(sceneIDs); }
+            postStack.addPasses(rg, settings.postEffects, antiAliased, postColor, fbWidth, fbHeight, quadVAO, drawSelection, selectionReads);
+
+            // MARK: upscaling
+            // edge-adaptive upscale to the Scene window's size, then contrast-adaptive sharpening
+            int displayColor = postColor;
+            if (renderToTexture && (fbWidth != displayWidth || fbHeight != displayHeight)) {
+                int upscaled = rg.createTexture("Upscaled", {displayWidth, displayHeight, GL_RGBA16F, 0});
+                displayColor = rg.createTexture("Upscaled Sharpened", {displayWidth, displayHeight, GL_RGBA16F, 0});
+                rg.addPass("Upscale", [&](RenderGraph::PassContext& ctx) {
+                    upscaleTimer[0].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    upscaleShader.use();
+                    upscaleShader.setInt("source", 0);
+                    upscaleShader.setVec2("renderSize", (float)fbWidth, (float)fbHeight);
+                    upscaleShader.setVec2("displaySize", (float)displayWidth, (float)displayHeight);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(postColor));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    upscaleTimer[0].end();
+                }).read(postColor).write(upscaled, RenderGraph::DontCare);
+                rg.addPass("Upscale Sharpen", [&](RenderGraph::PassContext& ctx) {
+                    upscaleTimer[1].begin();
+                    glDisable(GL_DEPTH_TEST);
+                    upscaleSharpenShader.use();
+                    upscaleSharpenShader.setInt("source", 0);
+                    upscaleSharpenShader.setVec2("displaySize", (float)displayWidth, (float)displayHeight);
+                    upscaleSharpenShader.setFloat("sharpness", settings.dynamicResolution.sharpness);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, ctx.texture(upscaled));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    glEnable(GL_DEPTH_TEST);
+                    upscaleTimer[1].end();
+                }).read(upscaled).write(displayColor, RenderGraph::DontCare);
+            }
+
+            // whatever isn't reachable from the output (e.g. the depth map view) gets culled
+            int viewportOutput = settings.showDepthMap ? depthView : (renderToTexture ? displayColor : backbuffer);
+            rg.markOutput(viewportOutput);
+            rg.compile();
+            dynamicResolution.beginFrame();
+            rg.execute();
+            dynamicResolution.endFrame();
+            if (temporal) {
+                for (const RenderObject& obj : scene) { temporalAA.storeModel(obj.getID(), obj.getModelMatrix()); }
+            }
 
-        // showing the perspective of the dirLight for testing
-        if(showDepthMap && !renderToTexture) {
+            // the UI on top, pointed at this frame's scene
+            FrameSnapshots::retargetTexture(frame->drawData, frame->sceneTexture, rg.getTexture(viewportOutput));
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            depthTestShader.use();
-            depthTestShader.setInt("depthMap", 0);
-            glBindVertexArray(quadVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, depthMapBuffer.texture);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            ImGui_ImplOpenGL3_RenderDrawData(&frame->drawData);
+            streamBuffer.endFrame();
+
+            // swap chain
+            glfwSwapBuffers(window);
+
+            FrameSnapshots::Results results;
+            results.viewportTexture = rg.getTexture(viewportOutput);
+            results.viewportUV = rg.getUVScale(viewportOutput);
+            results.fbWidth = fbWidth;
+            results.fbHeight = fbHeight;
+            results.picks = std::move(pickResults);
+            results.graphStats = rg.getStats();
+            results.passList = rg.getPassList();
+            results.postTimings = postStack.getTimings();
+            for (int i = 0; i < (int)pointShadowSlots.size(); i++) {
+                int slot = pointShadowSlots[i];
+                if (slot < 0) continue;
+                results.shadowFaces.push_back({i, PointShadowMaps::TIER_SIZES[PointShadowMaps::slotTier(slot)], pointShadows.getFaceAges(slot)});
+            }
+            results.jobs = jobStats;
+            captureStats(results);
+            frames.finish(std::move(results));
         }
+        glfwMakeContextCurrent(nullptr);
+    });
 
-        // if rendering onto a quad
-        if(renderToTexture && !showDepthMap) {
-            glBindFramebuffer(GL_FRAMEBUFFER, postProcessFramebuffer.ID);
-            glDisable(GL_DEPTH_TEST);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-            screenShader.use();
-            screenShader.setBool("inverted", inverted);
-            screenShader.setBool("grayscale", grayscale);
-            screenShader.setBool("sharpen", sharpen);
-            screenShader.setBool("blur", blur);
-            screenShader.setBool("edgeDetection", edgeDetection);
-            glBindVertexArray(quadVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, framebuffer.texture); // color
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glEnable(GL_DEPTH_TEST);
-        } else {
-            glEnable(GL_DEPTH_TEST); // RE-ENABLE if not rendering to texture
-        }
+    // MARK: MAIN LOOP
+    // input and the UI run while the render thread draws the previous snapshot and the simulation
+    // steps on its own thread; what the render thread needs of the scene goes out in the next
+    // snapshot by value
+    simulation.start({camera->Position, lightPos, 0.0f}, simulationInput(Controller::Input{}, *camera));
+    while (!glfwWindowShouldClose(window)) {
+        glfwPollEvents();
+
+        // the keys are read here and handed to the simulation, which never waits for this loop
+        simulation.setInput(simulationInput(controller->pollInput(window), *camera));
 
-        // render IMGUI
-        renderIMGUI(postProcessFramebuffer, camera, io, window);
+        frames.waitForRenderer();
+        const FrameSnapshots::Results& results = frames.results();
 
-        // swap chain and IO handling
-        glfwSwapBuffers(window);
-        glfwPollEvents();  
-        
+        // the live camera and light are the newest step, for the UI to show and edit
+        simulationSample = simulation.sample();
+        camera->Position = simulationSample.current.cameraPosition;
+        lightPos = simulationSample.current.lightPos;
+
+        handlePickResults(results.picks);
+
+        // the back snapshot is free again; the UI's buttons leave their requests in it
+        FrameSnapshots::Snapshot& next = frames.back();
+        next.requests = {};
+
+        // Start new ImGui frame early so we can query the scene window size for the next snapshot
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ImGuizmo::BeginFrame();
+        ImGuiWindow* sceneWindow = ImGui::FindWindowByName("Scene");
+        if (sceneWindow) {lastSceneSize = sceneWindow->ContentRegionRect.GetSize();}
+
+        // render IMGUI, around the last finished frame's scene
+        renderIMGUI(results, camera, io, window);
+        ImGui::Render();
+
+        // whatever the UI moved is taken as it is, not interpolated towards
+        Simulation::State& simPrevious = simulationSample.previous;
+        Simulation::State& simCurrent = simulationSample.current;
+        if (camera->Position != simCurrent.cameraPosition || lightPos != simCurrent.lightPos) {
+            simulation.reset(camera->Position, lightPos);
+            simCurrent.cameraPosition = camera->Position;
+            simCurrent.lightPos = lightPos;
+            simPrevious = simCurrent;
+        }
+
+        const float alpha = simulationSample.alpha;
+        next.camera = *camera;
+        next.camera.Position = glm::mix(simPrevious.cameraPosition, simCurrent.cameraPosition, alpha);
+        next.lightPos = glm::mix(simPrevious.lightPos, simCurrent.lightPos, alpha);
+        next.displayWidth = std::max(1, (int)lastSceneSize.x);
+        next.displayHeight = std::max(1, (int)lastSceneSize.y);
+        next.sceneTexture = results.viewportTexture;
+        captureScene(next);
+        frames.captureDrawData(ImGui::GetDrawData());
+        frames.publish();
     }
+    simulation.stop();
+    frames.stop();
+    renderThread.join();
+    glfwMakeContextCurrent(window);
 
     // MARK: CLEANUP
     // cleaning up after ourselves
@@ -423,71 +1176,521 @@ void Renderer::Render(GLFWwindow* window, Camera* camera, Controller* controller
     glDeleteBuffers(1, &grassVBO);
     glDeleteBuffers(1, &transparentVBO);
     glDeleteBuffers(1, &skyboxVBO);
-    glDeleteBuffers(1, &uboMatrices);
-    deleteFramebuffer(framebuffer);
-    deleteFramebuffer(msaa);
-    deleteFramebuffer(depthMapBuffer);
+    streamBuffer.destroy();
+    dirShadows.destroy();
+    pointShadows.destroy();
+    for (GpuTimer& timer : pointShadowTimer) { timer.destroy(); }
+    renderGraph.destroy();
+    prePassTimer.destroy();
+    shadowMomentsTimer.destroy();
+    for (GpuTimer& timer : mainPassTimer) { timer.destroy(); }
+    for (GpuTimer& query : overdrawQuery) { query.destroy(); }
+    gBufferTimer.destroy();
+    deferredLightingTimer.destroy();
+    deferredForwardTimer.destroy();
+    visibilityTimer.destroy();
+    materialResolveTimer.destroy();
+    visibilityBuffer.destroy();
+    temporalAA.destroy();
+    occlusionQueries.destroy();
+    postStack.destroy();
+    fxaaTimer.destroy();
+    for (GpuTimer& timer : upscaleTimer) { timer.destroy(); }
+    dynamicResolution.destroy();
+    for (GpuTimer& timer : smaaTimer) { timer.destroy(); }
+    for (GpuTimer& timer : taaTimer) { timer.destroy(); }
+    picker.destroy();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 }
 
-// MARK: first pass function
-glm::mat4 Renderer::firstPass(Shader depthShader, Framebuffer framebuffer, Framebuffer depthMapBuffer, Framebuffer* pointLightsBuffers, Shader pointDepthShader, int fbWidth, int fbHeight) {
-    //variables for shadowing
-    glm::mat4 lightProjection, lightView, lightSpaceMatrix;
-    float near_plane = 0.1f, far_plane = 100.0f;
-    lightProjection = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, near_plane, far_plane);
-    lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    lightSpaceMatrix = lightProjection * lightView;
+// MARK: simulation
+// what the simulation needs of this frame's input and settings, by value
+Simulation::Input Renderer::simulationInput(const Controller::Input& keys, const Camera& camera) const {
+    Simulation::Input input;
+    input.keys = keys;
+    input.camera = camera;
+    input.animateLight = animateDirLight;
+    input.orbitSpeed = orbitSpeed;
+    input.orbitRadius = orbitRadius;
+    input.orbitCenter = orbitCenter;
+    input.stepHz = simulationHz;
+    input.maxStepsPerFrame = maxSimulationSteps;
+    return input;
+}
 
+// MARK: shadow passes
+// draw casters into one cascade layer of texture (live or cache), which the caller has cleared
+// or filled. sceneTriangles is what drawing every object would have cost, for the culling stats
+void Renderer::renderDirectionalShadow(Shader& depthShader, unsigned int texture, int cascade, const std::vector<ShadowCaster>& casters, size_t sceneTriangles) {
+    dirShadows.bindLayer(texture, cascade);
     glCullFace(GL_FRONT);
     depthShader.use();
-    depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapBuffer.ID);
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    for (auto& obj : objects) { if(!obj->is_light()) { obj->Draw(depthShader); }}
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.ID);
-    glViewport(0, 0, fbWidth, fbHeight);
-
-    // clear the buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-    // create depth cubemap transformation matrices
-    float point_near_plane = 0.1f;
-    float point_far_plane = 25.0f;
-
-    // render scene to depth cubemap for each point light
-    for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
-        glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)POINT_SHADOW_WIDTH / (float)POINT_SHADOW_HEIGHT, point_near_plane, point_far_plane);
-        std::vector<glm::mat4> shadowTransforms;
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lights[i]->getPosition(), lights[i]->getPosition() + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lights[i]->getPosition(), lights[i]->getPosition() + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lights[i]->getPosition(), lights[i]->getPosition() + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lights[i]->getPosition(), lights[i]->getPosition() + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lights[i]->getPosition(), lights[i]->getPosition() + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-        shadowTransforms.push_back(shadowProj * glm::lookAt(lights[i]->getPosition(), lights[i]->getPosition() + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-        glViewport(0, 0, POINT_SHADOW_WIDTH, POINT_SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, pointLightsBuffers[i].ID);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        pointDepthShader.use();
-        for (unsigned int face = 0; face < 6; ++face) { pointDepthShader.setMat4("shadowMatrices[" + std::to_string(face) + "]", shadowTransforms[face]); }
-        pointDepthShader.setFloat("far_plane", point_far_plane);
-        pointDepthShader.setVec3("lightPos", lights[i]->getPosition());
-        for (auto& obj : objects) { if(!obj->is_light()) { obj->Draw(pointDepthShader); }}
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, fbWidth, fbHeight);
-        glActiveTexture(GL_TEXTURE0 + 5 + i);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, pointLightsBuffers[i].texture);
-    }
-
-    //setting shadow texture
-    glActiveTexture(GL_TEXTURE0 + 4);
-    glBindTexture(GL_TEXTURE_2D, depthMapBuffer.texture);
-
-
-    return lightSpaceMatrix;
+    depthShader.setMat4("lightSpaceMatrix", dirShadows.getCascade(cascade).matrix);
+    for (const ShadowCaster& caster : casters) {
+        caster.object->DrawDepth(depthShader);
+        shadowTriangles += caster.triangles;
+    }
+    shadowTrianglesUnculled += sceneTriangles;
+}
+
+// turn the live cascades into EVSM moments, blur them horizontally into the scratch layer and
+// vertically back, then rebuild the mip chain the shaders pick from
+void Renderer::filterShadowMoments(Shader& momentShader, Shader& blurShader, unsigned int quadVAO, const std::vector<int>& cascades) {
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(quadVAO);
+    glActiveTexture(GL_TEXTURE0);
+    for (int cascade : cascades) {
+        dirShadows.bindMomentLayer(dirShadows.getMomentTexture(), cascade);
+        momentShader.use();
+        momentShader.setInt("depthMap", 0);
+        momentShader.setInt("layer", cascade);
+        momentShader.setVec2("exponents", CascadedShadowMaps::EVSM_EXPONENTS[0], CascadedShadowMaps::EVSM_EXPONENTS[1]);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadows.getTexture());
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        if (dirShadows.settings.blurRadius > 0) {
+            blurShader.use();
+            blurShader.setInt("source", 0);
+            blurShader.setInt("radius", dirShadows.settings.blurRadius);
+            dirShadows.bindMomentLayer(dirShadows.getBlurTexture(), 0);
+            blurShader.setInt("layer", cascade);
+            glUniform2i(glGetUniformLocation(blurShader.ID, "direction"), 1, 0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadows.getMomentTexture());
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            dirShadows.bindMomentLayer(dirShadows.getMomentTexture(), cascade);
+            blurShader.setInt("layer", 0);
+            glUniform2i(glGetUniformLocation(blurShader.ID, "direction"), 0, 1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadows.getBlurTexture());
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        dirShadows.markMomentsFiltered(cascade);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadows.getMomentTexture());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glEnable(GL_DEPTH_TEST);
+}
+
+// render casters into the given faces of one shadow slot; the render graph has bound the slot's
+// whole tier array (live or cache, which is texture) and the caller has cleared or filled those
+// faces. every method only sends a caster to the faces it overlaps
+void Renderer::renderPointShadow(const PointDepthShaders& shaders, int method, unsigned int texture, const PointLightPacket& light, int slot, unsigned int faces, const std::vector<ShadowCaster>& casters, size_t sceneTriangles) {
+    // the face matrices come with the light's packet
+    const glm::vec3& lightPosition = light.position;
+    float point_far_plane = POINT_SHADOW_FAR;
+    glCullFace(GL_FRONT);
+    int cubeLayer = PointShadowMaps::slotLayer(slot);
+    int size = PointShadowMaps::TIER_SIZES[PointShadowMaps::slotTier(slot)];
+
+    if (method == PerFacePasses) {
+        Shader& shader = *shaders.perFace;
+        shader.use();
+        shader.setFloat("far_plane", point_far_plane);
+        shader.setVec3("lightPos", lightPosition);
+        for (int face = 0; face < 6; face++) {
+            unsigned int bit = 1u << face;
+            if (!(faces & bit)) continue;
+            pointShadows.bindFace(texture, cubeLayer * 6 + face, size);
+            shader.setMat4("shadowMatrix", light.faceMatrices[face]);
+            for (const ShadowCaster& caster : casters) {
+                if (!(caster.faces & bit)) continue;
+                caster.object->DrawDepth(shader);
+                shadowTriangles += caster.triangles;
+            }
+        }
+    } else {
+        Shader& shader = method == LayeredInstancing ? *shaders.layered : *shaders.geometry;
+        shader.use();
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, "shadowMatrices[0]"), 6, GL_FALSE, glm::value_ptr(light.faceMatrices[0]));
+        shader.setFloat("far_plane", point_far_plane);
+        shader.setVec3("lightPos", lightPosition);
+        shader.setInt("cubeLayer", cubeLayer);
+        GLint facesLocation = glGetUniformLocation(shader.ID, "faces[0]");
+        for (const ShadowCaster& caster : casters) {
+            unsigned int casterFaces = caster.faces & faces;
+            if (!casterFaces) continue;
+            if (method == LayeredInstancing) {
+                // one instance per face, the vertex shader looks the face up by gl_InstanceID
+                int faceList[6];
+                int count = 0;
+                for (int face = 0; face < 6; face++) { if (casterFaces & (1u << face)) faceList[count++] = face; }
+                glUniform1iv(facesLocation, count, faceList);
+                caster.object->DrawDepth(shader, count);
+            } else {
+                // the geometry shader only emits the triangles to the faces in the mask
+                shader.setInt("faceMask", (int)casterFaces);
+                caster.object->DrawDepth(shader);
+            }
+            shadowTriangles += caster.triangles * std::popcount(casterFaces);
+        }
+    }
+    shadowTrianglesUnculled += sceneTriangles * std::popcount(faces);
+}
+
+// MARK: frame packets
+// every shadow caster with its bounds, static ones apart while shadow caching is on. runs as a
+// job alongside the frame's first GL work, so it only reads the snapshot
+void Renderer::gatherCasters(const std::vector<RenderObject>& scene, bool useShadowCaching) {
+    FramePackets& p = packets;
+    p.staticCasters.clear();
+    p.dynamicCasters.clear();
+    p.allCasterTriangles = 0;
+    p.castersMin = glm::vec3(FLT_MAX);
+    p.castersMax = glm::vec3(-FLT_MAX);
+    for (const RenderObject& obj : scene) {
+        if (obj.is_light()) continue;
+        ShadowCaster caster;
+        caster.object = &obj;
+        obj.getBoundingSphere(caster.center, caster.radius);
+        caster.triangles = obj.getTriangleCount();
+        caster.faces = PointShadowMaps::ALL_FACES;
+        p.allCasterTriangles += caster.triangles;
+        p.castersMin = glm::min(p.castersMin, caster.center - caster.radius);
+        p.castersMax = glm::max(p.castersMax, caster.center + caster.radius);
+        (obj.isStatic() && useShadowCaching ? p.staticCasters : p.dynamicCasters).push_back(caster);
+    }
+}
+
+// objects grouped by shader so programs and their textures switch as rarely as possible, front to
+// back within a shader so the early depth test rejects more of what follows
+void Renderer::sortDrawOrder(const std::vector<RenderObject>& scene, const glm::vec3& cameraPosition) {
+    std::vector<Shader*> shaders;       // ranked by first use, keeps the order stable
+    std::vector<std::pair<uint64_t, const RenderObject*>> keyed;
+    keyed.reserve(scene.size());
+    for (const RenderObject& obj : scene) {
+        auto rank = std::find(shaders.begin(), shaders.end(), obj.getShader()) - shaders.begin();
+        if (rank == (long)shaders.size()) shaders.push_back(obj.getShader());
+        glm::vec3 center;
+        float radius;
+        obj.getBoundingSphere(center, radius);
+        // a non-negative float's bits sort like the float itself
+        float distance = std::max(glm::length(center - cameraPosition) - radius, 0.0f);
+        uint32_t distanceBits;
+        std::memcpy(&distanceBits, &distance, sizeof(distanceBits));
+        keyed.push_back({((uint64_t)rank << 32) | distanceBits, &obj});
+    }
+    std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    packets.drawOrder.clear();
+    for (auto& entry : keyed) { packets.drawOrder.push_back(entry.second); }
+}
+
+// caster lists for every cascade and every shadowed point light, plus the lights' face matrices;
+// each cascade and light is its own job
+void Renderer::buildShadowPackets(const std::vector<PointShadowMaps::Candidate>& candidates) {
+    static const glm::vec3 faceDirections[6] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+    };
+    static const glm::vec3 faceUps[6] = {
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+        glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+    };
+    const glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, POINT_SHADOW_FAR);
+    FramePackets& p = packets;
+    const size_t cascades = (size_t)dirShadows.settings.cascadeCount;
+    p.cascadeStatic.resize(cascades);
+    p.cascadeDynamic.resize(cascades);
+    p.pointLights.resize(candidates.size());
+
+    // casters within a point light's range, each tagged with the cube faces it shows up in
+    auto castersForLight = [](const std::vector<ShadowCaster>& casters, const PointLightPacket& light, std::vector<ShadowCaster>& result) {
+        result.clear();
+        for (const ShadowCaster& caster : casters) {
+            glm::vec3 d = caster.center - light.position;
+            if (glm::dot(d, d) > (light.radius + caster.radius) * (light.radius + caster.radius)) continue;
+            result.push_back(caster);
+            result.back().faces = PointShadowMaps::facesOverlapping(light.position, caster.center, caster.radius);
+        }
+    };
+    // casters inside one cascade's orthographic box
+    auto castersForCascade = [&](const std::vector<ShadowCaster>& casters, int cascade, std::vector<ShadowCaster>& result) {
+        result.clear();
+        const glm::mat4& matrix = dirShadows.getCascade(cascade).matrix;
+        for (const ShadowCaster& caster : casters) {
+            if (CascadedShadowMaps::sphereInCascade(matrix, caster.center, caster.radius)) result.push_back(caster);
+        }
+    };
+    jobs.parallelFor(0, cascades + candidates.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            if (i < cascades) {
+                castersForCascade(p.staticCasters, (int)i, p.cascadeStatic[i]);
+                castersForCascade(p.dynamicCasters, (int)i, p.cascadeDynamic[i]);
+                continue;
+            }
+            size_t c = i - cascades;
+            PointLightPacket& light = p.pointLights[c];
+            light.position = candidates[c].position;
+            light.radius = candidates[c].radius;
+            light.dynamicFaces = 0;
+            if (pointShadowSlots[c] < 0) {
+                light.staticCasters.clear();
+                light.dynamicCasters.clear();
+                continue;
+            }
+            for (int face = 0; face < 6; face++) {
+                light.faceMatrices[face] = shadowProj * glm::lookAt(light.position, light.position + faceDirections[face], faceUps[face]);
+            }
+            castersForLight(p.staticCasters, light, light.staticCasters);
+            castersForLight(p.dynamicCasters, light, light.dynamicCasters);
+            for (const ShadowCaster& caster : light.dynamicCasters) { light.dynamicFaces |= caster.faces; }
+        }
+    });
+}
+
+// MARK: shadow benchmark
+// steps a running benchmark by one frame: every method gets a warm-up, then BENCHMARK_FRAMES
+// measured frames, and its smoothed timer is recorded before the next method takes over. the
+// frame draws with bench.method while it runs and with the chosen method again once it is done
+void Renderer::updateShadowBenchmark() {
+    ShadowBenchmark& bench = shadowBenchmark;
+    if (bench.method < 0) return;
+    bench.frames++;
+    if (bench.frames == BENCHMARK_WARMUP_FRAMES) pointShadowTimer[bench.method].reset();
+    if (bench.frames < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES) return;
+    bench.ms[bench.method] = pointShadowTimer[bench.method].getMilliseconds();
+    bench.faces = 6 * pointShadows.getStats().shadowed;
+    bench.frames = 0;
+    do { bench.method++; } while (bench.method == LayeredInstancing && !hasVertexLayer);
+    if (bench.method >= POINT_SHADOW_METHODS) bench.method = -1;
+}
+
+// static casters are baked into the shadow caches, so any change to one (moved, made dynamic,
+// added or deleted) drops the caches of the lights in range of where it was and where it is
+void Renderer::trackStaticCasters(const std::vector<RenderObject>& scene) {
+    for (auto& entry : staticCasterStates) { entry.second.seen = false; }
+    for (const RenderObject& obj : scene) {
+        if (obj.is_light()) continue;
+        auto it = staticCasterStates.find(obj.getID());
+        bool known = it != staticCasterStates.end();
+        if (!obj.isStatic()) continue;
+        if (known && it->second.version == obj.getTransformVersion()) {
+            it->second.seen = true;
+            continue;
+        }
+        if (known) { invalidateShadowCaches(it->second.center, it->second.radius); }
+        StaticCaster caster;
+        caster.version = obj.getTransformVersion();
+        obj.getBoundingSphere(caster.center, caster.radius);
+        caster.seen = true;
+        invalidateShadowCaches(caster.center, caster.radius);
+        staticCasterStates[obj.getID()] = caster;
+    }
+    for (auto it = staticCasterStates.begin(); it != staticCasterStates.end();) {
+        if (it->second.seen) { ++it; continue; }
+        invalidateShadowCaches(it->second.center, it->second.radius);
+        it = staticCasterStates.erase(it);
+    }
+}
+
+void Renderer::invalidateShadowCaches(const glm::vec3& center, float radius) {
+    pointShadows.invalidate(center, radius);
+    dirShadows.invalidate(center, radius);
+}
+
+// the unit cube transform that covers the object's bounds, slightly inflated so the query doesn't
+// lose against geometry it touches. false when there are no bounds or the camera is inside them,
+// a box seen from within has nothing in front of the near plane to rasterise
+bool Renderer::occlusionBox(const RenderObject* obj, const glm::vec3& cameraPosition, glm::mat4& box) {
+    const Model& model = obj->getModel();
+    if (model.boundsMin.x > model.boundsMax.x) return false;
+    glm::mat4 modelMatrix = obj->getModelMatrix();
+    glm::vec3 center = 0.5f * (model.boundsMin + model.boundsMax);
+    glm::vec3 halfExtent = 0.5f * (model.boundsMax - model.boundsMin) * 1.01f + glm::vec3(1e-3f);
+    float minScale = std::min(glm::length(glm::vec3(modelMatrix[0])), std::min(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    glm::vec3 local = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.0f));
+    glm::vec3 reach = halfExtent + glm::vec3(2.0f * 0.1f / std::max(minScale, 1e-6f));     // twice the near plane
+    if (glm::all(glm::lessThan(glm::abs(local - center), reach))) return false;
+    box = modelMatrix * glm::translate(glm::mat4(1.0f), center) * glm::scale(glm::mat4(1.0f), halfExtent);
+    return true;
+}
+
+// MARK: lighting uniforms
+// everything the forward object shader and the deferred lighting shader share; the cluster
+// buffers themselves are uploaded once per frame in Render
+void Renderer::setLightingUniforms(Shader& shader, const FrameSnapshots::Snapshot& frame, int fbWidth, int fbHeight) {
+    const Camera* camera = &frame.camera;
+    const RenderSettings& settings = frame.settings;
+    shader.use();
+    // point shadow tiers live on units 5.., the uniform point lights get their slots directly
+    int tierUnits[PointShadowMaps::TIER_COUNT];
+    for (int t = 0; t < PointShadowMaps::TIER_COUNT; t++) { tierUnits[t] = 5 + t; }
+    glUniform1iv(glGetUniformLocation(shader.ID, "pointShadowMaps[0]"), PointShadowMaps::TIER_COUNT, tierUnits);
+    constexpr int MAX_POINT_LIGHTS = 16;
+    int slots[MAX_POINT_LIGHTS];
+    for (int i = 0; i < MAX_POINT_LIGHTS; i++) { slots[i] = i < (int)pointShadowSlots.size() ? pointShadowSlots[i] : -1; }
+    glUniform1iv(glGetUniformLocation(shader.ID, "pointShadowSlots[0]"), MAX_POINT_LIGHTS, slots);
+    sr.setParams(shader, *camera);
+    sr.updatePointLights(shader, frame.lights);
+    shader.setVec3("lightPos", frame.lightPos);
+    shader.setFloat("far_plane", POINT_SHADOW_FAR);
+    shader.setInt("shadowMap", settings.shadowItem);
+    // cascades are picked by view depth along the camera's forward axis
+    glm::mat4 cascadeMatrices[CascadedShadowMaps::MAX_CASCADES];
+    float cascadeSplits[CascadedShadowMaps::MAX_CASCADES], cascadeTexelSizes[CascadedShadowMaps::MAX_CASCADES];
+    for (int i = 0; i < CascadedShadowMaps::MAX_CASCADES; i++) {
+        const CascadedShadowMaps::Cascade& cascade = dirShadows.getCascade(i);
+        cascadeMatrices[i] = cascade.matrix;
+        cascadeSplits[i] = cascade.splitFar;
+        cascadeTexelSizes[i] = cascade.texelSize;
+    }
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "cascadeMatrices[0]"), CascadedShadowMaps::MAX_CASCADES, GL_FALSE, glm::value_ptr(cascadeMatrices[0]));
+    glUniform1fv(glGetUniformLocation(shader.ID, "cascadeSplits[0]"), CascadedShadowMaps::MAX_CASCADES, cascadeSplits);
+    glUniform1fv(glGetUniformLocation(shader.ID, "cascadeTexelSizes[0]"), CascadedShadowMaps::MAX_CASCADES, cascadeTexelSizes);
+    shader.setInt("cascadeCount", dirShadows.settings.cascadeCount);
+    shader.setVec3("viewForward", camera->Front);
+    shader.setBool("showCascades", settings.showCascades);
+    shader.setInt("shadowMoments", 8);
+    shader.setBool("useShadowMoments", dirShadows.settings.filter == CascadedShadowMaps::MomentFilter);
+    shader.setVec2("evsmExponents", CascadedShadowMaps::EVSM_EXPONENTS[0], CascadedShadowMaps::EVSM_EXPONENTS[1]);
+    shader.setFloat("lightBleedReduction", dirShadows.settings.lightBleedReduction);
+    shader.setFloat("pixelSpread", 2.0f * std::tan(glm::radians(camera->Zoom) * 0.5f) / fbHeight);
+    shader.setFloat("momentTexelScale", (float)CascadedShadowMaps::RESOLUTION / CascadedShadowMaps::MOMENT_RESOLUTION);
+    shader.setInt("NR_POINT_LIGHTS", (int)frame.lights.size());
+
+    // imgui uniforms
+    shader.setBool("useAmbient", settings.useAmbient);
+    shader.setBool("useDiffuse", settings.useDiffuse);
+    shader.setBool("useSpecular", settings.useSpecular);
+    shader.setBool("useBlinn", settings.useBlinn);
+    shader.setBool("useFlashlight", settings.useFlashlight);
+    shader.setBool("useDirectionalLight", settings.useDirectionalLight);
+    shader.setBool("usePointLight", settings.usePointLight);
+    shader.setBool("showDepthBuffer", settings.showDepthBuffer);
+    shader.setFloat("flashlightIntensity", settings.flashlightIntensity);
+    shader.setFloat("directionalLightIntensity", settings.directionLightIntensity);
+    shader.setFloat("pointLightIntensity", settings.pointLightIntensity);
+    shader.setBool("useShadows", settings.useShadows);
+    shader.setBool("useClusteredLighting", settings.useClusteredLighting);
+    shader.setBool("showClusterHeatmap", settings.useClusteredLighting && settings.showClusterHeatmap);
+    if (settings.useClusteredLighting) {
+        glUniform3ui(glGetUniformLocation(shader.ID, "clusterGrid"), ClusterGrid::GRID_X, ClusterGrid::GRID_Y, ClusterGrid::GRID_Z);
+        shader.setVec2("clusterTileSize", (float)fbWidth / ClusterGrid::GRID_X, (float)fbHeight / ClusterGrid::GRID_Y);
+        shader.setVec4("clusterDepthSlicing", clusterGrid.getDepthSlicing());
+    }
+    shader.setBool("useNormalMaps", settings.useNormalMaps);
+    shader.setFloat("shadowFactor", settings.shadowFactor);
+    shader.setBool("useSmoothShadows", settings.useSmoothShadows);
+    shader.setFloat("exposure", settings.exposure);
+    shader.setFloat("shadowBias", settings.shadowBias);
+    shader.setFloat("dirShadowBias", settings.dirShadowBias);
+    shader.setFloat("pointLightRadius", settings.pointLightRadius);
+}
+
+// MARK: depth pre-pass mode
+// overdraw is measured in whichever pass does the depth testing with GL_LESS (the pre-pass when
+// it runs, the main pass otherwise), so both modes report the same quantity. the deferred paths
+// measure neither, and without the pre-pass the main pass can't while hardware occlusion queries
+// are on; auto mode then holds whatever it has, and it only decides on results of the current mode
+void Renderer::updateDepthPrePassMode(const RenderSettings& settings, int width, int height, int samples, bool deferred, bool hardwareQueries) {
+    bool active = depthPrePassActive;
+    GpuTimer& query = overdrawQuery[active];
+    const bool measurable = !deferred && (active ? renderToTexture : !hardwareQueries);
+    query.collect();
+    if (!measurable) {
+        // what is there would be stale by the time the pass is measured again
+        query.reset();
+    } else if (query.hasResult()) {
+        double pixels = (double)width * height * std::max(1, samples);
+        overdraw = (float)(query.getLast() / pixels);
+    }
+    overdrawMeasured = measurable && query.hasResult();
+
+    if (settings.depthPrePassMode == PrePassOff) { active = false; }
+    else if (settings.depthPrePassMode == PrePassOn) { active = true; }
+    else if (overdrawMeasured && !active && overdraw > settings.overdrawEnableThreshold) { active = true; }
+    else if (overdrawMeasured && active && overdraw < settings.overdrawDisableThreshold) { active = false; }
+    if (active != depthPrePassActive) {
+        // anything the mode being entered has in flight is from the last time it ran
+        overdrawQuery[active].reset();
+        depthPrePassActive = active;
+    }
+}
+
+// MARK: frame stats
+// copies of everything the debug UI shows about the frame just submitted, so the UI never reads
+// what the render thread is changing
+void Renderer::captureStats(FrameSnapshots::Results& results) {
+    results.packetWaitMs = packetWaitMs;
+    results.packetBuildMs = packetBuildMs;
+    results.staticCasters = (int)packets.staticCasters.size();
+    results.dynamicCasters = (int)packets.dynamicCasters.size();
+    results.drawOrder = (int)packets.drawOrder.size();
+    results.trackedStaticCasters = (int)staticCasterStates.size();
+    results.shadowTriangles = shadowTriangles;
+    results.shadowTrianglesUnculled = shadowTrianglesUnculled;
+    results.cascadeStats = dirShadows.getStats();
+    for (int i = 0; i < CascadedShadowMaps::MAX_CASCADES; i++) { results.cascades[i] = dirShadows.getCascade(i); }
+    results.cascadeMemoryMB = dirShadows.getMemoryMB();
+    results.pointShadowStats = pointShadows.getStats();
+    results.shadowBenchmark.method = shadowBenchmark.method;
+    results.shadowBenchmark.faces = shadowBenchmark.faces;
+    std::copy(std::begin(shadowBenchmark.ms), std::end(shadowBenchmark.ms), results.shadowBenchmark.ms);
+    results.clusterStats = clusterGrid.getStats();
+    results.visibilityStats = visibilityBuffer.getStats();
+    results.occlusionStats = occlusionCuller.getStats();
+    results.queryStats = occlusionQueries.getStats();
+    results.objectsDrawn = objectsDrawn;
+    results.prePassActive = depthPrePassActive;
+    results.overdrawMeasured = overdrawMeasured;
+    results.overdraw = overdraw;
+    results.taaWidth = temporalAA.getWidth();
+    results.taaHeight = temporalAA.getHeight();
+    results.taaResamples = temporalAA.getResamples();
+    results.postVariants = postStack.getCompiledVariants();
+    results.resolutionScale = dynamicResolution.getScale();
+    results.gpuFrameMeasured = dynamicResolution.hasMeasurement();
+    results.gpuFrameMs = dynamicResolution.getGpuMilliseconds();
+    results.streamStats = streamBuffer.getStats();
+    results.pickLatency = picker.getLastLatency();
+
+    FrameSnapshots::Results::GpuTimes& gpu = results.gpu;
+    gpu.prePass = prePassTimer.getReading();
+    for (int i = 0; i < 2; i++) { gpu.mainPass[i] = mainPassTimer[i].getReading(); }
+    gpu.gBuffer = gBufferTimer.getReading();
+    gpu.visibility = visibilityTimer.getReading();
+    gpu.materialResolve = materialResolveTimer.getReading();
+    gpu.deferredLighting = deferredLightingTimer.getReading();
+    gpu.deferredForward = deferredForwardTimer.getReading();
+    gpu.fxaa = fxaaTimer.getReading();
+    for (int i = 0; i < 3; i++) {
+        gpu.smaa[i] = smaaTimer[i].getReading();
+        gpu.taa[i] = taaTimer[i].getReading();
+    }
+    for (int i = 0; i < 2; i++) { gpu.upscale[i] = upscaleTimer[i].getReading(); }
+    gpu.shadowMoments = shadowMomentsTimer.getReading();
+    for (int m = 0; m < POINT_SHADOW_METHODS; m++) { gpu.pointShadows[m] = pointShadowTimer[m].getReading(); }
+}
+
+// MARK: Pick results
+// on the main thread, as the render thread hands them back
+void Renderer::handlePickResults(const std::vector<ObjectPicker::Result>& results) {
+    auto findObject = [&](unsigned int id) -> std::pair<Object*, int> {
+        for (int i = 0; i < (int)objects.size(); i++) {
+            if (objects[i]->getID() == id) { return { objects[i].get(), i }; }
+        }
+        return { nullptr, -1 };
+    };
+
+    for (const ObjectPicker::Result& result : results) {
+        if (result.kind == ObjectPicker::Request::Hover) {
+            hoveredID = result.ids.empty() ? 0 : result.ids.front();
+            continue;
+        }
+
+        ui.selected = nullptr;
+        ui.selectedIndex = -1;
+        ui.selectedIDs.clear();
+        for (unsigned int id : result.ids) {
+            auto [obj, index] = findObject(id);
+            if (!obj) continue;
+            ui.selectedIDs.push_back(id);
+            if (!ui.selected) {
+                ui.selected = obj;
+                ui.selectedIndex = index;
+            }
+        }
+    }
 }
 
 // MARK: Rebuild Lights
@@ -505,6 +1708,67 @@ void Renderer::rebuildLights() {
     }
 }
 
+// MARK: scene snapshot
+// the settings, every object as the render thread will see it, the uniform point lights among
+// them, and what the UI wants highlighted and picked. deleted objects go along to be freed on the
+// render thread
+void Renderer::captureScene(FrameSnapshots::Snapshot& next) {
+    next.settings = settings;
+    next.objects.clear();
+    next.lights.clear();
+    next.objects.reserve(objects.size());
+    for (auto& obj : objects) { next.objects.emplace_back(*obj); }
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (std::find(lights.begin(), lights.end(), objects[i].get()) != lights.end()) { next.lights.push_back(&next.objects[i]); }
+    }
+    for (auto& obj : retiredObjects) { next.retired.push_back(std::move(obj)); }
+    retiredObjects.clear();
+
+    if (!renderToTexture || !settings.useObjectIDPicking) {
+        pendingPicks.clear();
+        hoveredID = 0;
+    }
+    next.picks = std::move(pendingPicks);
+    pendingPicks.clear();
+    next.hoveredID = hoveredID;
+    next.selectedIDs = ui.selectedIDs;
+}
+
+// MARK: cluster lights
+// scene lights first (in the same order as lights), then the debug swarm; shadow slots are
+// filled in afterwards by the point shadow allocation
+void Renderer::gatherClusterLights(const std::vector<RenderObject>& scene, int swarmCount, float swarmRadius) {
+    clusterLights.clear();
+    clusterLightKeys.clear();
+    for (const RenderObject& obj : scene) {
+        if (!obj.is_light()) continue;
+        clusterLightKeys.push_back(obj.getID());
+        glm::vec3 color = obj.getLightColor();
+        // distance where 1 / (1 + 0.09d + 0.032d^2) drops below 5/256 of the brightest channel
+        float brightest = std::max(color.r, std::max(color.g, color.b));
+        float linear = 0.09f, quadratic = 0.032f;
+        float discriminant = std::max(0.0f, linear * linear - 4.0f * quadratic * (1.0f - brightest * 256.0f / 5.0f));
+        float radius = (-linear + std::sqrt(discriminant)) / (2.0f * quadratic);
+        clusterLights.push_back({obj.getPosition(), std::max(radius, 0.1f), color, -1});
+    }
+
+    if ((int)lightSwarm.size() != swarmCount || swarmRadius != builtSwarmRadius) {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        lightSwarm.clear();
+        for (int i = 0; i < swarmCount; i++) {
+            glm::vec3 position(-20.0f + 40.0f * unit(rng), -0.5f + 4.5f * unit(rng), -20.0f + 30.0f * unit(rng));
+            glm::vec3 color(unit(rng), unit(rng), unit(rng));
+            color /= std::max(color.r, std::max(color.g, color.b));
+            lightSwarm.push_back({position, swarmRadius * (0.5f + 0.5f * unit(rng)), color, -1});
+        }
+        builtSwarmRadius = swarmRadius;
+    }
+    clusterLights.insert(clusterLights.end(), lightSwarm.begin(), lightSwarm.end());
+    // object IDs count up from 1, so the swarm takes keys from the top of the range
+    for (int i = 0; i < (int)lightSwarm.size(); i++) { clusterLightKeys.push_back(0x80000000u | (unsigned int)i); }
+}
+
 // MARK: initialize ImGUI
 ImGuiIO& Renderer::initImGui(GLFWwindow* window) {
     IMGUI_CHECKVERSION();
@@ -528,7 +1792,11 @@ ImGuiIO& Renderer::initImGui(GLFWwindow* window) {
 }
 
 //MARK: IMGUI render function
-void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, ImGuiIO& io, GLFWwindow* window) {
+void Renderer::renderIMGUI(const FrameSnapshots::Results& results, Camera* camera, ImGuiIO& io, GLFWwindow* window) {
+    const unsigned int viewportTexture = results.viewportTexture;
+    const glm::vec2 viewportUV = results.viewportUV;
+    const int fbWidth = results.fbWidth, fbHeight = results.fbHeight;
+
     // Set up fullscreen host window for DockSpace
     ImGuiWindowFlags dockspace_window_flags = 0;
     const ImGuiViewport* viewport = ImGui::GetMainViewport();
@@ -609,7 +1877,11 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
                     false,
                     ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
     ImVec2 vAvail = ImGui::GetContentRegionAvail();
-    ImGui::Image((void*)(intptr_t)postProcessFramebuffer.texture, vAvail, ImVec2(0,1), ImVec2(1,0));
+    // the target may be a larger pooled texture; only show the part that was rendered to
+    ImGui::Image((void*)(intptr_t)viewportTexture, vAvail, ImVec2(0, viewportUV.y), ImVec2(viewportUV.x, 0));
+    const ImVec2 imageMin  = ImGui::GetItemRectMin();
+    const ImVec2 imageSize = ImGui::GetItemRectSize();
+    const bool imageHovered = ImGui::IsItemHovered();
     if (ui.selected) {
         ImGuizmo::SetOrthographic(false);
         ImGuizmo::SetDrawlist(ImGui::GetWindowDrawList()); 
@@ -621,7 +1893,7 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
         const float  gH     = vMax.y - vMin.y;
         ImGuizmo::SetRect(tl.x, tl.y, gW, gH);
         glm::mat4 view = camera->GetViewMatrix();
-        glm::mat4 proj = camera->GetProjectionMatrix(gW, gH);
+        glm::mat4 proj = camera->GetProjectionMatrix(gW, gH, false);
         glm::mat4 model = ui.selected->getModelMatrix();
         const float* snapPtr = nullptr;
         if (useSnap) {
@@ -667,6 +1939,56 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
         }
     }
 
+    // MARK: viewport picking
+    // click selects, shift-drag selects everything inside the rectangle, hovering highlights
+    static bool rectSelecting = false;
+    static ImVec2 rectStart;
+    const bool cursorFree = glfwGetInputMode(window, GLFW_CURSOR) == GLFW_CURSOR_NORMAL;
+    if (settings.useObjectIDPicking && cursorFree && imageSize.x > 0.0f && imageSize.y > 0.0f) {
+        // ImGui space (top-left origin) to framebuffer pixels (bottom-left origin)
+        auto toFramebuffer = [&](ImVec2 p) {
+            float u = (p.x - imageMin.x) / imageSize.x;
+            float v = (p.y - imageMin.y) / imageSize.y;
+            int x = std::clamp((int)(u * fbWidth), 0, fbWidth - 1);
+            int y = std::clamp((int)((1.0f - v) * fbHeight), 0, fbHeight - 1);
+            return glm::ivec2(x, y);
+        };
+        const ImVec2 mouse = ImGui::GetMousePos();
+        const bool gizmoActive = ui.selected && (ImGuizmo::IsOver() || ImGuizmo::IsUsing());
+
+        if (imageHovered) {
+            glm::ivec2 p = toFramebuffer(mouse);
+            pendingPicks.push_back({ObjectPicker::Request::Hover, p.x, p.y, 1, 1});
+        } else {
+            hoveredID = 0;
+        }
+
+        if (imageHovered && !gizmoActive && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+            if (io.KeyShift) {
+                rectSelecting = true;
+                rectStart = mouse;
+            } else {
+                glm::ivec2 p = toFramebuffer(mouse);
+                pendingPicks.push_back({ObjectPicker::Request::Click, p.x, p.y, 1, 1});
+            }
+        }
+
+        if (rectSelecting) {
+            ImGui::GetWindowDrawList()->AddRect(rectStart, mouse, IM_COL32(255, 153, 25, 255));
+            ImGui::GetWindowDrawList()->AddRectFilled(rectStart, mouse, IM_COL32(255, 153, 25, 40));
+            if (ImGui::IsMouseReleased(ImGuiMouseButton_Left)) {
+                rectSelecting = false;
+                glm::ivec2 a = toFramebuffer(rectStart);
+                glm::ivec2 b = toFramebuffer(mouse);
+                glm::ivec2 lo = glm::min(a, b);
+                glm::ivec2 hi = glm::max(a, b);
+                pendingPicks.push_back({ObjectPicker::Request::Rect, lo.x, lo.y, hi.x - lo.x + 1, hi.y - lo.y + 1});
+            }
+        }
+    } else {
+        rectSelecting = false;
+    }
+
     ImGui::EndChild();
     ImGui::End();
 
@@ -692,10 +2014,11 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
             continue;
         }
 
-        bool isSelected = (ui.selected == obj);
+        bool isSelected = (ui.selected == obj) || std::find(ui.selectedIDs.begin(), ui.selectedIDs.end(), obj->getID()) != ui.selectedIDs.end();
         if (ImGui::Selectable(name.c_str(), isSelected)) {
             ui.selected      = obj;
             ui.selectedIndex = i;
+            ui.selectedIDs   = { obj->getID() };
             std::snprintf(ui.nameBuf, sizeof(ui.nameBuf), "%s", obj->getName().c_str());
             ui.nameBufOwner = obj;
             ImGui::SetWindowFocus("Inspector");
@@ -764,6 +2087,14 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
             obj->setScale(glm::vec3(1.0f));
         }
 
+        // static objects are baked into the shadow caches, dynamic ones are redrawn every frame
+        if (!obj->is_light()) {
+            bool isStatic = obj->isStatic();
+            if (ImGui::Checkbox("Static Shadow Caster", &isStatic)) obj->setStatic(isStatic);
+            bool isOccluder = obj->isOccluder();
+            if (ImGui::Checkbox("Occluder", &isOccluder)) obj->setOccluder(isOccluder);
+        }
+
         // light color changer
         if (obj->is_light()) {
             glm::vec3 color = obj->getLightColor();
@@ -783,17 +2114,21 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
 
         // Delete selected object
         ImGui::Separator();
+        // the frame being drawn may still use its model, so the render thread frees it
         if (ImGui::Button("Delete Object")) {
+            auto it = objects.end();
             if (ui.selectedIndex >= 0 && ui.selectedIndex < (int)objects.size() && objects[ui.selectedIndex].get() == obj) {
-                objects.erase(objects.begin() + ui.selectedIndex);
+                it = objects.begin() + ui.selectedIndex;
             } else {
-                auto it = std::find_if(objects.begin(), objects.end(), [&](const std::unique_ptr<Object>& p) { return p.get() == obj; });
-                if (it != objects.end()) {
-                    objects.erase(it);
-                }
+                it = std::find_if(objects.begin(), objects.end(), [&](const std::unique_ptr<Object>& p) { return p.get() == obj; });
+            }
+            if (it != objects.end()) {
+                retiredObjects.push_back(std::move(*it));
+                objects.erase(it);
             }
             ui.selected = nullptr;
             ui.selectedIndex = -1;
+            ui.selectedIDs.clear();
             ui.nameBufOwner = nullptr;
             ui.nameBuf[0] = '\0';
             rebuildLights();
@@ -812,38 +2147,69 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
     {
         if(ImGui::TreeNode("Directional Light Options")) 
         {
-            ImGui::Checkbox("Use Directional Light?", &useDirectionalLight); 
+            ImGui::Checkbox("Use Directional Light?", &settings.useDirectionalLight); 
             ImGui::Checkbox("Animate Dir Light", &animateDirLight);
             ImGui::SliderFloat("Dir Orbit Speed", &orbitSpeed, 0.0f, 2.0f);
             ImGui::SliderFloat("Dir Orbit Radius", &orbitRadius, 0.0f, 128.0f);
             ImGui::SliderFloat2("Dir Orbit Center (x,z)", &orbitCenter.x, -64.0f, 64.0f);
             ImGui::SliderFloat3("Direction Light Position (NOT ROTATION)", &lightPos.x, -20.0f, 20.0f);
-            ImGui::SliderFloat("Directional Light Intensity", &directionLightIntensity, 0.0f, 4.0f);
+            ImGui::SliderFloat("Directional Light Intensity", &settings.directionLightIntensity, 0.0f, 4.0f);
             ImGui::TreePop();
         }
         if(ImGui::TreeNode("Point Light Options")) 
         {
-            ImGui::Checkbox("Use Point Light?", &usePointLight); 
-            ImGui::SliderFloat("Point Light Radius", &pointLightRadius, 0.0f, 100.0f);
-            ImGui::SliderFloat("Pointlight Intensity", &pointLightIntensity, 0.0f, 4.0f);
+            ImGui::Checkbox("Use Point Light?", &settings.usePointLight); 
+            ImGui::SliderFloat("Point Light Radius", &settings.pointLightRadius, 0.0f, 100.0f);
+            ImGui::SliderFloat("Pointlight Intensity", &settings.pointLightIntensity, 0.0f, 4.0f);
             ImGui::TreePop();
         }
         if(ImGui::TreeNode("Shadow Options"))
         {
-            ImGui::Checkbox("Use Shadows?", &useShadows);
-            ImGui::Checkbox("Use Smooth Shadows?", &useSmoothShadows);
-            ImGui::Checkbox("Use Normal Maps?", &useNormalMaps);
-            ImGui::SliderFloat("Shadow Blending", &shadowFactor, 0.0f, 1.0f);
-            ImGui::SliderFloat("Shadow Bias", &shadowBias, 0.0f, 0.2f);
-            ImGui::SliderFloat("Dir. Shadow Bias", &dirShadowBias, 0.0f, 0.2f);
+            ImGui::Checkbox("Use Shadows?", &settings.useShadows);
+            ImGui::Checkbox("Use Smooth Shadows?", &settings.useSmoothShadows);
+            ImGui::Checkbox("Use Normal Maps?", &settings.useNormalMaps);
+            ImGui::SliderFloat("Shadow Blending", &settings.shadowFactor, 0.0f, 1.0f);
+            ImGui::SliderFloat("Shadow Bias", &settings.shadowBias, 0.0f, 0.2f);
+            ImGui::SliderFloat("Dir. Shadow Bias", &settings.dirShadowBias, 0.0f, 0.2f);
+            ImGui::Checkbox("Cache Static Shadows?", &settings.useShadowCaching);
+            if (settings.useShadowCaching) {
+                const PointShadowMaps::Stats& stats = results.pointShadowStats;
+                ImGui::Text("%d static casters, cascade caches rebuilt %d times", results.trackedStaticCasters, results.cascadeStats.cacheRenders);
+                ImGui::Text("this frame: %d cache faces rebuilt, %d live faces refreshed", stats.staticRenders, stats.composites);
+            }
+            if (ImGui::TreeNode("Cascaded Shadows")) {
+                CascadedShadowMaps::Settings& cascades = settings.cascades;
+                cascades.cascadeCount = std::clamp(cascades.cascadeCount, 1, CascadedShadowMaps::MAX_CASCADES);
+                ImGui::SliderInt("Cascades", &cascades.cascadeCount, 1, CascadedShadowMaps::MAX_CASCADES);
+                ImGui::SliderFloat("Split Lambda", &cascades.splitLambda, 0.0f, 1.0f);
+                ImGui::SliderFloat("Shadow Distance", &cascades.shadowDistance, 10.0f, 100.0f);
+                ImGui::Checkbox("Show Cascades", &settings.showCascades);
+                const char* filters[] = { "EVSM (prefiltered moments)", "PCF (hardware compare)" };
+                ImGui::Combo("Filter", &cascades.filter, filters, IM_ARRAYSIZE(filters));
+                if (cascades.filter == CascadedShadowMaps::MomentFilter) {
+                    ImGui::SliderInt("Blur Radius", &cascades.blurRadius, 0, 8);
+                    ImGui::SliderFloat("Light Bleed Reduction", &cascades.lightBleedReduction, 0.0f, 0.9f);
+                    if (results.gpu.shadowMoments.measured) ImGui::Text("moment filtering: %.3f ms", results.gpu.shadowMoments.ms);
+                }
+                ImGui::SliderInt("Depth Map View Cascade", &settings.cascadeViewLayer, 0, cascades.cascadeCount - 1);
+                ImGui::Text("%d x %dx%d, %.0f MB with caches, %d cascades redrawn this frame", cascades.cascadeCount, CascadedShadowMaps::RESOLUTION, CascadedShadowMaps::RESOLUTION, results.cascadeMemoryMB, results.cascadeStats.liveRenders);
+                // the cascades the last finished frame was drawn with
+                for (int i = 0; i < cascades.cascadeCount; i++) {
+                    const CascadedShadowMaps::Cascade& cascade = results.cascades[i];
+                    ImGui::Text("cascade %d: %.1f - %.1f, %.3f units/texel", i, cascade.splitNear, cascade.splitFar, cascade.texelSize);
+                }
+                ImGui::TreePop();
+            }
+            // triangles sent to shadow faces vs. drawing every object into every face updated
+            ImGui::Text("shadow triangles: %.2fM (%.2fM unculled)", results.shadowTriangles / 1.0e6, results.shadowTrianglesUnculled / 1.0e6);
             ImGui::TreePop();
         }
-        ImGui::Checkbox("Use Ambient?", &useAmbient);
-        ImGui::Checkbox("Use Diffuse?", &useDiffuse);  
-        ImGui::Checkbox("Use Specular?", &useSpecular); 
-        ImGui::Checkbox("Use blinn-phong?", &useBlinn); 
-        ImGui::Checkbox("Use Gamma Correction?", &gammaCorrection);
-        ImGui::Checkbox("Use Flashlight?", &useFlashlight);
+        ImGui::Checkbox("Use Ambient?", &settings.useAmbient);
+        ImGui::Checkbox("Use Diffuse?", &settings.useDiffuse);  
+        ImGui::Checkbox("Use Specular?", &settings.useSpecular); 
+        ImGui::Checkbox("Use blinn-phong?", &settings.useBlinn); 
+        ImGui::Checkbox("Use Gamma Correction?", &settings.gammaCorrection);
+        ImGui::Checkbox("Use Flashlight?", &settings.useFlashlight);
         // static const char* light[] = { "red", "blue", "white", "green" };
         // static int selectedLight = 0;
 
@@ -871,22 +2237,319 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
         // }
 
         //ImGui::ColorEdit3("clear color", (float*)&clear_color);
-        ImGui::SliderFloat("Flashlight Intensity", &flashlightIntensity, 0.0f, 4.0f);
+        ImGui::SliderFloat("Flashlight Intensity", &settings.flashlightIntensity, 0.0f, 4.0f);
         ImGui::TreePop();
     }
 
     if (ImGui::TreeNode("Post-Processing Options"))
     {
-        ImGui::Checkbox("Use MSAA?", &useMSAA);
-        ImGui::Checkbox("Show depth buffer?", &showDepthBuffer);
-        ImGui::Checkbox("wireframe?", &wireFrame);
+        static const char* aaModes[] = { "Off", "MSAA 4x", "FXAA", "SMAA 1x", "TAA" };
+        ImGui::Combo("Anti-Aliasing", &settings.antiAliasing, aaModes, IM_ARRAYSIZE(aaModes));
+        if (settings.antiAliasing == MSAA && settings.renderPath != ForwardPath) { ImGui::TextDisabled("MSAA is forward only"); }
+        if (settings.antiAliasing == TAA) {
+            ImGui::SliderFloat("TAA feedback", &settings.taaFeedback, 0.5f, 0.98f);
+            if (ImGui::Button("Reset TAA history")) { frames.back().requests.resetTemporalHistory = true; }
+            ImGui::Text("History %dx%d, resampled %d times by resolution changes", results.taaWidth, results.taaHeight, results.taaResamples);
+        }
+        // every mode keeps its last timing, so they can be compared after switching
+        const FrameSnapshots::Results::GpuTimes& gpu = results.gpu;
+        float smaaMs = gpu.smaa[0].ms + gpu.smaa[1].ms + gpu.smaa[2].ms;
+        float taaMs = gpu.taa[0].ms + gpu.taa[1].ms + gpu.taa[2].ms;
+        // MSAA has no pass of its own, its cost is in rasterising and resolving the main pass
+        if (settings.antiAliasing == MSAA && gpu.mainPass[results.prePassActive].measured) { ImGui::Text("MSAA 4x: main pass %.3f ms", gpu.mainPass[results.prePassActive].ms); }
+        if (gpu.fxaa.measured) { ImGui::Text("FXAA: %.3f ms", gpu.fxaa.ms); }
+        else { ImGui::TextDisabled("FXAA: not measured yet"); }
+        if (gpu.smaa[0].measured) {
+            ImGui::Text("SMAA 1x: %.3f ms", smaaMs);
+            ImGui::Text("  edges %.3f, weights %.3f, blending %.3f", gpu.smaa[0].ms, gpu.smaa[1].ms, gpu.smaa[2].ms);
+        } else {
+            ImGui::TextDisabled("SMAA 1x: not measured yet");
+        }
+        if (gpu.taa[0].measured) {
+            ImGui::Text("TAA: %.3f ms", taaMs);
+            ImGui::Text("  camera motion %.3f, object motion %.3f, resolve %.3f", gpu.taa[0].ms, gpu.taa[1].ms, gpu.taa[2].ms);
+        } else {
+            ImGui::TextDisabled("TAA: not measured yet");
+        }
+        ImGui::Checkbox("GPU ID Picking?", &settings.useObjectIDPicking);
+        ImGui::Checkbox("Selection Outline?", &settings.showSelectionOutline);
+        ImGui::Checkbox("Show depth buffer?", &settings.showDepthBuffer);
+        ImGui::Checkbox("wireframe?", &settings.wireFrame);
         //ImGui::Checkbox("Render to texture?", &renderToTexture);
-        ImGui::Checkbox("invert?", &inverted);
-        ImGui::Checkbox("grayscale?", &grayscale);
-        ImGui::Checkbox("sharpen?", &sharpen);
-        ImGui::Checkbox("blur?", &blur);
-        ImGui::Checkbox("edge detection?", &edgeDetection);
-        ImGui::SliderFloat("exposure", &exposure, 0.1, 1.0f);
+        ImGui::SliderFloat("exposure", &settings.exposure, 0.1, 1.0f);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Post-Processing Stack"))
+    {
+        // applied top to bottom; neighbouring per-pixel effects share one generated shader
+        std::vector<PostProcessStack::Effect>& effects = settings.postEffects;
+        for (int i = 0; i < (int)effects.size(); i++) {
+            PostProcessStack::Effect& effect = effects[i];
+            ImGui::PushID(i);
+            if (ImGui::ArrowButton("up", ImGuiDir_Up)) { PostProcessStack::move(effects, i, -1); }
+            ImGui::SameLine();
+            if (ImGui::ArrowButton("down", ImGuiDir_Down)) { PostProcessStack::move(effects, i, 1); }
+            ImGui::SameLine();
+            ImGui::Checkbox(PostProcessStack::EFFECT_NAMES[effect.type], &effect.enabled);
+            if (effect.enabled) {
+                ImGui::Indent();
+                switch (effect.type) {
+                    case PostProcessStack::Tonemap:
+                        ImGui::Combo("operator", &effect.tonemapOperator, "Reinhard\0ACES\0");
+                        ImGui::SliderFloat("exposure", &effect.amount, 0.1f, 4.0f);
+                        break;
+                    case PostProcessStack::ColorGrading:
+                        ImGui::SliderFloat("contrast", &effect.contrast, 0.5f, 2.0f);
+                        ImGui::SliderFloat("saturation", &effect.saturation, 0.0f, 2.0f);
+                        ImGui::ColorEdit3("filter", &effect.colorFilter[0]);
+                        break;
+                    case PostProcessStack::Sharpen:
+                    case PostProcessStack::EdgeDetection:
+                        ImGui::SliderFloat("strength", &effect.amount, 0.0f, 4.0f);
+                        break;
+                    case PostProcessStack::Blur: {
+                        ImGui::SliderFloat("sigma (px)", &effect.amount, 0.5f, 16.0f);
+                        int resolution = effect.downsample == 4 ? 2 : effect.downsample - 1;
+                        if (ImGui::Combo("resolution", &resolution, "Full\0Half\0Quarter\0")) { effect.downsample = 1 << resolution; }
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                ImGui::Unindent();
+            }
+            ImGui::PopID();
+        }
+        ImGui::Separator();
+        for (const PostProcessStack::Timing& timing : results.postTimings) {
+            if (timing.measured) { ImGui::Text("%s: %.3f ms (%d pass%s)", timing.label.c_str(), timing.ms, timing.passes, timing.passes == 1 ? "" : "es"); }
+            else { ImGui::TextDisabled("%s: not measured yet", timing.label.c_str()); }
+        }
+        ImGui::Text("Fused shader variants: %d", results.postVariants);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Clustered Lighting"))
+    {
+        ImGui::Checkbox("Use Clustered Lighting?", &settings.useClusteredLighting);
+        ImGui::Checkbox("Show Cluster Heatmap?", &settings.showClusterHeatmap);
+        ImGui::SliderInt("Extra Lights", &settings.lightSwarmCount, 0, 8192);
+        ImGui::SliderFloat("Extra Light Radius", &settings.lightSwarmRadius, 0.5f, 10.0f);
+        const ClusterGrid::Stats& stats = results.clusterStats;
+        ImGui::Text("Grid %dx%dx%d, %d lights in view", ClusterGrid::GRID_X, ClusterGrid::GRID_Y, ClusterGrid::GRID_Z, stats.lights);
+        ImGui::Text("%d light refs, max %d per cluster, avg %.1f in occupied clusters", stats.indices, stats.maxPerCluster, stats.occupiedClusters ? (float)stats.indices / stats.occupiedClusters : 0.0f);
+        ImGui::Text("CPU build %.3f ms on %d threads", stats.buildMs, stats.threads);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Point Shadows"))
+    {
+        // the arrays are reallocated when the slider is released, not while dragging
+        static float budget = settings.pointShadowBudgetMB;
+        ImGui::SliderFloat("Memory Budget (MB)", &budget, 4.0f, 512.0f, "%.0f");
+        if (ImGui::IsItemDeactivatedAfterEdit()) { settings.pointShadowBudgetMB = budget; }
+        const PointShadowMaps::Stats& stats = results.pointShadowStats;
+        ImGui::Text("%d of %d lights shadowed (%d in view), %.1f MB allocated", stats.shadowed, stats.candidates, stats.visible, stats.memoryMB);
+        for (int t = 0; t < PointShadowMaps::TIER_COUNT; t++) {
+            ImGui::Text("  %4d^2: %d / %d cubes", PointShadowMaps::TIER_SIZES[t], stats.perTier[t], stats.capacity[t]);
+        }
+        ImGui::SliderInt("Faces / Frame", &settings.pointShadowFaceBudget, 6, 192);
+        static const char* shadowMethods[] = { "Geometry Shader", "Layered Instancing", "Per-Face Passes" };
+        const FrameSnapshots::Results::ShadowBenchmark& benchmark = results.shadowBenchmark;
+        ImGui::BeginDisabled(benchmark.method >= 0);
+        if (ImGui::BeginCombo("Face Rasterisation", shadowMethods[settings.pointShadowMethod])) {
+            for (int m = 0; m < POINT_SHADOW_METHODS; m++) {
+                ImGui::BeginDisabled(m == LayeredInstancing && !hasVertexLayer);
+                if (ImGui::Selectable(shadowMethods[m], settings.pointShadowMethod == m)) settings.pointShadowMethod = m;
+                ImGui::EndDisabled();
+            }
+            ImGui::EndCombo();
+        }
+        if (!hasVertexLayer) ImGui::TextDisabled("no ARB_shader_viewport_layer_array, layered instancing unavailable");
+        // the live timer only covers what the scheduler asked for, the benchmark redraws everything
+        const GpuTimer::Reading& pointShadowTime = results.gpu.pointShadows[settings.pointShadowMethod];
+        if (pointShadowTime.measured) ImGui::Text("point shadow passes: %.3f ms", pointShadowTime.ms);
+        if (ImGui::Button("Benchmark Methods")) { frames.back().requests.startShadowBenchmark = true; }
+        ImGui::EndDisabled();
+        if (benchmark.method >= 0) {
+            ImGui::SameLine();
+            ImGui::Text("measuring %s...", shadowMethods[benchmark.method]);
+        } else if (benchmark.faces > 0) {
+            ImGui::SameLine();
+            ImGui::Text("%d faces per frame", benchmark.faces);
+            for (int m = 0; m < POINT_SHADOW_METHODS; m++) {
+                if (m == LayeredInstancing && !hasVertexLayer) continue;
+                ImGui::Text("  %-20s %.3f ms", shadowMethods[m], benchmark.ms[m]);
+            }
+        }
+        ImGui::Text("%d lights updated whole, %d faces waiting, stalest %d frames", stats.fullUpdates, stats.pendingFaces, stats.maxAge);
+        // frames each face has been waiting for an update; 0 = up to date, - = never drawn
+        if (ImGui::TreeNode("Face Ages"))
+        {
+            for (const FrameSnapshots::Results::ShadowFaces& light : results.shadowFaces) {
+                char faces[64];
+                int length = 0;
+                for (int f = 0; f < 6; f++) {
+                    if (light.ages[f] < 0) length += std::snprintf(faces + length, sizeof(faces) - length, "    -");
+                    else length += std::snprintf(faces + length, sizeof(faces) - length, " %4d", light.ages[f]);
+                }
+                ImGui::Text("light %3d (%4d^2):%s", light.light, light.size, faces);
+            }
+            ImGui::TreePop();
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Render Path"))
+    {
+        static const char* renderPaths[] = { "Forward", "Deferred", "Visibility Buffer" };
+        ImGui::Combo("Path", &settings.renderPath, renderPaths, IM_ARRAYSIZE(renderPaths));
+        if (settings.renderPath != ForwardPath) { ImGui::TextDisabled("MSAA and the depth pre-pass are forward only"); }
+        // forward is timed by the depth pre-pass timers, so it reports whichever variant ran last
+        const FrameSnapshots::Results::GpuTimes& gpu = results.gpu;
+        bool forwardMeasured = gpu.mainPass[results.prePassActive].measured;
+        float forwardMs = results.prePassActive ? gpu.mainPass[1].ms + gpu.prePass.ms : gpu.mainPass[0].ms;
+        // lighting and the forward extras are shared by both deferred paths
+        float sharedMs = gpu.deferredLighting.ms + gpu.deferredForward.ms;
+        float deferredMs = gpu.gBuffer.ms + sharedMs;
+        float visibilityMs = gpu.visibility.ms + gpu.materialResolve.ms + sharedMs;
+        if (forwardMeasured) { ImGui::Text("Forward: %.3f ms", forwardMs); }
+        else { ImGui::TextDisabled("Forward: not measured yet"); }
+        if (gpu.gBuffer.measured) {
+            ImGui::Text("Deferred: %.3f ms", deferredMs);
+            ImGui::Text("  G-buffer %.3f, lighting %.3f, forward %.3f", gpu.gBuffer.ms, gpu.deferredLighting.ms, gpu.deferredForward.ms);
+        } else {
+            ImGui::TextDisabled("Deferred: not measured yet");
+        }
+        if (gpu.visibility.measured) {
+            ImGui::Text("Visibility buffer: %.3f ms", visibilityMs);
+            ImGui::Text("  ids %.3f, material %.3f, lighting %.3f, forward %.3f", gpu.visibility.ms, gpu.materialResolve.ms, gpu.deferredLighting.ms, gpu.deferredForward.ms);
+            const VisibilityBuffer::Stats& vb = results.visibilityStats;
+            ImGui::Text("  %d draws, %d triangles, %.1f MB geometry, %d texture layers (%.1f MB)", vb.draws, vb.triangles, vb.geometryMB, vb.textureLayers, vb.textureMB);
+        } else {
+            ImGui::TextDisabled("Visibility buffer: not measured yet");
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Simulation"))
+    {
+        ImGui::SliderFloat("Rate (Hz)", &simulationHz, 10.0f, 240.0f);
+        ImGui::SliderInt("Max catch-up steps", &maxSimulationSteps, 1, 32);
+        const FixedTimestep::Stats& stats = simulationSample.stats;
+        ImGui::Text("Last wake-up: %d steps; this frame is drawn at %.2f between the last two", stats.steps, simulationSample.alpha);
+        ImGui::Text("%lld steps since start, %lld dropped by the catch-up limit", stats.totalSteps, stats.droppedSteps);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Job System"))
+    {
+        ImGui::Text("%d threads (main + %d workers)", jobs.threadCount(), jobs.threadCount() - 1);
+        ImGui::Text("Last frame: %d jobs, %d stolen, %d on the main-thread queue", results.jobs.jobs, results.jobs.stolen, results.jobs.mainThreadJobs);
+        ImGui::Text("Frame packets: waited %.3f ms, light/cascade lists %.3f ms", results.packetWaitMs, results.packetBuildMs);
+        ImGui::Text("%d static, %d dynamic casters, %d objects in draw order", results.staticCasters, results.dynamicCasters, results.drawOrder);
+        const FrameSnapshots::Stats handoff = frames.getStats();
+        ImGui::Text("Render thread: frame %.3f ms, idle %.3f ms; main thread waited %.3f ms", handoff.renderFrameMs, handoff.renderWaitMs, handoff.mainWaitMs);
+        // runs synchronously on temporary systems of 1, 2, 4, ... threads; the frame stalls meanwhile
+        if (ImGui::Button("Run Scaling Benchmark")) {
+            jobScaling = JobSystem::scalingBenchmark((int)std::max(std::thread::hardware_concurrency(), 1u));
+        }
+        if (jobScaling.empty()) {
+            ImGui::TextDisabled("Scaling: not measured yet");
+        } else {
+            ImGui::Text("threads   20k tiny jobs   parallel_for   speedup");
+            for (const JobSystem::ScalingResult& r : jobScaling) {
+                ImGui::Text("  %4d   %10.2f ms   %9.2f ms   %6.2fx", r.threads, r.tinyJobsMs, r.parallelForMs, r.speedup);
+            }
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Occlusion Culling"))
+    {
+        ImGui::Checkbox("Enabled", &settings.useOcclusionCulling);
+        const OcclusionCuller::Stats& oc = results.occlusionStats;
+        ImGui::Text("Drawn %d of %d objects", results.objectsDrawn, (int)objects.size());
+        if (settings.useOcclusionCulling) {
+            ImGui::Text("%d occluded, %d outside the frustum", oc.occluded, oc.outside);
+            ImGui::Text("%d occluders, %d of %d triangles rasterized", oc.occluders, oc.rasterizedTriangles, oc.occluderTriangles);
+            ImGui::Text("Rasterize %.3f ms (%d threads), test %.3f ms", oc.rasterMs, oc.threads, oc.testMs);
+        }
+        ImGui::Separator();
+        ImGui::Checkbox("GPU occlusion queries", &settings.useOcclusionQueries);
+        ImGui::SliderInt("Recheck visible every", &settings.occlusionCheckInterval, 1, 32);
+        if (settings.useOcclusionQueries) {
+            const OcclusionQueries::Stats& oq = results.queryStats;
+            ImGui::Text("%d hidden last frame, %d drawn directly, %d conditionally", oq.occluded, oq.drawnVisible, oq.conditional);
+            ImGui::Text("%d queries issued, %d results read, latency %.2f frames", oq.queriesIssued, oq.resultsRead, oq.latencyFrames);
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Depth Pre-Pass"))
+    {
+        static const char* prePassModes[] = { "Off", "On", "Auto" };
+        ImGui::Combo("Mode", &settings.depthPrePassMode, prePassModes, IM_ARRAYSIZE(prePassModes));
+        ImGui::SliderFloat("Auto enable above", &settings.overdrawEnableThreshold, 1.0f, 4.0f);
+        ImGui::SliderFloat("Auto disable below", &settings.overdrawDisableThreshold, 1.0f, settings.overdrawEnableThreshold);
+        const char* prePassState = results.prePassActive ? "active" : "inactive";
+        if (results.overdrawMeasured) { ImGui::Text("Pre-pass %s, overdraw %.2f", prePassState, results.overdraw); }
+        else { ImGui::TextDisabled("Pre-pass %s, overdraw: not measured yet", prePassState); }
+        if (settings.depthPrePassMode == PrePassAuto && settings.renderPath != ForwardPath) { ImGui::TextDisabled("Auto holds: the deferred paths don't measure overdraw"); }
+        else if (settings.depthPrePassMode == PrePassAuto && settings.useOcclusionQueries && !results.prePassActive) { ImGui::TextDisabled("Auto holds: overdraw isn't measured without the pre-pass while occlusion queries are on"); }
+        // both timings are kept so the comparison survives switching modes
+        const FrameSnapshots::Results::GpuTimes& gpu = results.gpu;
+        float withoutMs = gpu.mainPass[0].ms;
+        float withMs = gpu.mainPass[1].ms + gpu.prePass.ms;
+        if (gpu.mainPass[0].measured) { ImGui::Text("Without pre-pass: main %.3f ms", withoutMs); }
+        else { ImGui::TextDisabled("Without pre-pass: not measured yet"); }
+        if (gpu.mainPass[1].measured) { ImGui::Text("With pre-pass: depth %.3f ms + main %.3f ms", gpu.prePass.ms, gpu.mainPass[1].ms); }
+        else { ImGui::TextDisabled("With pre-pass: not measured yet"); }
+        if (gpu.mainPass[0].measured && gpu.mainPass[1].measured) {
+            ImGui::Text("Saving %.3f ms/frame (%.0f%%)", withoutMs - withMs, withoutMs > 0.0f ? 100.0f * (withoutMs - withMs) / withoutMs : 0.0f);
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Dynamic Resolution"))
+    {
+        DynamicResolution::Settings& resolution = settings.dynamicResolution;
+        ImGui::Checkbox("Enabled", &resolution.enabled);
+        ImGui::SliderFloat("GPU budget (ms)", &resolution.targetMs, 4.0f, 50.0f);
+        ImGui::SliderFloat("Min scale", &resolution.minScale, DynamicResolution::MIN_SCALE, 1.0f);
+        ImGui::SliderFloat("Max scale", &resolution.maxScale, resolution.minScale, 1.0f);
+        ImGui::Checkbox("Manual override", &resolution.manualOverride);
+        if (resolution.manualOverride) { ImGui::SliderFloat("Scale", &resolution.manualScale, DynamicResolution::MIN_SCALE, 1.0f); }
+        ImGui::SliderFloat("Sharpness (stops)", &resolution.sharpness, 0.0f, 2.0f);
+        ImGui::Text("Scale %.2f: %d x %d", results.resolutionScale, fbWidth, fbHeight);
+        if (results.gpuFrameMeasured) { ImGui::Text("GPU frame %.3f ms", results.gpuFrameMs); }
+        else { ImGui::TextDisabled("GPU frame: measuring"); }
+        if (results.gpu.upscale[0].measured) { ImGui::Text("Upscale %.3f ms, sharpen %.3f ms", results.gpu.upscale[0].ms, results.gpu.upscale[1].ms); }
+        else { ImGui::TextDisabled("Upscale: not measured yet"); }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Stream Buffer"))
+    {
+        const StreamBuffer::Stats& stats = results.streamStats;
+        ImGui::Text("%d regions of %.1f KB, grown %d times", StreamBuffer::REGIONS, stats.regionBytes / 1024.0f, stats.grows);
+        ImGui::Text("Last frame: %.1f KB in %d allocations", stats.usedBytes / 1024.0f, stats.allocations);
+        ImGui::Text("Fence waits: %d of %lld frames, %.3f ms total, %.3f ms last frame", stats.fenceWaits, stats.frames, stats.fenceWaitMs, stats.lastWaitMs);
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Render Graph"))
+    {
+        const RenderGraph::Stats& stats = results.graphStats;
+        ImGui::Text("%d passes (%d culled), %d clears, %d resolves", stats.passes, stats.culledPasses, stats.clears, stats.resolves);
+        ImGui::Text("%d transient targets in %d textures", stats.transientTextures, stats.physicalTextures);
+        ImGui::Text("Target memory %.1f MB (%.1f MB without aliasing)", stats.bytesAllocated / (1024.0f * 1024.0f), stats.bytesWithoutAliasing / (1024.0f * 1024.0f));
+        ImGui::Text("Target allocations since start: %u", stats.reallocations);
+        for (const auto& [name, culled] : results.passList) {
+            if (culled) { ImGui::TextDisabled("  %s (culled)", name.c_str()); }
+            else { ImGui::Text("  %s", name.c_str()); }
+        }
         ImGui::TreePop();
     }
 
@@ -896,14 +2559,14 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
     if (ImGui::Combo("Skybox Selector", &Selecteditem, items, IM_ARRAYSIZE(items)))
     {
         // Here event is fired
-        if(Selecteditem == 0) { currSkybox = cubemapTextureDay; }
-        else if(Selecteditem == 1) { currSkybox = cubemapTextureNight; }
-        else if(Selecteditem == 2) { currSkybox = cubemapTextureSpace1; }
-        else if(Selecteditem == 3) { currSkybox = cubemapTextureSpace2; }
+        if(Selecteditem == 0) { settings.currSkybox = cubemapTextureDay; }
+        else if(Selecteditem == 1) { settings.currSkybox = cubemapTextureNight; }
+        else if(Selecteditem == 2) { settings.currSkybox = cubemapTextureSpace1; }
+        else if(Selecteditem == 3) { settings.currSkybox = cubemapTextureSpace2; }
     }
 
-    ImGui::SliderInt("ShadowTexture", &shadowItem, 0, 36);
-    //ImGui::Checkbox("Show Depth Map?", &showDepthMap);
+    ImGui::SliderInt("ShadowTexture", &settings.shadowItem, 0, 36);
+    ImGui::Checkbox("Show Depth Map?", &settings.showDepthMap);
 
     if (ImGui::Button("Close Application")) { glfwSetWindowShouldClose(window, true); }
 
@@ -911,10 +2574,6 @@ void Renderer::renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, I
     ImGui::Text("CamX %0.1f CamY %0.1f CamZ %0.1f", camera->Position.x, camera->Position.y, camera->Position.z);
     ImGui::Text("CamYaw %0.1f CamPitch %0.1f", std::fmod(camera->Yaw, 360), camera->Pitch);
     ImGui::Text("NUM_POINT_LIGHTS %d", NUM_POINT_LIGHTS);
+    ImGui::Text("Pick latency %u frames, hovered id %u", results.pickLatency, hoveredID);
     ImGui::End();
-
-    // render the imgui window
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); 
 }
\ No newline at end of file
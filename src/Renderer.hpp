@@ -6,14 +6,35 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <array>
 #include <memory>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "Camera.hpp"
 #include "Controller.hpp"
+#include "FrameSnapshots.hpp"
+#include "JobSystem.hpp"
 #include "Object.hpp"
 #include "TexLoader.hpp"
 #include "SceneReader.hpp"
 #include "PrimitiveHelper.hpp"
+#include "ObjectPicker.hpp"
+#include "RenderGraph.hpp"
+#include "StreamBuffer.hpp"
+#include "GpuTimer.hpp"
+#include "ClusteredLighting.hpp"
+#include "VisibilityBuffer.hpp"
+#include "PointShadowMaps.hpp"
+#include "CascadedShadowMaps.hpp"
+#include "TemporalAA.hpp"
+#include "PostProcessStack.hpp"
+#include "DynamicResolution.hpp"
+#include "OcclusionCulling.hpp"
+#include "Simulation.hpp"
+#include "OcclusionQueries.hpp"
+#include "RenderSettings.hpp"
 #include <imGui/imgui.h>
 
 class Renderer {
@@ -25,10 +46,6 @@ class Renderer {
         //screen width and height
         const unsigned int SCR_WIDTH = 2400;
         const unsigned int SCR_HEIGHT = 1800;
-        const unsigned int SHADOW_WIDTH = 1024;
-        const unsigned int SHADOW_HEIGHT = 1024;
-        const unsigned int POINT_SHADOW_WIDTH = 1024;
-        const unsigned int POINT_SHADOW_HEIGHT = 1024;
 
         int NUM_POINT_LIGHTS = 0;
         int MAX_POINT_LIGHTS = 16;
@@ -36,6 +53,14 @@ class Renderer {
         //Game object manager
         std::vector<std::unique_ptr<Object>> objects;
         std::vector<Object*> lights;
+        std::vector<std::unique_ptr<Object>> retiredObjects;   // deleted, sent to the render thread to free
+
+        // job system: worker threads for culling, light assignment and asset decoding
+        JobSystem jobs;
+        std::vector<JobSystem::ScalingResult> jobScaling;   // filled in by the benchmark button
+
+        // main thread <-> render thread hand-off, one frame in flight
+        FrameSnapshots frames;
 
         //Texture loader
         TexLoader tl;
@@ -46,65 +71,180 @@ class Renderer {
         // primitve helper
         PrimitiveHelper ph;
 
-        // timing
-        float deltaTime = 0.0f;
-        float lastFrame = 0.0f;
+        // fixed-timestep simulation of camera movement and the light orbit, on its own thread. the
+        // live camera and lightPos are set to the newest step every frame; frames are drawn
+        // between the last two
+        Simulation simulation;
+        Simulation::Sample simulationSample;    // the one this frame is drawn from
+        float simulationHz = 60.0f;
+        int maxSimulationSteps = 8;             // per wake-up, the rest of a stall is dropped
 
         glm::vec3 lightPos = glm::vec3(-17.35f, 12.35f, 14.55f);
 
+        // the UI's; every snapshot takes a copy, the render thread only reads that
+        RenderSettings settings;
+
         //ImVec4 clear_color = ImVec4(0.0f, 0.0f, 0.0f, 1.00f);
         bool rotateModels = true;
         bool show_another_window = false;
-        bool useDiffuse = true;
-        bool useSpecular = true;
-        bool useAmbient = true;
-        bool useFlashlight = false;
-        bool useDirectionalLight = true;
-        bool usePointLight = true;
-        bool showDepthBuffer = false;
-        bool wireFrame = false;
         bool renderToTexture = true;
-        bool inverted = false;
-        bool grayscale = false;
-        bool sharpen = false;
-        bool blur = false;
-        bool edgeDetection = false;
         bool  animateDirLight = true; 
         float orbitSpeed      = 0.25f;
         float orbitRadius     = 32.0f;
         glm::vec2 orbitCenter = {-16.0f, 16.0f};
         float spinSpeed = 0.0f;
-        float flashlightIntensity = 1.0f;
-        float directionLightIntensity = 0.1f;
-        float pointLightIntensity = 1.0f;
-        unsigned int currSkybox = 0;
-        bool useBlinn = true;
-        bool gammaCorrection = true;
-        bool useShadows = true;
-        bool showDepthMap = false;
-        int shadowItem = 4;
-        bool useMSAA = true;
-        bool useNormalMaps = true;
-        float shadowFactor = 0.4;
-        bool useSmoothShadows = true;
-        float exposure = 1.0;
-        float shadowBias = 0.05;
-        float pointLightRadius = 25.0;
-        float dirShadowBias = 0.0;
+
+        // clustered forward lighting
+        ClusterGrid clusterGrid;
+        std::vector<ClusterLight> clusterLights;    // rebuilt every frame
+        float builtSwarmRadius = 0.0f;
+        std::vector<ClusterLight> lightSwarm;
+
+        // directional shadows: cascades fitted to slices of the camera frustum
+        CascadedShadowMaps dirShadows;
+        GpuTimer shadowMomentsTimer;                // moment conversion, blur and mips
+
+        // point-light shadows: a cube map array per resolution tier, sized from a memory budget
+        PointShadowMaps pointShadows;
+        std::vector<int> pointShadowSlots;          // per cluster light, -1 = unshadowed
+        std::vector<unsigned int> clusterLightKeys; // per cluster light, stable across frames
+
+        bool hasVertexLayer = false;                // ARB_shader_viewport_layer_array, known before the render thread starts
+        struct PointDepthShaders {
+            Shader* geometry;
+            Shader* layered;                        // null without the extension
+            Shader* perFace;
+        };
+        GpuTimer pointShadowTimer[POINT_SHADOW_METHODS];    // all point shadow passes of a frame
+        // renders every face of every shadowed light with each method in turn, caches dropped
+        struct ShadowBenchmark {
+            int method = -1;                        // method being measured, -1 when idle
+            int frames = 0;
+            float ms[POINT_SHADOW_METHODS] = {};
+            int faces = 0;                          // faces per frame while measuring
+        } shadowBenchmark;
+        static constexpr int BENCHMARK_WARMUP_FRAMES = 10;
+        static constexpr int BENCHMARK_FRAMES = 120;
+        static constexpr float POINT_SHADOW_FAR = 25.0f;
+
+        // shadow caching: static casters are rendered once per light into a cache and only the
+        // dynamic ones are drawn over a copy of it each frame
+        struct StaticCaster {
+            unsigned int version;       // Object::getTransformVersion when last seen
+            glm::vec3 center;
+            float radius;
+            bool seen;
+        };
+        std::unordered_map<unsigned int, StaticCaster> staticCasterStates;    // by object ID
+
+        // a shadow caster with its world-space bounds and the cube faces it was culled to
+        struct ShadowCaster {
+            const RenderObject* object;
+            glm::vec3 center;
+            float radius;
+            size_t triangles;
+            unsigned int faces;
+        };
+        // MARK: frame packets
+        // the per-frame data the passes only replay: caster lists per cascade and point light, the
+        // face matrices of every shadowed light and the opaque draw order. casters are gathered and
+        // the draw order is sorted by jobs running alongside the frame's first GL work, the lists
+        // are built in parallel once lights and cascades are known. the containers live across
+        // frames and keep their capacity
+        struct PointLightPacket {
+            glm::vec3 position;
+            float radius;
+            std::array<glm::mat4, 6> faceMatrices;      // world to clip, one per cube face
+            std::vector<ShadowCaster> staticCasters;    // in range, tagged with the faces they touch
+            std::vector<ShadowCaster> dynamicCasters;
+            unsigned int dynamicFaces = 0;
+        };
+        struct FramePackets {
+            std::vector<ShadowCaster> staticCasters, dynamicCasters;
+            size_t allCasterTriangles = 0;
+            glm::vec3 castersMin, castersMax;
+            std::vector<std::vector<ShadowCaster>> cascadeStatic, cascadeDynamic;
+            std::vector<PointLightPacket> pointLights;  // per shadow candidate, lists empty without a slot
+            std::vector<const RenderObject*> drawOrder; // by shader, then front to back
+        } packets;
+        JobSystem::Counter castersReady;    // the caster gather, the shadow packets start after it
+        JobSystem::Counter packetsReady;
+        float packetWaitMs = 0.0f;          // render thread blocked on the packet jobs
+        float packetBuildMs = 0.0f;         // building the per-light and per-cascade lists
+
+        size_t shadowTriangles = 0;         // triangles times faces sent to the shadow maps this frame
+        size_t shadowTrianglesUnculled = 0; // the same without light/face culling
+
+        // depth pre-pass: lay down depth first so the main pass only shades visible fragments
+        bool depthPrePassActive = false;
+        float overdraw = 0.0f;                  // depth-test-passing samples per pixel in the opaque pass
+        bool overdrawMeasured = false;          // overdraw is from the current mode and still being updated
+        GpuTimer prePassTimer;
+        GpuTimer mainPassTimer[2];              // indexed by whether the pre-pass ran
+        GpuTimer overdrawQuery[2] = {GpuTimer(GL_SAMPLES_PASSED), GpuTimer(GL_SAMPLES_PASSED)};
+
+        // CPU occlusion culling: designated occluders rasterized in software, objects tested before submission
+        OcclusionCuller occlusionCuller;
+        int objectsDrawn = 0;
+        // GPU occlusion culling with CHC++ style hardware queries and conditional rendering
+        OcclusionQueries occlusionQueries;
+
+        // the deferred paths and anti-aliasing, chosen by RenderSettings::renderPath and antiAliasing
+        VisibilityBuffer visibilityBuffer;
+        GpuTimer gBufferTimer;
+        GpuTimer visibilityTimer;
+        GpuTimer materialResolveTimer;
+        GpuTimer deferredLightingTimer;
+        GpuTimer deferredForwardTimer;          // objects the G-buffer can't hold, plus the skybox
+
+        TemporalAA temporalAA;
+        GpuTimer fxaaTimer;
+        GpuTimer smaaTimer[3];                  // edges, blend weights, neighbourhood blending
+        GpuTimer taaTimer[3];                   // camera motion, object motion, resolve
+        PostProcessStack postStack;
+        DynamicResolution dynamicResolution;
+        GpuTimer upscaleTimer[2];               // upscale, sharpen
+
+        // per-frame uniforms, draw records and light lists, fenced per frame region
+        StreamBuffer streamBuffer;
+
+        // object-ID picking: the UI's requests go out with the next snapshot, the results come back
+        // with a later frame's
+        ObjectPicker picker;
+        RenderGraph renderGraph;
+        unsigned int hoveredID = 0;
+        std::vector<FrameSnapshots::Pick> pendingPicks;
+        std::vector<FrameSnapshots::Pick> queuedPicks;     // render thread: not issued yet, the picker was busy
 
         void Render(GLFWwindow* window, Camera* camera, Controller* controller);
 
         struct Framebuffer {
-            unsigned int ID;            // Framebuffer ID
-            unsigned int texture;       // Texture attachment
-            unsigned int renderbuffer;  // Renderbuffer attachment
+            unsigned int ID = 0;            // Framebuffer ID
+            unsigned int texture = 0;       // Texture attachment
+            unsigned int renderbuffer = 0;  // Renderbuffer attachment
         };
 
-        glm::mat4 firstPass(Shader depthShader, Framebuffer framebuffer, Framebuffer depthMapBuffer, Framebuffer* pointLightsBuffer, Shader pointDepthShader, int fbWidth, int fbHeight);
+        void renderDirectionalShadow(Shader& depthShader, unsigned int texture, int cascade, const std::vector<ShadowCaster>& casters, size_t sceneTriangles);
+        void filterShadowMoments(Shader& momentShader, Shader& blurShader, unsigned int quadVAO, const std::vector<int>& cascades);
+        void renderPointShadow(const PointDepthShaders& shaders, int method, unsigned int texture, const PointLightPacket& light, int slot, unsigned int faces, const std::vector<ShadowCaster>& casters, size_t sceneTriangles);
+        void gatherCasters(const std::vector<RenderObject>& scene, bool useShadowCaching);
+        void sortDrawOrder(const std::vector<RenderObject>& scene, const glm::vec3& cameraPosition);
+        void buildShadowPackets(const std::vector<PointShadowMaps::Candidate>& candidates);
+        void updateShadowBenchmark();
+        void trackStaticCasters(const std::vector<RenderObject>& scene);
+        void invalidateShadowCaches(const glm::vec3& center, float radius);
+        void updateDepthPrePassMode(const RenderSettings& settings, int width, int height, int samples, bool deferred, bool hardwareQueries);
+        bool occlusionBox(const RenderObject* obj, const glm::vec3& cameraPosition, glm::mat4& box);
+        Simulation::Input simulationInput(const Controller::Input& keys, const Camera& camera) const;
+        void setLightingUniforms(Shader& shader, const FrameSnapshots::Snapshot& frame, int fbWidth, int fbHeight);
+        void captureStats(FrameSnapshots::Results& results);
         ImGuiIO& initImGui(GLFWwindow* window);
-        void renderIMGUI(Framebuffer postProcessFramebuffer, Camera* camera, ImGuiIO& io, GLFWwindow* window);
+        void renderIMGUI(const FrameSnapshots::Results& results, Camera* camera, ImGuiIO& io, GLFWwindow* window);
 
         void rebuildLights();
+        void captureScene(FrameSnapshots::Snapshot& next);
+        void gatherClusterLights(const std::vector<RenderObject>& scene, int swarmCount, float swarmRadius);
+        void handlePickResults(const std::vector<ObjectPicker::Result>& results);
         
         unsigned int CopyTexture(GLuint srcTexture, GLenum target, int width, int height)
         {
@@ -213,12 +353,12 @@ class Renderer {
             glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, fb.texture, 0);
             // create a (also multisampled) renderbuffer object for depth and stencil attachments
-            unsigned int rbo;
-            glGenRenderbuffers(1, &rbo);
-            glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+            // (kept in fb.renderbuffer so deleteFramebuffer frees it)
+            glGenRenderbuffers(1, &fb.renderbuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, fb.renderbuffer);
             glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH24_STENCIL8, width, height);
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, fb.renderbuffer);
 
             if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
                 std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
@@ -227,56 +367,6 @@ class Renderer {
             return fb;
         }
 
-        inline Framebuffer createDepthMapBuffer() {
-            Framebuffer fb;
-
-            // configure depth map FBO
-            glGenFramebuffers(1, &fb.ID);
-            // create depth texture
-            unsigned int depthMap;
-            glGenTextures(1, &fb.texture);
-            glBindTexture(GL_TEXTURE_2D, fb.texture);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-            float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-            // attach depth texture as FBO's depth buffer
-            glBindFramebuffer(GL_FRAMEBUFFER, fb.ID);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, fb.texture, 0);
-            glDrawBuffer(GL_NONE);
-            glReadBuffer(GL_NONE);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-            return fb;
-        }
-
-        inline Framebuffer createDepthCubemapBuffer() {
-            Framebuffer fb;
-            glGenFramebuffers(1, &fb.ID);
-            // create depth cubemap texture
-            unsigned int depthCubemap;
-            glGenTextures(1, &fb.texture);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, fb.texture);
-            for (unsigned int i = 0; i < 6; ++i)
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, POINT_SHADOW_WIDTH, POINT_SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            // attach depth texture as FBO's depth buffer
-            glBindFramebuffer(GL_FRAMEBUFFER, fb.ID);
-            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, fb.texture, 0);
-            glDrawBuffer(GL_NONE);
-            glReadBuffer(GL_NONE);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-            return fb;
-        }
-
         // Function to delete a framebuffer
         inline void deleteFramebuffer(const Framebuffer &fb) {
             glDeleteFramebuffers(1, &fb.ID);
@@ -45,9 +45,9 @@ class SceneReader {
             glm::vec3(-7.5f, 0.5f, -6.5f),
         };
 
-        void updatePointLights(Shader objectShader, const std::vector<Object*>& lights) {
+        void updatePointLights(Shader objectShader, const std::vector<const RenderObject*>& lights) {
             int i = 0;
-            for (Object* light: lights) {
+            for (const RenderObject* light: lights) {
                 objectShader.setVec3("pointLights[" + std::to_string(i) + "].position", lights[i]->getPosition());
                 objectShader.setVec3("pointLights[" + std::to_string(i) + "].ambient", lights[i]->getLightColor().x / 20, lights[i]->getLightColor().y / 20, lights[i]->getLightColor().z / 20);
                 objectShader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", lights[i]->getLightColor());
@@ -48,41 +48,14 @@ class Shader {
             } catch (std::ifstream::failure& e) {
                 std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
             }
-            const char* vShaderCode = vertexCode.c_str();
-            const char * fShaderCode = fragmentCode.c_str();
-            // 2. compile shaders
-            unsigned int vertex, fragment;
-            // vertex shader
-            vertex = glCreateShader(GL_VERTEX_SHADER);
-            glShaderSource(vertex, 1, &vShaderCode, NULL);
-            glCompileShader(vertex);
-            checkCompileErrors(vertex, "VERTEX");
-            // fragment Shader
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            glShaderSource(fragment, 1, &fShaderCode, NULL);
-            glCompileShader(fragment);
-            checkCompileErrors(fragment, "FRAGMENT");
-            // if geometry shader is given, compile geometry shader
-            unsigned int geometry;
-            if(geometryPath != nullptr) {
-                const char * gShaderCode = geometryCode.c_str();
-                geometry = glCreateShader(GL_GEOMETRY_SHADER);
-                glShaderSource(geometry, 1, &gShaderCode, NULL);
-                glCompileShader(geometry);
-                checkCompileErrors(geometry, "GEOMETRY");
-            }
-            // shader Program
-            ID = glCreateProgram();
-            glAttachShader(ID, vertex);
-            glAttachShader(ID, fragment);
-            if(geometryPath != nullptr) { glAttachShader(ID, geometry); }
-            glLinkProgram(ID);
-            checkCompileErrors(ID, "PROGRAM");
-            // delete the shaders as they're linked into our program now and no longer necessary
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
-            if(geometryPath != nullptr) { glDeleteShader(geometry); }
+            build(vertexCode.c_str(), fragmentCode.c_str(), geometryPath != nullptr ? geometryCode.c_str() : nullptr);
+        }
 
+        // compile from code held in memory, e.g. generated at runtime
+        static Shader fromSource(const std::string& vertexCode, const std::string& fragmentCode) {
+            Shader shader;
+            shader.build(vertexCode.c_str(), fragmentCode.c_str(), nullptr);
+            return shader;
         }
 
         void use() { 
@@ -97,6 +70,10 @@ class Shader {
             glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
         }
 
+        void setUInt(const std::string &name, unsigned int value) const { 
+            glUniform1ui(glGetUniformLocation(ID, name.c_str()), value); 
+        }
+
         void setFloat(const std::string &name, float value) const { 
             glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
         }
@@ -134,6 +111,42 @@ class Shader {
         }
 
     private:
+        Shader() : ID(0) {}
+
+        // 2. compile shaders
+        void build(const char* vShaderCode, const char* fShaderCode, const char* gShaderCode) {
+            unsigned int vertex, fragment;
+            // vertex shader
+            vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glCompileShader(vertex);
+            checkCompileErrors(vertex, "VERTEX");
+            // fragment Shader
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+            // if geometry shader is given, compile geometry shader
+            unsigned int geometry;
+            if(gShaderCode != nullptr) {
+                geometry = glCreateShader(GL_GEOMETRY_SHADER);
+                glShaderSource(geometry, 1, &gShaderCode, NULL);
+                glCompileShader(geometry);
+                checkCompileErrors(geometry, "GEOMETRY");
+            }
+            // shader Program
+            ID = glCreateProgram();
+            glAttachShader(ID, vertex);
+            glAttachShader(ID, fragment);
+            if(gShaderCode != nullptr) { glAttachShader(ID, geometry); }
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+            // delete the shaders as they're linked into our program now and no longer necessary
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            if(gShaderCode != nullptr) { glDeleteShader(geometry); }
+        }
+
         void checkCompileErrors(GLuint shader, std::string type) {
             GLint success;
             GLchar infoLog[1024];
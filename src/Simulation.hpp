@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Camera.hpp"
+#include "Controller.hpp"
+#include "FixedTimestep.hpp"
+
+// Fixed-rate simulation of camera movement and the light orbit on a thread of its own. The thread
+// sleeps until the next step is due, runs whatever FixedTimestep says is due (with its catch-up
+// limit) and keeps the newest two steps; neither the UI nor the render thread is ever waited for,
+// so slow frames don't slow the world and fast ones don't add steps. The main thread hands its
+// input over with setInput() (keys held, the camera's orientation, the orbit and rate settings) and
+// takes the newest two steps with sample(), interpolating by how far real time has moved past the
+// last one. A position the UI sets directly goes in with reset() and both steps jump to it.
+// The simulation only touches its own State; everything it reads comes in Input by value.
+class Simulation {
+    public:
+        struct State {
+            glm::vec3 cameraPosition = glm::vec3(0.0f);
+            glm::vec3 lightPos = glm::vec3(0.0f);
+            float orbitAngle = 0.0f;
+        };
+
+        struct Input {
+            Controller::Input keys;
+            Camera camera;                  // orientation and speed; its position is ignored
+            bool animateLight = true;
+            float orbitSpeed = 0.25f;
+            float orbitRadius = 32.0f;
+            glm::vec2 orbitCenter = glm::vec2(0.0f);
+            float stepHz = 60.0f;
+            int maxStepsPerFrame = 8;
+        };
+
+        struct Sample {
+            State previous, current;
+            float alpha = 0.0f;             // where real time is between them
+            FixedTimestep::Stats stats;
+        };
+
+        Simulation(){}
+        ~Simulation() { stop(); }
+
+        Simulation(const Simulation&) = delete;
+        Simulation& operator=(const Simulation&) = delete;
+
+        void start(const State& initial, const Input& firstInput) {
+            previous = current = initial;
+            input = firstInput;
+            stopping = false;
+            thread = std::thread(&Simulation::loop, this);
+        }
+
+        void stop() {
+            if (!thread.joinable()) return;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            thread.join();
+        }
+
+        // used from the next step on
+        void setInput(const Input& newInput) {
+            std::lock_guard<std::mutex> guard(lock);
+            input = newInput;
+        }
+
+        // the UI moved the camera or the light: taken as it is, not interpolated towards
+        void reset(const glm::vec3& cameraPosition, const glm::vec3& lightPos) {
+            std::lock_guard<std::mutex> guard(lock);
+            current.cameraPosition = cameraPosition;
+            current.lightPos = lightPos;
+            previous = current;
+        }
+
+        Sample sample() {
+            std::lock_guard<std::mutex> guard(lock);
+            Sample s;
+            s.previous = previous;
+            s.current = current;
+            const float sinceStep = std::chrono::duration<float>(Clock::now() - stepTime).count();
+            s.alpha = std::clamp(alphaAtStep + sinceStep / timestep.stepSeconds(), 0.0f, 1.0f);
+            s.stats = timestep.getStats();
+            return s;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        std::thread thread;
+        std::mutex lock;
+        std::condition_variable wake;
+        bool stopping = false;
+        // under the lock
+        Input input;
+        State previous, current;
+        FixedTimestep timestep;
+        Clock::time_point stepTime = Clock::now();  // when the newest steps were run
+        float alphaAtStep = 0.0f;                   // the accumulator left over then, in steps
+
+        void loop() {
+            std::unique_lock<std::mutex> guard(lock);
+            Clock::time_point last = Clock::now();
+            while (true) {
+                timestep.stepHz = input.stepHz;
+                timestep.maxStepsPerFrame = input.maxStepsPerFrame;
+                const double untilDue = timestep.stepSeconds() * (1.0 - timestep.alpha());
+                wake.wait_until(guard, last + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(untilDue)), [this]() { return stopping; });
+                if (stopping) return;
+                const Clock::time_point now = Clock::now();
+                const int steps = timestep.advance(std::chrono::duration<double>(now - last).count());
+                last = now;
+                for (int i = 0; i < steps; i++) {
+                    previous = current;
+                    step(current, input, timestep.stepSeconds());
+                }
+                stepTime = now;
+                alphaAtStep = timestep.alpha();
+            }
+        }
+
+        static void step(State& state, const Input& input, float seconds) {
+            Camera camera = input.camera;
+            camera.Position = state.cameraPosition;
+            Controller::applyMovement(input.keys, seconds, &camera);
+            state.cameraPosition = camera.Position;
+            if (input.animateLight) {
+                state.orbitAngle += input.orbitSpeed * seconds;
+                state.lightPos.x = input.orbitCenter.x + input.orbitRadius * std::cos(state.orbitAngle);
+                state.lightPos.z = input.orbitCenter.y + input.orbitRadius * std::sin(state.orbitAngle);
+            }
+        }
+};
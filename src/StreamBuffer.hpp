@@ -0,0 +1,186 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Ring allocator for the data that changes every frame (camera matrices, per-draw records, light
+// lists). One buffer is created with glBufferStorage and mapped once, persistently and coherently,
+// so writes land directly in memory the GPU reads: no glBufferSubData copies, no orphaning and no
+// implicit synchronisation in the driver. The buffer is split into REGIONS frame regions; a frame
+// allocates linearly from its own and puts a fence behind its commands, and a region is only
+// written again once the fence from REGIONS frames ago has signalled. That wait is the only place
+// the CPU can stall on the GPU, so it is counted. A frame that outgrows its region gets a buffer
+// twice the size straight away; the old one is deleted once no frame in flight can still read it.
+// Allocations are aligned for both uniform and storage buffer bindings.
+class StreamBuffer {
+    public:
+        static constexpr int REGIONS = 3;
+
+        struct Allocation {
+            unsigned int buffer = 0;
+            GLintptr offset = 0;
+            GLsizeiptr size = 0;
+            void* data = nullptr;       // write-only; visible to commands issued after the write
+        };
+
+        struct Stats {
+            size_t regionBytes = 0;     // capacity of one region
+            size_t usedBytes = 0;       // by the last finished frame
+            int allocations = 0;        // by the last finished frame
+            long long frames = 0;
+            int fenceWaits = 0;         // frames that had to wait for the GPU, since start
+            float fenceWaitMs = 0.0f;   // total time spent in those waits
+            float lastWaitMs = 0.0f;
+            int grows = 0;
+        };
+
+        StreamBuffer(){}
+        ~StreamBuffer(){}
+
+        void init(size_t bytesPerRegion = 1 << 20) {
+            GLint uniformAlignment = 256, storageAlignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+            alignment = (size_t)std::max({uniformAlignment, storageAlignment, 16});
+            storage = create(bytesPerRegion);
+        }
+
+        void destroy() {
+            for (GLsync& fence : fences) {
+                if (fence) { glDeleteSync(fence); }
+                fence = nullptr;
+            }
+            release(storage);
+            for (Retired& old : retired) { release(old.storage); }
+            retired.clear();
+        }
+
+        // move on to the next region, waiting for the GPU only if it is still reading it
+        void beginFrame() {
+            stats.frames++;
+            region = (region + 1) % REGIONS;
+            offset = 0;
+            allocations = 0;
+            stats.lastWaitMs = 0.0f;
+            GLsync& fence = fences[region];
+            if (fence) {
+                if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                    auto start = std::chrono::high_resolution_clock::now();
+                    // the first wait flushes, so the fence is sure to reach the GPU
+                    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+                    while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED) { flags = 0; }
+                    stats.lastWaitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+                    stats.fenceWaits++;
+                    stats.fenceWaitMs += stats.lastWaitMs;
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+            // every frame that used a replaced buffer is behind the fence just passed
+            for (size_t i = 0; i < retired.size();) {
+                if (stats.frames - retired[i].lastFrame >= REGIONS) {
+                    release(retired[i].storage);
+                    retired.erase(retired.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        // fence the region behind everything submitted this frame
+        void endFrame() {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            stats.usedBytes = offset;
+            stats.allocations = allocations;
+        }
+
+        // space in this frame's region, only valid until the frame ends
+        Allocation allocate(size_t bytes) {
+            size_t start = alignUp(offset);
+            if (start + bytes > storage.regionBytes) {
+                grow(std::max(storage.regionBytes * 2, alignUp(start + bytes)));
+                start = 0;
+            }
+            offset = start + bytes;
+            allocations++;
+            Allocation allocation;
+            allocation.buffer = storage.buffer;
+            allocation.offset = (GLintptr)(region * storage.regionBytes + start);
+            allocation.size = (GLsizeiptr)bytes;
+            allocation.data = storage.mapped + region * storage.regionBytes + start;
+            return allocation;
+        }
+
+        Allocation upload(const void* data, size_t bytes) {
+            Allocation allocation = allocate(bytes);
+            std::memcpy(allocation.data, data, bytes);
+            return allocation;
+        }
+
+        // room for at least one element, so an empty list still binds
+        template <typename T>
+        Allocation upload(const std::vector<T>& items) {
+            Allocation allocation = allocate(std::max<size_t>(1, items.size()) * sizeof(T));
+            if (!items.empty()) { std::memcpy(allocation.data, items.data(), items.size() * sizeof(T)); }
+            return allocation;
+        }
+
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct Storage {
+            unsigned int buffer = 0;
+            char* mapped = nullptr;
+            size_t regionBytes = 0;
+        };
+
+        struct Retired {
+            Storage storage;
+            long long lastFrame;
+        };
+
+        Storage storage;
+        std::array<GLsync, REGIONS> fences{};
+        std::vector<Retired> retired;
+        size_t alignment = 256;
+        int region = 0;
+        size_t offset = 0;
+        int allocations = 0;
+        Stats stats;
+
+        size_t alignUp(size_t value) const { return (value + alignment - 1) / alignment * alignment; }
+
+        Storage create(size_t regionBytes) {
+            Storage s;
+            s.regionBytes = alignUp(regionBytes);
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &s.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+            glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(s.regionBytes * REGIONS), nullptr, flags);
+            s.mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)(s.regionBytes * REGIONS), flags);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            if (!s.mapped) { std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl; }
+            stats.regionBytes = s.regionBytes;
+            return s;
+        }
+
+        // deleting a buffer unmaps it
+        static void release(Storage& s) {
+            if (s.buffer) { glDeleteBuffers(1, &s.buffer); }
+            s = Storage{};
+        }
+
+        // mid-frame: what this frame already wrote stays in the old buffer, which the GPU will
+        // still read, so it is only retired; the rest of the frame goes into the new one
+        void grow(size_t regionBytes) {
+            retired.push_back({storage, stats.frames});
+            storage = create(regionBytes);
+            stats.grows++;
+        }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <unordered_map>
+
+// Frame-to-frame state for temporal anti-aliasing. Every frame the projection is shifted by a
+// sub-pixel offset from the Halton(2, 3) sequence, so over JITTER_PHASES frames each pixel is
+// sampled at well spread positions. The resolve reprojects last frame's result through a motion
+// vector target and blends the current frame into it; the two history textures swap roles every
+// frame, one is read while the other is written.
+// Motion comes from two places: the camera's from the depth buffer and last frame's
+// view-projection, and that of objects whose model matrix changed since the last frame, which
+// are redrawn with their previous matrix on top.
+// The scene size changes whenever dynamic resolution picks a new scale; the history is then
+// resampled to the new size with a linear blit instead of being dropped, so the accumulated
+// samples survive the change and only get as soft as one bilinear resample makes them.
+class TemporalAA {
+    public:
+        static constexpr int JITTER_PHASES = 8;
+
+        TemporalAA(){}
+        ~TemporalAA(){}
+
+        void destroy() {
+            if (history[0]) { glDeleteTextures(2, history); }
+            history[0] = history[1] = 0;
+            width = height = 0;
+            active = historyWritten = historyValid = false;
+        }
+
+        // start a frame: advance the jitter and resize the history when the size changed.
+        // viewProjection is this frame's, without jitter
+        void beginFrame(int frameWidth, int frameHeight, const glm::mat4& viewProjection) {
+            if (frameWidth != width || frameHeight != height) { resize(frameWidth, frameHeight); }
+            if (!active) { previousViewProjection = viewProjection; }
+            else { previousViewProjection = currentViewProjection; }
+            currentViewProjection = viewProjection;
+            historyValid = active && historyWritten;
+            frame++;
+            current = frame & 1;
+            int phase = (int)(frame % JITTER_PHASES) + 1;   // index 0 of the sequence is 0
+            jitter = glm::vec2(halton(phase, 2) - 0.5f, halton(phase, 3) - 0.5f) * 2.0f / glm::vec2(width, height);
+            active = true;
+            historyWritten = false;
+        }
+
+        // call on frames that don't run the resolve, so the next one starts without history
+        void skipFrame() {
+            active = false;
+            historyValid = false;
+            previousModels.clear();
+        }
+
+        // the resolve wrote the history for this frame
+        void markResolved() { historyWritten = true; }
+
+        // drop the history, e.g. after a camera cut
+        void reset() { active = false; }
+
+        int getResamples() const { return resamples; }
+
+        // previous model matrix of an object; returns false when it hasn't moved since the last
+        // frame (or is new), then its motion is the camera's
+        bool previousModel(unsigned int id, const glm::mat4& model, glm::mat4& previous) const {
+            auto it = previousModels.find(id);
+            if (it == previousModels.end() || it->second == model) return false;
+            previous = it->second;
+            return true;
+        }
+
+        // remember this frame's model matrices for the next frame's motion vectors
+        void storeModel(unsigned int id, const glm::mat4& model) { previousModels[id] = model; }
+
+        glm::vec2 getJitter() const { return jitter; }
+        const glm::mat4& getViewProjection() const { return currentViewProjection; }
+        const glm::mat4& getPreviousViewProjection() const { return previousViewProjection; }
+        bool hasHistory() const { return historyValid; }
+        unsigned int getHistoryRead() const { return history[current ^ 1]; }
+        unsigned int getHistoryWrite() const { return history[current]; }
+        int getWidth() const { return width; }
+        int getHeight() const { return height; }
+
+        // radical inverse of index in the given base, in [0, 1)
+        static float halton(int index, int base) {
+            float result = 0.0f;
+            float f = 1.0f;
+            while (index > 0) {
+                f /= (float)base;
+                result += f * (float)(index % base);
+                index /= base;
+            }
+            return result;
+        }
+
+    private:
+        unsigned int history[2] = {0, 0};
+        int width = 0, height = 0;
+        unsigned int frame = 0;
+        int current = 0;                    // history texture written this frame
+        bool active = false;                // the previous frame ran the resolve
+        bool historyWritten = false;
+        bool historyValid = false;
+        int resamples = 0;                  // history carried over a size change, since start
+        glm::vec2 jitter = glm::vec2(0.0f);
+        glm::mat4 currentViewProjection = glm::mat4(1.0f);
+        glm::mat4 previousViewProjection = glm::mat4(1.0f);
+        std::unordered_map<unsigned int, glm::mat4> previousModels;   // by object ID
+
+        // new textures at the new size; the one last written (the next frame's read) is stretched
+        // over from the old pair when there is a history to keep
+        void resize(int newWidth, int newHeight) {
+            unsigned int old[2] = {history[0], history[1]};
+            const bool keep = old[0] && active && historyWritten;
+            glGenTextures(2, history);
+            for (unsigned int texture : history) {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, newWidth, newHeight);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            if (keep) {
+                unsigned int framebuffers[2];
+                glGenFramebuffers(2, framebuffers);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, old[current], 0);
+                glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, history[current], 0);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, newWidth, newHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDeleteFramebuffers(2, framebuffers);
+                resamples++;
+            } else {
+                active = false;
+            }
+            if (old[0]) { glDeleteTextures(2, old); }
+            width = newWidth;
+            height = newHeight;
+        }
+};
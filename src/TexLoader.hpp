@@ -13,6 +13,8 @@
 #include <map>
 #include <vector>
 
+#include "JobSystem.hpp"
+
 using namespace std;
 
 class TexLoader {
@@ -87,6 +89,42 @@ class TexLoader {
 
             return textureID;
         }
+
+        // several cubemaps at once: every face is decoded in its own job, the uploads are queued for
+        // the main thread, which runs them while it waits
+        vector<unsigned int> loadCubemaps(const vector<vector<std::string>>& cubemaps, JobSystem& jobs) {
+            stbi_set_flip_vertically_on_load(false);    // global in stb_image, set before any job starts
+            vector<unsigned int> textures(cubemaps.size());
+            glGenTextures((GLsizei)textures.size(), textures.data());
+            JobSystem::Counter loaded;
+            for (size_t c = 0; c < cubemaps.size(); c++) {
+                for (size_t i = 0; i < cubemaps[c].size(); i++) {
+                    jobs.run([&, c, i]() {
+                        int width, height, nrChannels;
+                        unsigned char *data = stbi_load(cubemaps[c][i].c_str(), &width, &height, &nrChannels, 0);
+                        jobs.runOnMainThread([&, c, i, data, width, height]() {
+                            if (data) {
+                                glBindTexture(GL_TEXTURE_CUBE_MAP, textures[c]);
+                                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+                            } else {
+                                std::cout << "Cubemap texture failed to load at path: " << cubemaps[c][i] << std::endl;
+                            }
+                            stbi_image_free(data);
+                        }, &loaded);
+                    }, &loaded);
+                }
+            }
+            jobs.wait(loaded);
+            for (unsigned int textureID : textures) {
+                glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            }
+            return textures;
+        }
     private:
 
 };
\ No newline at end of file
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Object.hpp"
+#include "StreamBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Scene geometry for the visibility-buffer path. Every mesh of every participating object is
+// packed into shared buffers once: a position-only stream the geometry pass rasterises with a
+// single multi-draw, plus full vertices and indices the material pass reads back as SSBOs to
+// rebuild attributes for the one triangle visible in each pixel. Textures are resampled into
+// one 2D array so the material pass can pick any mesh's texture by layer without bindless.
+// The draw records carry the per-frame transforms and are written into the frame's stream region.
+// GPU layout: binding 3 = draw records, binding 4 = vertices, binding 5 = indices.
+class VisibilityBuffer {
+    public:
+        static constexpr int LAYER_SIZE = 1024;     // every texture is resampled to this size
+        static constexpr int MAX_LAYERS = 256;
+
+        struct Stats {
+            int draws = 0;
+            int triangles = 0;
+            int vertices = 0;
+            int textureLayers = 0;
+            float geometryMB = 0.0f;
+            float textureMB = 0.0f;
+        };
+
+        VisibilityBuffer(){}
+        ~VisibilityBuffer(){}
+
+        void destroy() {
+            if (vao) { glDeleteVertexArrays(1, &vao); }
+            unsigned int buffers[] = { positionBuffer, drawIndexBuffer, vertexBuffer, indexBuffer, indirectBuffer };
+            for (unsigned int buffer : buffers) { if (buffer) { glDeleteBuffers(1, &buffer); }}
+            if (textureArray) { glDeleteTextures(1, &textureArray); }
+            vao = positionBuffer = drawIndexBuffer = vertexBuffer = indexBuffer = indirectBuffer = textureArray = 0;
+            drawRange = StreamBuffer::Allocation{};
+            builtIDs.clear();
+            draws.clear();
+            stats = Stats{};
+        }
+
+        // rebuilds the packed geometry and textures when the set of objects changed, then uploads
+        // this frame's transforms; must run outside of any render graph pass (it uses framebuffers)
+        void update(const std::vector<const RenderObject*>& objects, StreamBuffer& stream) {
+            std::vector<unsigned int> ids;
+            for (const RenderObject* obj : objects) { ids.push_back(obj->getID()); }
+            if (ids != builtIDs || !vao) {
+                build(objects);
+                builtIDs = ids;
+            }
+
+            // one record per mesh, in the same order build() laid the meshes out
+            size_t d = 0;
+            for (const RenderObject* obj : objects) {
+                glm::mat4 model = obj->getModelMatrix();
+                glm::mat4 normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+                for (size_t m = 0; m < obj->getModel().meshes.size(); m++, d++) {
+                    draws[d].model = model;
+                    draws[d].normalMatrix = normalMatrix;
+                    draws[d].objectID = obj->getID();
+                }
+            }
+            drawRange = stream.upload(draws);
+        }
+
+        // every mesh in one call; each command's baseInstance picks its entry of the draw-index
+        // attribute, which is how the shader finds its draw record (gl_DrawID isn't everywhere)
+        void drawGeometry() {
+            if (draws.empty()) return;
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, drawRange.buffer, drawRange.offset, drawRange.size);
+            glBindVertexArray(vao);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)draws.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+
+        // buffers and the texture array for the material pass
+        void bindMaterialData(int textureUnit) {
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, drawRange.buffer, drawRange.offset, drawRange.size);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, vertexBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, indexBuffer);
+            glActiveTexture(GL_TEXTURE0 + textureUnit);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        }
+
+        const Stats& getStats() const { return stats; }
+
+    private:
+        // matches DrawRecord in visibility.vert/.frag and visibilityResolve.frag (std430)
+        struct DrawRecord {
+            glm::mat4 model;
+            glm::mat4 normalMatrix;
+            uint32_t firstIndex;
+            int32_t baseVertex;
+            int32_t diffuseLayer;       // -1 when the mesh has no such texture
+            int32_t specularLayer;
+            int32_t normalLayer;
+            uint32_t objectID;
+            uint32_t pad[2];
+        };
+
+        // matches VisVertex in visibilityResolve.frag; uv is split across the w components
+        struct PackedVertex {
+            glm::vec4 positionU;
+            glm::vec4 normalV;
+            glm::vec4 tangent;
+        };
+
+        struct DrawCommand {
+            uint32_t count;
+            uint32_t instanceCount;
+            uint32_t firstIndex;
+            int32_t baseVertex;
+            uint32_t baseInstance;
+        };
+
+        unsigned int vao = 0;
+        unsigned int positionBuffer = 0;
+        unsigned int drawIndexBuffer = 0;
+        unsigned int vertexBuffer = 0;
+        unsigned int indexBuffer = 0;
+        StreamBuffer::Allocation drawRange;    // this frame's draw records
+        unsigned int indirectBuffer = 0;
+        unsigned int textureArray = 0;
+
+        std::vector<unsigned int> builtIDs;
+        std::vector<DrawRecord> draws;
+        Stats stats;
+
+        void build(const std::vector<const RenderObject*>& objects) {
+            destroy();
+
+            std::vector<glm::vec3> positions;
+            std::vector<PackedVertex> vertices;
+            std::vector<uint32_t> indices;
+            std::vector<DrawCommand> commands;
+
+            // textures are keyed by file so models loaded more than once share layers
+            std::map<std::string, int> layers;
+            std::vector<unsigned int> layerSources;
+            auto layerFor = [&](const Mesh& mesh, const std::string& directory, const std::string& type) {
+                for (const Texture& texture : mesh.textures) {
+                    if (texture.type != type) continue;
+                    std::string key = directory + "/" + texture.path;
+                    auto it = layers.find(key);
+                    if (it != layers.end()) return it->second;
+                    if ((int)layerSources.size() >= MAX_LAYERS) {
+                        std::cout << "ERROR::VISIBILITY_BUFFER:: texture array full, " << key << " is skipped" << std::endl;
+                        return -1;
+                    }
+                    layers[key] = (int)layerSources.size();
+                    layerSources.push_back(texture.id);
+                    return layers[key];
+                }
+                return -1;
+            };
+
+            for (const RenderObject* obj : objects) {
+                Model& model = obj->getModel();
+                for (const Mesh& mesh : model.meshes) {
+                    DrawRecord record{};
+                    record.firstIndex = (uint32_t)indices.size();
+                    record.baseVertex = (int32_t)vertices.size();
+                    record.diffuseLayer = layerFor(mesh, model.directory, "texture_diffuse");
+                    // without a specular map the forward shader ends up sampling the diffuse
+                    // texture's unit, so do the same rather than change how those meshes look
+                    record.specularLayer = layerFor(mesh, model.directory, "texture_specular");
+                    if (record.specularLayer < 0) { record.specularLayer = record.diffuseLayer; }
+                    record.normalLayer = layerFor(mesh, model.directory, "texture_normal");
+                    record.objectID = obj->getID();
+
+                    for (const Vertex& v : mesh.vertices) {
+                        positions.push_back(v.Position);
+                        vertices.push_back({ glm::vec4(v.Position, v.TexCoords.x), glm::vec4(v.Normal, v.TexCoords.y), glm::vec4(v.Tangent, 0.0f) });
+                    }
+                    indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+                    DrawCommand command{};
+                    command.count = (uint32_t)mesh.indices.size();
+                    command.instanceCount = 1;
+                    command.firstIndex = record.firstIndex;
+                    command.baseVertex = record.baseVertex;
+                    command.baseInstance = (uint32_t)draws.size();
+                    commands.push_back(command);
+                    draws.push_back(record);
+                }
+            }
+
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(1, &positionBuffer);
+            glGenBuffers(1, &drawIndexBuffer);
+            glGenBuffers(1, &vertexBuffer);
+            glGenBuffers(1, &indexBuffer);
+            glGenBuffers(1, &indirectBuffer);
+
+            glBindVertexArray(vao);
+            glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+            glBufferData(GL_ARRAY_BUFFER, std::max<size_t>(1, positions.size()) * sizeof(glm::vec3), positions.empty() ? NULL : positions.data(), GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+            std::vector<uint32_t> drawIndices(std::max<size_t>(1, draws.size()));
+            for (size_t i = 0; i < drawIndices.size(); i++) { drawIndices[i] = (uint32_t)i; }
+            glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, drawIndices.size() * sizeof(uint32_t), drawIndices.data(), GL_STATIC_DRAW);
+            glEnableVertexAttribArray(1);
+            glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+            glVertexAttribDivisor(1, 1);
+            // the index buffer doubles as an SSBO for the material pass
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, std::max<size_t>(1, indices.size()) * sizeof(uint32_t), indices.empty() ? NULL : indices.data(), GL_STATIC_DRAW);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(1, vertices.size()) * sizeof(PackedVertex), vertices.empty() ? NULL : vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, std::max<size_t>(1, commands.size()) * sizeof(DrawCommand), commands.empty() ? NULL : commands.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+            buildTextureArray(layerSources);
+
+            stats.draws = (int)draws.size();
+            stats.triangles = (int)(indices.size() / 3);
+            stats.vertices = (int)vertices.size();
+            stats.textureLayers = (int)layerSources.size();
+            stats.geometryMB = (positions.size() * sizeof(glm::vec3) + vertices.size() * sizeof(PackedVertex) + indices.size() * sizeof(uint32_t)) / (1024.0f * 1024.0f);
+        }
+
+        // blit each texture into its layer from the source mip closest to (but not under) the
+        // layer size, so large textures aren't point-sampled down in one step
+        void buildTextureArray(const std::vector<unsigned int>& sources) {
+            const int layerCount = std::max(1, (int)sources.size());
+            const int levels = (int)std::floor(std::log2((float)LAYER_SIZE)) + 1;
+            glGenTextures(1, &textureArray);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, LAYER_SIZE, LAYER_SIZE, layerCount);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            unsigned int framebuffers[2];
+            glGenFramebuffers(2, framebuffers);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+            for (int layer = 0; layer < (int)sources.size(); layer++) {
+                int width = 0, height = 0;
+                glBindTexture(GL_TEXTURE_2D, sources[layer]);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+                int level = 0;
+                while (level < 16 && std::min(width, height) / 2 >= LAYER_SIZE) { width /= 2; height /= 2; level++; }
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sources[layer], level);
+                glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureArray, 0, layer);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, LAYER_SIZE, LAYER_SIZE, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(2, framebuffers);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            stats.textureMB = layerCount * LAYER_SIZE * LAYER_SIZE * 4 * (4.0f / 3.0f) / (1024.0f * 1024.0f);
+        }
+};
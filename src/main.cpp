@@ -49,7 +49,8 @@ int main () {
 
 
 //CALLBACKS AND MOUSE CONTROL
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); } 
+// the GL context lives on the render thread; the render graph and the ImGui backend set their own viewports
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {}
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) { camera.ProcessMouseScroll(static_cast<float>(yoffset)); }
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
     float xpos = static_cast<float>(xposIn);
@@ -0,0 +1,21 @@
+#version 460 core
+layout (location = 0) out vec2 Motion;
+
+// motion of everything that didn't move by itself: rebuild the world position from depth and
+// project it with last frame's camera. moving objects are drawn over this afterwards
+uniform sampler2D depthTexture;
+uniform mat4 invViewProjection;         // jittered, like the depth buffer
+uniform mat4 viewProjection;            // without jitter
+uniform mat4 previousViewProjection;
+uniform vec2 viewportSize;
+
+void main()
+{
+    float depth = texelFetch(depthTexture, ivec2(gl_FragCoord.xy), 0).r;
+    vec4 ndc = vec4(gl_FragCoord.xy / viewportSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = invViewProjection * ndc;
+    world /= world.w;
+    vec4 current = viewProjection * world;
+    vec4 previous = previousViewProjection * world;
+    Motion = (current.xy / current.w - previous.xy / previous.w) * 0.5;
+}
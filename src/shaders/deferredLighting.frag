@@ -0,0 +1,364 @@
+#version 460 core
+// deferred lighting: one fullscreen pass over the G-buffer. evaluates the same DirLight,
+// PointLight and SpotLight model as shader.frag, once per visible pixel.
+layout (location = 0) out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormalGloss;
+uniform sampler2D gDepth;
+uniform mat4 invViewProjection;
+uniform vec2 viewportSize;
+
+uniform sampler2DArrayShadow shadowMap;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// everything the G-buffer knows about a pixel
+struct Surface {
+    vec3 position;
+    vec3 normal;
+    vec3 albedo;
+    float specular;
+    float shininess;
+};
+
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+uniform float far_plane;
+
+#define MAX_POINT_LIGHTS 16
+uniform int NR_POINT_LIGHTS;
+
+uniform DirLight dirLight;
+uniform PointLight pointLights[MAX_POINT_LIGHTS];
+uniform SpotLight spotLight;
+
+// point shadows: one cube map array per resolution tier (PointShadowMaps.hpp); a light's
+// slot is (tier << 16) | layer, -1 for unshadowed lights
+#define POINT_SHADOW_TIERS 3
+uniform samplerCubeArrayShadow pointShadowMaps[POINT_SHADOW_TIERS];
+uniform int pointShadowSlots[MAX_POINT_LIGHTS];
+
+// clustered lighting, laid out as in ClusteredLighting.hpp
+struct PointLightData {
+    vec3 position;
+    float radius;
+    vec3 color;
+    int shadowSlot;
+};
+layout(std430, binding = 0) readonly buffer ClusterLightBuffer { PointLightData clusterLights[]; };
+layout(std430, binding = 1) readonly buffer ClusterRecordBuffer { uvec2 clusterRecords[]; };
+layout(std430, binding = 2) readonly buffer ClusterIndexBuffer { uint clusterLightIndices[]; };
+uniform bool useClusteredLighting;
+uniform bool showClusterHeatmap;
+uniform uvec3 clusterGrid;
+uniform vec2 clusterTileSize;
+uniform vec4 clusterDepthSlicing;      // window depth to slice, see ClusterGrid::getDepthSlicing
+
+uniform bool useDiffuse;
+uniform bool useAmbient;
+uniform bool useSpecular;
+uniform bool useBlinn;
+
+uniform bool useFlashlight;
+uniform bool useDirectionalLight;
+uniform bool usePointLight;
+uniform bool useShadows;
+uniform bool useSmoothShadows;
+uniform bool useNormalMaps;
+
+uniform float shadowFactor;
+uniform float exposure;
+uniform float shadowBias;
+uniform float dirShadowBias;
+
+// directional shadow cascades, one array layer each, picked by view depth
+const int MAX_CASCADES = 4;
+uniform mat4 cascadeMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];
+uniform float cascadeTexelSizes[MAX_CASCADES];
+uniform int cascadeCount;
+uniform vec3 viewForward;
+uniform bool showCascades;
+// exponential variance moments of the cascades, or hardware PCF on the depth array
+uniform sampler2DArray shadowMoments;
+uniform bool useShadowMoments;
+uniform vec2 evsmExponents;
+uniform float lightBleedReduction;
+uniform float pixelSpread;          // world size of a pixel per unit of view depth
+uniform float momentTexelScale;     // moment texels are this many depth texels wide
+
+uniform float pointLightRadius;
+
+uniform float flashlightIntensity;
+uniform float directionalLightIntensity;
+uniform float pointLightIntensity;
+
+// smooth point shadows take four comparisons on a tetrahedron around the lookup; each is
+// already a 2x2 PCF, so together they cover more texels than 20 single samples did
+const vec3 pcfTetrahedron[4] = vec3[](vec3(1, 1, 1), vec3(1, -1, -1), vec3(-1, 1, -1), vec3(-1, -1, 1));
+
+vec3 DecodeNormal(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// cascade the fragment's view depth falls in, -1 past the last one
+int CascadeIndex(vec3 fragPos) {
+    float depth = dot(fragPos - viewPos, viewForward);
+    for(int i = 0; i < cascadeCount; i++) {
+        if(depth < cascadeSplits[i]) return i;
+    }
+    return -1;
+}
+
+vec3 CascadeTint(int cascade) {
+    const vec3 tints[MAX_CASCADES] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+    return cascade < 0 ? vec3(1.0) : tints[cascade];
+}
+
+// Chebyshev's upper bound on the lit fraction; the bottom of it is cut off, which is what
+// shows up as light bleeding where occluders overlap
+float ChebyshevUpperBound(vec2 moments, float mean, float minVariance) {
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = mean - moments.x;
+    float pMax = variance / (variance + d * d);
+    pMax = clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+    return mean <= moments.x ? 1.0 : pMax;
+}
+
+float EVSMVisibility(vec4 moments, float depth) {
+    depth = depth * 2.0 - 1.0;
+    vec2 warped = vec2(exp(evsmExponents.x * depth), -exp(-evsmExponents.y * depth));
+    // the variance floor follows the slope of the warp
+    vec2 depthScale = 0.0001 * evsmExponents * warped;
+    vec2 minVariance = depthScale * depthScale;
+    return min(ChebyshevUpperBound(moments.xy, warped.x, minVariance.x), ChebyshevUpperBound(moments.zw, warped.y, minVariance.y));
+}
+
+float ShadowCalculation(Surface s) {
+    int cascade = CascadeIndex(s.position);
+    if(cascade < 0) { return 0.0; }
+    // texels grow with every cascade, so the lookup is pushed out along the normal by one
+    vec3 lightDir = normalize(lightPos - s.position);
+    vec3 offset = s.normal * cascadeTexelSizes[cascade] * (1.0 - max(dot(s.normal, lightDir), 0.0));
+    vec4 fragPosLightSpace = cascadeMatrices[cascade] * vec4(s.position + offset, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz * 0.5 + 0.5;
+    if(projCoords.z > 1.0) { return 0.0; }
+    if(useShadowMoments) {
+        // pick the mip from how much ground a pixel covers, derivatives would jump between cascades
+        float pixelSize = dot(s.position - viewPos, viewForward) * pixelSpread;
+        float lod = log2(max(pixelSize / (cascadeTexelSizes[cascade] * momentTexelScale), 1.0));
+        vec4 moments = textureLod(shadowMoments, vec3(projCoords.xy, cascade), lod);
+        return 1.0 - EVSMVisibility(moments, projCoords.z);
+    }
+    // four bilinear comparisons half a texel apart cover the same 3x3 texels as a 3x3 PCF
+    float bias = max(0.0005 * (1.0 - dot(s.normal, lightDir)), dirShadowBias);
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = 0; x < 2; ++x) {
+        for(int y = 0; y < 2; ++y) {
+            vec2 uv = projCoords.xy + (vec2(x, y) - 0.5) * texelSize;
+            lit += texture(shadowMap, vec4(uv, cascade, projCoords.z - bias));
+        }
+    }
+    return 1.0 - lit / 4.0;
+}
+
+// lit fraction from one hardware comparison (a bilinear 2x2 PCF). the slot isn't dynamically
+// uniform (cluster lists, tiers), so pick the array with constant indices instead
+float CompareDepthCube(int slot, vec3 dir, float depth) {
+    int tier = slot >> 16;
+    float layer = float(slot & 0xFFFF);
+    for(int i = 0; i < POINT_SHADOW_TIERS; i++) {
+        if(i == tier) { return texture(pointShadowMaps[i], vec4(dir, layer), depth); }
+    }
+    return 1.0;
+}
+
+float PointShadowCalculation(Surface s, vec3 lightPosition, int slot) {
+    vec3 fragToLight = s.position - lightPosition;
+    float currentDepth = length(fragToLight);
+    float lit = 0.0;
+    if(useSmoothShadows) {
+        float viewDistance = length(viewPos - s.position);
+        float diskRadius = (1.0 + (viewDistance / far_plane)) / pointLightRadius;
+        float reference = (currentDepth - shadowBias) / far_plane;
+        for(int i = 0; i < 4; ++i) {
+            lit += CompareDepthCube(slot, fragToLight + pcfTetrahedron[i] * diskRadius, reference);
+        }
+        lit /= 4.0;
+    } else {
+        vec3 lightDir = normalize(lightPosition - s.position);
+        float bias = max(shadowBias * (1.0 - dot(s.normal, lightDir)), shadowBias);
+        lit = CompareDepthCube(slot, fragToLight, (currentDepth - bias) / far_plane);
+    }
+    return 1.0 - lit;
+}
+
+float SpecularTerm(vec3 lightDir, vec3 normal, vec3 viewDir, float shininess) {
+    if (useBlinn) {
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        return pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    }
+    vec3 reflectDir = reflect(-lightDir, normal);
+    return pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+}
+
+vec3 CalcDirLight(DirLight light, Surface s, vec3 viewDir) {
+    // with normal maps shader.frag lights from the light position in tangent space; this is the world-space equivalent
+    vec3 lightDir = useNormalMaps ? normalize(lightPos - s.position) : normalize(-light.direction);
+    float diff = max(dot(lightDir, s.normal), 0.0);
+    float spec = diff == 0.0 ? 0.0 : SpecularTerm(lightDir, s.normal, viewDir, s.shininess);
+    vec3 ambient = light.ambient * s.albedo * (useAmbient ? 1 : 0);
+    vec3 diffuse = light.diffuse * diff * s.albedo * (useDiffuse ? 1 : 0);
+    vec3 specular = light.specular * spec * s.specular * (useSpecular ? 1 : 0);
+    if(useShadows) { return ambient + (1.0 - ShadowCalculation(s)) * (diffuse + specular); }
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcPointLight(PointLight light, Surface s, vec3 viewDir, int shadowSlot) {
+    vec3 lightDir = normalize(light.position - s.position);
+    float diff = max(dot(s.normal, lightDir), 0.0);
+    float spec = diff == 0.0 ? 0.0 : SpecularTerm(lightDir, s.normal, viewDir, s.shininess);
+    float distance = length(light.position - s.position);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    vec3 ambient = light.ambient * s.albedo * attenuation * (useAmbient ? 1 : 0);
+    vec3 diffuse = light.diffuse * diff * s.albedo * attenuation * (useDiffuse ? 1 : 0);
+    vec3 specular = light.specular * spec * s.specular * attenuation * (useSpecular ? 1 : 0);
+    vec3 unshadowedColor = ambient + diffuse + specular;
+    if(useShadows && shadowSlot >= 0) {
+        float shadowFactorInt = 1.0 - PointShadowCalculation(s, light.position, shadowSlot);
+        vec3 shadowedColor = ambient + unshadowedColor * shadowFactor;
+        return mix(shadowedColor, unshadowedColor, shadowFactorInt);
+    }
+    return unshadowedColor;
+}
+
+vec3 CalcSpotLight(SpotLight light, Surface s, vec3 viewDir) {
+    vec3 lightDir = normalize(light.position - s.position);
+    float diff = max(dot(s.normal, lightDir), 0.0);
+    float spec = SpecularTerm(lightDir, s.normal, viewDir, useBlinn ? 32.0 : s.shininess);
+    float distance = length(light.position - s.position);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    vec3 ambient = light.ambient * s.albedo * (useAmbient ? 1 : 0);
+    vec3 diffuse = light.diffuse * diff * s.albedo * (useDiffuse ? 1 : 0);
+    vec3 specular = light.specular * spec * s.specular * (useSpecular ? 1 : 0);
+    return (ambient + diffuse + specular) * attenuation * intensity;
+}
+
+uint ClusterIndex(float depth) {
+    float logSlice = floor(log(clusterDepthSlicing.x - clusterDepthSlicing.y * depth) * clusterDepthSlicing.z + clusterDepthSlicing.w);
+    uint slice = uint(clamp(logSlice, 0.0, float(clusterGrid.z - 1u)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), clusterGrid.xy - 1u);
+    return (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+}
+
+vec3 CalcClusterLight(PointLightData data, Surface s, vec3 viewDir) {
+    float distance = length(data.position - s.position);
+    float ratio = distance / data.radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    if(window <= 0.0) return vec3(0.0);
+    PointLight light;
+    light.position = data.position;
+    light.constant = 1.0;
+    light.linear = 0.09;
+    light.quadratic = 0.032;
+    light.ambient = data.color / 20.0;
+    light.diffuse = data.color;
+    light.specular = data.color / 1.5;
+    return CalcPointLight(light, s, viewDir, data.shadowSlot) * window * window;
+}
+
+void main()
+{
+    // the G-buffer may be a larger pooled texture, but it's rendered at the same pixel positions
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, texel, 0).r;
+    if(depth >= 1.0) {
+        // background; the skybox is drawn over it afterwards
+        FragColor = vec4(0.0);
+        return;
+    }
+
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, texel, 0);
+    vec4 normalGloss = texelFetch(gNormalGloss, texel, 0);
+    vec4 ndc = vec4(gl_FragCoord.xy / viewportSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = invViewProjection * ndc;
+
+    Surface s;
+    s.position = world.xyz / world.w;
+    s.normal = DecodeNormal(normalGloss.xy);
+    s.albedo = albedoSpec.rgb;
+    s.specular = albedoSpec.a;
+    s.shininess = normalGloss.z * 256.0;
+
+    vec3 viewDir = normalize(viewPos - s.position);
+    vec3 result = vec3(0.0);
+    if(useDirectionalLight) { result = CalcDirLight(dirLight, s, viewDir) * directionalLightIntensity; }
+
+    uint clusterLightCount = 0u;
+    if(usePointLight && useClusteredLighting) {
+        uvec2 record = clusterRecords[ClusterIndex(depth)];
+        clusterLightCount = record.y;
+        for(uint i = 0u; i < record.y; i++) {
+            result += CalcClusterLight(clusterLights[clusterLightIndices[record.x + i]], s, viewDir) * pointLightIntensity;
+        }
+    } else if(usePointLight) {
+        for(int i = 0; i < NR_POINT_LIGHTS; i++) { result += CalcPointLight(pointLights[i], s, viewDir, pointShadowSlots[i]) * pointLightIntensity; }
+    }
+    if(useFlashlight) { result += CalcSpotLight(spotLight, s, viewDir) * flashlightIntensity; }
+
+    // same tone mapping as the forward path
+    const float gamma = 2.2;
+    vec3 mapped = pow(vec3(1.0) - exp(-s.albedo * exposure), vec3(1.0 / gamma));
+    if(showClusterHeatmap) {
+        float t = clamp(float(clusterLightCount) / 32.0, 0.0, 1.0);
+        vec3 heat = t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0) : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+        FragColor = vec4(mix(result * mapped, heat, 0.6), 1.0);
+    } else {
+        FragColor = vec4(result * mapped, 1.0);
+        if(showCascades) { FragColor.rgb *= CascadeTint(CascadeIndex(s.position)); }
+    }
+}
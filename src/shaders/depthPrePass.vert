@@ -0,0 +1,17 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+layout(std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+uniform mat4 model;
+
+// must match the main pass bit for bit, otherwise GL_EQUAL rejects fragments
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,119 @@
+#version 460 core
+out vec4 FragColor;
+
+// FXAA: find the direction of the local luma edge, walk along it in both directions to its
+// ends and resample the pixel across the edge by how far it is from the nearer end, plus a
+// sub-pixel blur for pixels that are noisier than their neighbourhood
+uniform sampler2D screenTexture;
+uniform vec2 viewportSize;
+
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float EDGE_THRESHOLD_MAX = 0.125;
+const float SUBPIXEL_QUALITY = 0.75;
+const int ITERATIONS = 12;
+const float QUALITY[ITERATIONS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+// positions are in pixels; the target may be a larger pooled texture, so stay inside the viewport
+vec3 colorAt(vec2 position) {
+    vec2 p = clamp(position, vec2(0.5), viewportSize - 0.5);
+    return textureLod(screenTexture, p / vec2(textureSize(screenTexture, 0)), 0.0).rgb;
+}
+
+// perceptual luma; the scene colour is linear
+float lumaOf(vec3 color) {
+    return sqrt(dot(clamp(color, 0.0, 1.0), vec3(0.299, 0.587, 0.114)));
+}
+
+float lumaAt(vec2 position) {
+    return lumaOf(colorAt(position));
+}
+
+void main()
+{
+    vec2 position = gl_FragCoord.xy;
+    vec3 colorCenter = colorAt(position);
+    float lumaCenter = lumaOf(colorCenter);
+    float lumaDown  = lumaAt(position + vec2( 0.0, -1.0));
+    float lumaUp    = lumaAt(position + vec2( 0.0,  1.0));
+    float lumaLeft  = lumaAt(position + vec2(-1.0,  0.0));
+    float lumaRight = lumaAt(position + vec2( 1.0,  0.0));
+
+    // too little contrast to be an edge
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+    if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX)) {
+        FragColor = vec4(colorCenter, 1.0);
+        return;
+    }
+
+    float lumaDownLeft  = lumaAt(position + vec2(-1.0, -1.0));
+    float lumaUpRight   = lumaAt(position + vec2( 1.0,  1.0));
+    float lumaUpLeft    = lumaAt(position + vec2(-1.0,  1.0));
+    float lumaDownRight = lumaAt(position + vec2( 1.0, -1.0));
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+    // horizontal or vertical edge, from second differences in each direction
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    // which side of the pixel the edge is on
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepLength = is1Steepest ? -1.0 : 1.0;
+    float lumaLocalAverage = 0.5 * ((is1Steepest ? luma1 : luma2) + lumaCenter);
+
+    // walk along the edge, half a pixel across so the bilinear fetch straddles it
+    vec2 edgePosition = position;
+    if (isHorizontal) { edgePosition.y += stepLength * 0.5; } else { edgePosition.x += stepLength * 0.5; }
+    vec2 offset = isHorizontal ? vec2(1.0, 0.0) : vec2(0.0, 1.0);
+    vec2 position1 = edgePosition - offset * QUALITY[0];
+    vec2 position2 = edgePosition + offset * QUALITY[0];
+    float lumaEnd1 = lumaAt(position1) - lumaLocalAverage;
+    float lumaEnd2 = lumaAt(position2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+    for (int i = 1; i < ITERATIONS && !(reached1 && reached2); i++) {
+        if (!reached1) {
+            position1 -= offset * QUALITY[i];
+            lumaEnd1 = lumaAt(position1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2) {
+            position2 += offset * QUALITY[i];
+            lumaEnd2 = lumaAt(position2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    // the nearer end decides; only move if the luma change there goes the right way
+    float distance1 = isHorizontal ? position.x - position1.x : position.y - position1.y;
+    float distance2 = isHorizontal ? position2.x - position.x : position2.y - position.y;
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeLength = distance1 + distance2;
+    float pixelOffset = -distanceFinal / edgeLength + 0.5;
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+    // sub-pixel aliasing: how far the pixel stands out from its 3x3 average
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixelOffset1 = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+    float subPixelOffset2 = (-2.0 * subPixelOffset1 + 3.0) * subPixelOffset1 * subPixelOffset1;
+    finalOffset = max(finalOffset, subPixelOffset2 * subPixelOffset2 * SUBPIXEL_QUALITY);
+
+    vec2 finalPosition = position;
+    if (isHorizontal) { finalPosition.y += finalOffset * stepLength; } else { finalPosition.x += finalOffset * stepLength; }
+    FragColor = vec4(colorAt(finalPosition), 1.0);
+}
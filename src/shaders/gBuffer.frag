@@ -0,0 +1,43 @@
+#version 460 core
+// compact G-buffer: 4 bytes albedo + specular, 4 bytes normal + gloss, position comes from depth
+layout (location = 0) out vec4 gAlbedoSpec;     // RGBA8: albedo, specular intensity
+layout (location = 1) out vec4 gNormalGloss;    // RGB10_A2: octahedral normal, shininess / 256
+layout (location = 2) out uint ObjectID;
+
+in vec3 Normal;
+in vec2 TexCoords;
+in mat3 TBN;
+
+uniform uint objectID;
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+uniform sampler2D texture_normal1;
+
+uniform bool useNormalMaps;
+uniform float shininess;
+
+vec2 OctWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector -> [0,1]^2 (octahedral mapping)
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main()
+{
+    ObjectID = objectID;
+
+    vec3 normal = normalize(Normal);
+    if(useNormalMaps) {
+        vec3 normalMap = texture(texture_normal1, TexCoords).rgb * 2.0 - 1.0;
+        normal = normalize(TBN * normalMap);
+    }
+
+    gAlbedoSpec = vec4(texture(texture_diffuse1, TexCoords).rgb, texture(texture_specular1, TexCoords).r);
+    gNormalGloss = vec4(EncodeNormal(normal), clamp(shininess / 256.0, 0.0, 1.0), 1.0);
+}
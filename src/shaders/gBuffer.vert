@@ -0,0 +1,32 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec3 aTangent;
+
+out vec3 Normal;
+out vec2 TexCoords;
+out mat3 TBN;
+
+layout(std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    TexCoords = aTexCoords;
+
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+    Normal = normalize(normalMatrix * aNormal);
+
+    // tangent space -> world space (shader.vert stores the transpose, for the other direction)
+    vec3 T = normalize(normalMatrix * aTangent);
+    T = normalize(T - dot(T, Normal) * Normal);
+    vec3 B = cross(Normal, T);
+    TBN = mat3(T, B, Normal);
+
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 460 core
+layout (location = 0) out vec2 Motion;
+
+in vec4 CurrentPos;
+in vec4 PreviousPos;
+
+// screen-space motion in uv units: where the pixel is now minus where it was last frame
+void main()
+{
+    Motion = (CurrentPos.xy / CurrentPos.w - PreviousPos.xy / PreviousPos.w) * 0.5;
+}
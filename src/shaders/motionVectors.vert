@@ -0,0 +1,26 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+layout(std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+uniform mat4 model;
+uniform mat4 previousModel;
+// both without the TAA jitter, so a still object gets no motion
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+
+out vec4 CurrentPos;
+out vec4 PreviousPos;
+
+// has to land on the depth the scene was drawn with, the pass tests against it
+invariant gl_Position;
+
+void main()
+{
+    CurrentPos = viewProjection * model * vec4(aPos, 1.0);
+    PreviousPos = previousViewProjection * previousModel * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -20,6 +20,9 @@ layout(std140) uniform Matrices {
 
 uniform mat4 model;
 
+// the depth pre-pass computes the same position, GL_EQUAL needs them identical
+invariant gl_Position;
+
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
@@ -0,0 +1,20 @@
+#version 460 core
+#extension GL_ARB_shader_viewport_layer_array : require
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 shadowMatrices[6];
+uniform int cubeLayer;      // which cube of the array; its faces are layers 6 * cubeLayer + face
+uniform int faces[6];       // the faces this draw covers, one instance each
+
+out vec4 FragPos;
+
+// layered rendering without a geometry shader: every instance is one cube face and the
+// vertex shader routes it to that face's layer
+void main()
+{
+    int face = faces[gl_InstanceID];
+    FragPos = model * vec4(aPos, 1.0);
+    gl_Position = shadowMatrices[face] * FragPos;
+    gl_Layer = cubeLayer * 6 + face;
+}
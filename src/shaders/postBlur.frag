@@ -0,0 +1,30 @@
+#version 460 core
+out vec4 FragColor;
+
+// one direction of a separable gaussian. Neighbouring kernel taps are merged into a single
+// bilinear fetch placed between them by their weights, so a radius of n texels costs n / 2 + 1
+// fetches instead of 2n + 1
+#define MAX_TAPS 8
+uniform sampler2D source;
+uniform vec2 uvScale;           // valid fraction of the source
+uniform vec2 targetSize;        // pixels of the target, which may be smaller than the source
+uniform vec2 direction;         // (1, 0) or (0, 1)
+uniform int tapCount;           // merged taps either side of the centre
+uniform float weights[MAX_TAPS + 1];    // [0] is the centre
+uniform float offsets[MAX_TAPS + 1];    // in source texels
+
+vec3 sampleSource(vec2 uv) {
+    vec2 halfTexel = 0.5 / vec2(textureSize(source, 0));
+    return texture(source, clamp(uv, halfTexel, uvScale - halfTexel)).rgb;
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / targetSize * uvScale;
+    vec2 step = direction / vec2(textureSize(source, 0));
+    vec3 color = sampleSource(uv) * weights[0];
+    for (int i = 1; i <= tapCount; i++) {
+        color += (sampleSource(uv + step * offsets[i]) + sampleSource(uv - step * offsets[i])) * weights[i];
+    }
+    FragColor = vec4(color, 1.0);
+}
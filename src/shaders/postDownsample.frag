@@ -0,0 +1,23 @@
+#version 460 core
+out vec4 FragColor;
+
+// box filter down to a half or quarter resolution target: four bilinear fetches, each averaging
+// 2x2 source texels, a quarter of the footprint from the centre
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 targetSize;
+uniform float footprint;        // source texels per target pixel, 2 or 4
+
+vec3 sampleSource(vec2 uv) {
+    vec2 halfTexel = 0.5 / vec2(textureSize(source, 0));
+    return texture(source, clamp(uv, halfTexel, uvScale - halfTexel)).rgb;
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / targetSize * uvScale;
+    vec2 offset = 0.25 * footprint / vec2(textureSize(source, 0));
+    vec3 color = sampleSource(uv + vec2(-offset.x, -offset.y)) + sampleSource(uv + vec2(offset.x, -offset.y))
+               + sampleSource(uv + vec2(-offset.x,  offset.y)) + sampleSource(uv + vec2(offset.x,  offset.y));
+    FragColor = vec4(color * 0.25, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 460 core
+out vec4 FragColor;
+
+// 3x3 kernels built on the tent filter (1 2 1 / 2 4 2 / 1 2 1, over 16): four bilinear fetches at
+// the pixel corners average exactly those weights, so with the centre it takes five fetches.
+// sharpen pushes the pixel away from its blurred neighbourhood, edge detection shows the
+// difference (a laplacian)
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 targetSize;
+uniform int mode;               // 0 = sharpen, 1 = edge detection
+uniform float amount;
+
+vec3 sampleSource(vec2 uv) {
+    vec2 halfTexel = 0.5 / vec2(textureSize(source, 0));
+    return texture(source, clamp(uv, halfTexel, uvScale - halfTexel)).rgb;
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / targetSize * uvScale;
+    vec2 corner = 0.5 / vec2(textureSize(source, 0));
+    vec3 center = sampleSource(uv);
+    vec3 tent = 0.25 * (sampleSource(uv + vec2(-corner.x, -corner.y)) + sampleSource(uv + vec2(corner.x, -corner.y))
+                      + sampleSource(uv + vec2(-corner.x,  corner.y)) + sampleSource(uv + vec2(corner.x,  corner.y)));
+    vec3 color = mode == 0 ? max(center + amount * (center - tent), vec3(0.0)) : abs(tent - center) * 4.0 * amount;
+    FragColor = vec4(color, 1.0);
+}
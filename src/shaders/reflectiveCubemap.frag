@@ -1,5 +1,8 @@
 #version 460 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint ObjectID;
+
+uniform uint objectID;
 
 in vec3 Normal;
 in vec3 Position;
@@ -9,6 +12,8 @@ uniform samplerCube skybox;
 
 void main()
 {       
+    ObjectID = objectID;
+
     //just reflection        
     // vec3 I = normalize(Position - cameraPos);
     // vec3 R = reflect(I, normalize(Normal));
@@ -12,9 +12,12 @@ layout(std140) uniform Matrices {
 
 uniform mat4 model;
 
+// the depth pre-pass computes the same position, GL_EQUAL needs them identical
+invariant gl_Position;
+
 void main()
 {
     Normal = mat3(transpose(inverse(model))) * aNormal;
     Position = vec3(model * vec4(aPos, 1.0));
-    gl_Position = projection * view * vec4(Position, 1.0);
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
 } 
\ No newline at end of file
@@ -3,124 +3,100 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
+// Per-pixel part of the post-processing stack. PostProcessStack compiles a variant of this
+// shader for every run of adjacent per-pixel effects, with their calls inserted in stack order at
+// the EFFECTS marker, so a run costs one fetch and one write however many effects it has. The
+// run that ends the stack also draws the selection outline. As it is, it just copies.
 uniform sampler2D screenTexture;
+// the render targets are pooled and can be larger than the viewport; only this fraction is valid
+uniform vec2 uvScale;
 
-uniform bool inverted;
-uniform bool grayscale;
-uniform bool sharpen;
-uniform bool blur;
-uniform bool edgeDetection;
+// tonemapping
+uniform float exposure;
+uniform int tonemapOperator;        // 0 = Reinhard, 1 = ACES (Narkowicz fit)
 
-const float offset = 1.0 / 300.0; 
+// color grading
+uniform float contrast;
+uniform float saturation;
+uniform vec3 colorFilter;
 
-void main()
-{   
-    vec4 result;
-    if(inverted) {
-        result += vec4(vec3(1.0 - texture(screenTexture, TexCoords)), 1.0);
-    } 
+// object-ID buffer, used for the selection outline and hover highlight
+#define MAX_SELECTED 32
+uniform usampler2D idTexture;
+uniform bool showSelection;
+uniform uint hoveredID;
+uniform int numSelected;
+uniform uint selectedIDs[MAX_SELECTED];
+
+const vec3 LUMA = vec3(0.2126, 0.7152, 0.0722);
 
-    if(grayscale){
-        FragColor = texture(screenTexture, TexCoords);
-        float average = 0.2126 * FragColor.r + 0.7152 * FragColor.g + 0.0722 * FragColor.b;
-        result += vec4(average, average, average, 1.0);
+vec3 applyTonemap(vec3 color) {
+    color *= exposure;
+    if (tonemapOperator == 1) {
+        return clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
     }
+    return color / (1.0 + color);
+}
 
-    if(sharpen) {
-        vec2 offsets[9] = vec2[](
-            vec2(-offset,  offset), // top-left
-            vec2( 0.0f,    offset), // top-center
-            vec2( offset,  offset), // top-right
-            vec2(-offset,  0.0f),   // center-left
-            vec2( 0.0f,    0.0f),   // center-center
-            vec2( offset,  0.0f),   // center-right
-            vec2(-offset, -offset), // bottom-left
-            vec2( 0.0f,   -offset), // bottom-center
-            vec2( offset, -offset)  // bottom-right    
-        );
+vec3 applyColorGrading(vec3 color) {
+    color = (color - 0.5) * contrast + 0.5;
+    color = mix(vec3(dot(color, LUMA)), color, saturation);
+    return max(color * colorFilter, vec3(0.0));
+}
 
-        float kernel[9] = float[](
-            -1, -1, -1,
-            -1,  9, -1,
-            -1, -1, -1
-        );
-        
-        vec3 sampleTex[9];
-        for(int i = 0; i < 9; i++)
-        {
-            sampleTex[i] = vec3(texture(screenTexture, TexCoords.st + offsets[i]));
-        }
-        vec3 col = vec3(0.0);
-        for(int i = 0; i < 9; i++)
-            col += sampleTex[i] * kernel[i];
-        
-        result += vec4(col, 1.0);
-    }
+vec3 applyInvert(vec3 color) {
+    return 1.0 - color;
+}
 
-    if(blur) {
-        vec2 offsets[9] = vec2[](
-        vec2(-offset,  offset), // top-left
-        vec2( 0.0f,    offset), // top-center
-        vec2( offset,  offset), // top-right
-        vec2(-offset,  0.0f),   // center-left
-        vec2( 0.0f,    0.0f),   // center-center
-        vec2( offset,  0.0f),   // center-right
-        vec2(-offset, -offset), // bottom-left
-        vec2( 0.0f,   -offset), // bottom-center
-        vec2( offset, -offset)  // bottom-right    
-        );
+vec3 applyGrayscale(vec3 color) {
+    return vec3(dot(color, LUMA));
+}
 
-        float kernel[9] = float[](
-            1.0 / 16, 2.0 / 16, 1.0 / 16,
-            2.0 / 16, 4.0 / 16, 2.0 / 16,
-            1.0 / 16, 2.0 / 16, 1.0 / 16  
-        );
-        
-        vec3 sampleTex[9];
-        for(int i = 0; i < 9; i++)
-        {
-            sampleTex[i] = vec3(texture(screenTexture, TexCoords.st + offsets[i]));
-        }
-        vec3 col = vec3(0.0);
-        for(int i = 0; i < 9; i++)
-            col += sampleTex[i] * kernel[i];
-        
-        result += vec4(col, 1.0);
+bool isSelected(uint id) {
+    if(id == 0u) return false;
+    for(int i = 0; i < numSelected; i++) {
+        if(selectedIDs[i] == id) return true;
     }
+    return false;
+}
 
-    if(edgeDetection) {
-        vec2 offsets[9] = vec2[](
-        vec2(-offset,  offset), // top-left
-        vec2( 0.0f,    offset), // top-center
-        vec2( offset,  offset), // top-right
-        vec2(-offset,  0.0f),   // center-left
-        vec2( 0.0f,    0.0f),   // center-center
-        vec2( offset,  0.0f),   // center-right
-        vec2(-offset, -offset), // bottom-left
-        vec2( 0.0f,   -offset), // bottom-center
-        vec2( offset, -offset)  // bottom-right    
-        );
+uint idAt(ivec2 texel) {
+    ivec2 size = textureSize(idTexture, 0);
+    return texelFetch(idTexture, clamp(texel, ivec2(0), size - 1), 0).r;
+}
 
-        float kernel[9] = float[](
-            1.0, 1.0, 1.0,
-            1.0, -8.0, 1.0,
-            1.0, 1.0, 1.0
-        );
-        
-        vec3 sampleTex[9];
-        for(int i = 0; i < 9; i++)
-        {
-            sampleTex[i] = vec3(texture(screenTexture, TexCoords.st + offsets[i]));
+vec3 applySelection(vec3 color) {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    uint id = idAt(texel);
+    if(id != 0u && id == hoveredID) {
+        color = mix(color, vec3(1.0), 0.15);
+    }
+    // outline: pixels just outside a selected object
+    if(!isSelected(id) && numSelected > 0) {
+        const int width = 2;
+        bool edge = false;
+        for(int x = -width; x <= width && !edge; x++) {
+            for(int y = -width; y <= width && !edge; y++) {
+                edge = isSelected(idAt(texel + ivec2(x, y)));
+            }
         }
-        vec3 col = vec3(0.0);
-        for(int i = 0; i < 9; i++)
-            col += sampleTex[i] * kernel[i];
-        
-        result += vec4(col, 1.0);
+        if(edge) { color = vec3(1.0, 0.6, 0.1); }
     }
+    return color;
+}
 
-    if(!inverted && !grayscale && !sharpen && !blur && !edgeDetection) {
-        result += vec4(texture(screenTexture, TexCoords).rgb, 1.0);
+// clamped to the valid sub-rectangle so bilinear fetches don't pick up stale pixels past the viewport
+vec4 sampleScreen(vec2 uv) {
+    vec2 halfTexel = 0.5 / vec2(textureSize(screenTexture, 0));
+    return texture(screenTexture, clamp(uv * uvScale, halfTexel, uvScale - halfTexel));
+}
+
+void main()
+{
+    vec3 color = sampleScreen(TexCoords).rgb;
+    // EFFECTS
+    if(showSelection) {
+        color = applySelection(color);
     }
-    FragColor = result;
-} 
\ No newline at end of file
+    FragColor = vec4(color, 1.0);
+}
@@ -1,7 +1,10 @@
 #version 460 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint ObjectID;
 
-uniform sampler2D shadowMap;
+uniform uint objectID;
+
+uniform sampler2DArrayShadow shadowMap;
 
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
@@ -63,7 +66,6 @@ uniform int TEST;
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
-in vec4 FragPosLightSpace;
 in vec3 TangentLightPos;
 in vec3 TangentViewPos;
 in vec3 TangentFragPos;
@@ -74,8 +76,27 @@ uniform PointLight pointLights[MAX_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform Material material;
 
-uniform vec3 pointLightPos[MAX_POINT_LIGHTS];
-uniform samplerCube depthCubeMap[MAX_POINT_LIGHTS];
+// point shadows: one cube map array per resolution tier (PointShadowMaps.hpp); a light's
+// slot is (tier << 16) | layer, -1 for unshadowed lights
+#define POINT_SHADOW_TIERS 3
+uniform samplerCubeArrayShadow pointShadowMaps[POINT_SHADOW_TIERS];
+uniform int pointShadowSlots[MAX_POINT_LIGHTS];
+
+// clustered lighting, laid out as in ClusteredLighting.hpp
+struct PointLightData {
+    vec3 position;
+    float radius;
+    vec3 color;
+    int shadowSlot;
+};
+layout(std430, binding = 0) readonly buffer ClusterLightBuffer { PointLightData clusterLights[]; };
+layout(std430, binding = 1) readonly buffer ClusterRecordBuffer { uvec2 clusterRecords[]; };   // offset, count
+layout(std430, binding = 2) readonly buffer ClusterIndexBuffer { uint clusterLightIndices[]; };
+uniform bool useClusteredLighting;
+uniform bool showClusterHeatmap;
+uniform uvec3 clusterGrid;
+uniform vec2 clusterTileSize;
+uniform vec4 clusterDepthSlicing;      // window depth to slice, see ClusterGrid::getDepthSlicing
 
 uniform bool useDiffuse;
 uniform bool useAmbient;
@@ -98,6 +119,23 @@ uniform float exposure;
 uniform float shadowBias;
 uniform float dirShadowBias;
 
+// directional shadow cascades, one array layer each, picked by view depth
+const int MAX_CASCADES = 4;
+uniform mat4 cascadeMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];
+uniform float cascadeTexelSizes[MAX_CASCADES];
+uniform int cascadeCount;
+uniform vec3 viewForward;
+uniform bool showCascades;
+// exponential variance moments of the cascades, or hardware PCF on the depth array
+uniform sampler2DArray shadowMoments;
+uniform bool useShadowMoments;
+uniform vec2 evsmExponents;
+uniform float lightBleedReduction;
+uniform float pixelSpread;          // world size of a pixel per unit of view depth
+uniform float momentTexelScale;     // moment texels are this many depth texels wide
+
+
 uniform float pointLightRadius;
 
 //depth testing
@@ -115,23 +153,23 @@ uniform float directionalLightIntensity;
 uniform float pointLightIntensity;
 
 // array of offset direction for sampling
-vec3 gridSamplingDisk[20] = vec3[]
-(
-   vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1), 
-   vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
-   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
-   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
-   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
-);
+// smooth point shadows take four comparisons on a tetrahedron around the lookup; each is
+// already a 2x2 PCF, so together they cover more texels than 20 single samples did
+const vec3 pcfTetrahedron[4] = vec3[](vec3(1, 1, 1), vec3(1, -1, -1), vec3(-1, 1, -1), vec3(-1, -1, 1));
 
 // function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, int index);
+vec3 CalcClusterLight(PointLightData data, vec3 normal, vec3 fragPos, vec3 viewDir);
+uint ClusterIndex();
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal);
+float ShadowCalculation(vec3 fragPos, vec3 normal);
+int CascadeIndex(vec3 fragPos);
+vec3 CascadeTint(int cascade);
 float PointShadowCalculation(vec3 fragPos, int index, vec3 normal);
 
 void main() {
+    ObjectID = objectID;
 
     const float gamma = 2.2;
     vec3 hdrColor = texture(texture_diffuse1, TexCoords).rgb;
@@ -155,85 +193,134 @@ void main() {
     }
     
     // point lights
-    if(usePointLight) {
+    uint clusterLightCount = 0u;
+    if(usePointLight && useClusteredLighting) {
+        // only the lights whose influence reaches this fragment's froxel
+        uvec2 record = clusterRecords[ClusterIndex()];
+        clusterLightCount = record.y;
+        for(uint i = 0u; i < record.y; i++) {
+            PointLightData data = clusterLights[clusterLightIndices[record.x + i]];
+            result += CalcClusterLight(data, norm, FragPos, viewDir) * pointLightIntensity;
+        }
+    } else if(usePointLight) {
         for(int i = 0; i < NR_POINT_LIGHTS; i++) { 
             // if(useNormalMaps) {
             //     //result += CalcPointLight(pointLights[i], normalMap, FragPos, viewDirNormal, i) * pointLightIntensity; 
             //     result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, i) * pointLightIntensity; 
             // } else {
-                result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, i) * pointLightIntensity; 
+                result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, pointShadowSlots[i]) * pointLightIntensity; 
             // }
         }
     }   
     // spot light
     if(useFlashlight) { result += CalcSpotLight(spotLight, norm, FragPos, viewDir) * flashlightIntensity; }
     
-    if (!showDepthBuffer) {
+    if (showClusterHeatmap) {
+        // blue (no lights) through green to red (32+ lights)
+        float t = clamp(float(clusterLightCount) / 32.0, 0.0, 1.0);
+        vec3 heat = t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), t * 2.0) : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), t * 2.0 - 1.0);
+        FragColor = vec4(mix(result * mapped, heat, 0.6), 1.0);
+    } else if (!showDepthBuffer) {
         FragColor = vec4(result * mapped, 1.0);
+        if (showCascades) { FragColor.rgb *= CascadeTint(CascadeIndex(FragPos)); }
     } else {
         float depth = LinearizeDepth(gl_FragCoord.z) / far;
         FragColor = vec4(vec3(depth), 1.0);
     }
 }
 
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal) {
-    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    projCoords = projCoords * 0.5 + 0.5;
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
-    float currentDepth = projCoords.z;
-    normal = normalize(Normal);
-    //vec3 lightDir = normalize(TangentLightPos - TangentFragPos);
-    vec3 lightDir = normalize(lightPos - FragPos);
+// cascade the fragment's view depth falls in, -1 past the last one
+int CascadeIndex(vec3 fragPos) {
+    float depth = dot(fragPos - viewPos, viewForward);
+    for(int i = 0; i < cascadeCount; i++) {
+        if(depth < cascadeSplits[i]) return i;
+    }
+    return -1;
+}
+
+vec3 CascadeTint(int cascade) {
+    const vec3 tints[MAX_CASCADES] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+    return cascade < 0 ? vec3(1.0) : tints[cascade];
+}
+
+// Chebyshev's upper bound on the lit fraction; the bottom of it is cut off, which is what
+// shows up as light bleeding where occluders overlap
+float ChebyshevUpperBound(vec2 moments, float mean, float minVariance) {
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = mean - moments.x;
+    float pMax = variance / (variance + d * d);
+    pMax = clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+    return mean <= moments.x ? 1.0 : pMax;
+}
+
+float EVSMVisibility(vec4 moments, float depth) {
+    depth = depth * 2.0 - 1.0;
+    vec2 warped = vec2(exp(evsmExponents.x * depth), -exp(-evsmExponents.y * depth));
+    // the variance floor follows the slope of the warp
+    vec2 depthScale = 0.0001 * evsmExponents * warped;
+    vec2 minVariance = depthScale * depthScale;
+    return min(ChebyshevUpperBound(moments.xy, warped.x, minVariance.x), ChebyshevUpperBound(moments.zw, warped.y, minVariance.y));
+}
+
+float ShadowCalculation(vec3 fragPos, vec3 normal) {
+    int cascade = CascadeIndex(fragPos);
+    if(cascade < 0) { return 0.0; }
+    // texels grow with every cascade, so the lookup is pushed out along the normal by one
+    vec3 lightDir = normalize(lightPos - fragPos);
+    vec3 offset = normal * cascadeTexelSizes[cascade] * (1.0 - max(dot(normal, lightDir), 0.0));
+    vec4 fragPosLightSpace = cascadeMatrices[cascade] * vec4(fragPos + offset, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz * 0.5 + 0.5;
+    if(projCoords.z > 1.0) { return 0.0; }
+    if(useShadowMoments) {
+        // pick the mip from how much ground a pixel covers, derivatives would jump between cascades
+        float pixelSize = dot(fragPos - viewPos, viewForward) * pixelSpread;
+        float lod = log2(max(pixelSize / (cascadeTexelSizes[cascade] * momentTexelScale), 1.0));
+        vec4 moments = textureLod(shadowMoments, vec3(projCoords.xy, cascade), lod);
+        return 1.0 - EVSMVisibility(moments, projCoords.z);
+    }
+    // four bilinear comparisons half a texel apart cover the same 3x3 texels as a 3x3 PCF
     float bias = max(0.0005 * (1.0 - dot(normal, lightDir)), dirShadowBias);
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for(int x = -1; x <= 1; ++x) {
-        for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
-        }    
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = 0; x < 2; ++x) {
+        for(int y = 0; y < 2; ++y) {
+            vec2 uv = projCoords.xy + (vec2(x, y) - 0.5) * texelSize;
+            lit += texture(shadowMap, vec4(uv, cascade, projCoords.z - bias));
+        }
+    }
+    return 1.0 - lit / 4.0;
+}
+
+// lit fraction from one hardware comparison (a bilinear 2x2 PCF). the slot isn't dynamically
+// uniform (cluster lists, tiers), so pick the array with constant indices instead
+float CompareDepthCube(int slot, vec3 dir, float depth) {
+    int tier = slot >> 16;
+    float layer = float(slot & 0xFFFF);
+    for(int i = 0; i < POINT_SHADOW_TIERS; i++) {
+        if(i == tier) { return texture(pointShadowMaps[i], vec4(dir, layer), depth); }
     }
-    shadow /= 9.0;
-    if(projCoords.z > 1.0) { shadow = 0.0; }
-    return shadow;
+    return 1.0;
 }
 
-float PointShadowCalculation(vec3 fragPos, int index, vec3 normal)
+float PointShadowCalculation(vec3 fragPos, vec3 lightPosition, int slot, vec3 normal)
 {
-    float shadow = 0.0;
+    vec3 fragToLight = fragPos - lightPosition;
+    float currentDepth = length(fragToLight);
+    float lit = 0.0;
     if(useSmoothShadows) {
-        // get vector between fragment position and light position
-        vec3 fragToLight = fragPos - pointLightPos[index];
-        //vec3 fragToLight = TBN * fragPos - TBN * pointLightPos[index];
-        float currentDepth = length(fragToLight);
-        float bias = shadowBias;
-        int samples = 20;
-        //float viewDistance = length(TBN * viewPos - TBN * fragPos);
         float viewDistance = length(viewPos - fragPos);
         float diskRadius = (1.0 + (viewDistance / far_plane)) / pointLightRadius;
-        for(int i = 0; i < samples; ++i) {
-            float closestDepth = texture(depthCubeMap[index], fragToLight + gridSamplingDisk[i] * diskRadius).r;
-            closestDepth *= far_plane;
-            if(currentDepth - bias > closestDepth)
-                shadow += 1.0;
+        float reference = (currentDepth - shadowBias) / far_plane;
+        for(int i = 0; i < 4; ++i) {
+            lit += CompareDepthCube(slot, fragToLight + pcfTetrahedron[i] * diskRadius, reference);
         }
-        shadow /= float(samples);
+        lit /= 4.0;
     } else {
-        // get vector between fragment position and light position
-        vec3 fragToLight = fragPos - pointLightPos[index];
-        // use the light to fragment vector to sample from the depth map    
-        float closestDepth = texture(depthCubeMap[index], fragToLight).r;
-        // it is currently in linear range between [0,1]. Re-transform back to original value
-        closestDepth *= far_plane;
-        // now get current linear depth as the length between the fragment and light position
-        float currentDepth = length(fragToLight);
-        // now test for shadows
-        vec3 lightDir = normalize(pointLightPos[index] - fragPos);
-        // float bias = shadowBias; 
+        vec3 lightDir = normalize(lightPosition - fragPos);
         float bias = max(shadowBias * (1.0 - dot(normal, lightDir)), shadowBias);
-        shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+        lit = CompareDepthCube(slot, fragToLight, (currentDepth - bias) / far_plane);
     }
-    return shadow;
+    return 1.0 - lit;
 }
 
 // calculates the color when using a directional light.
@@ -265,7 +352,7 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     specular *= useSpecular ? 1 : 0;
     ambient *= useAmbient ? 1 : 0;
     if(useShadows) {
-        return ambient + (1.0 - ShadowCalculation(FragPosLightSpace, normal)) * (diffuse + specular);
+        return ambient + (1.0 - ShadowCalculation(FragPos, normalize(Normal))) * (diffuse + specular);
         //return (ambient + diffuse + specular);
         //return (texture(material.diffuse, TexCoords).rgb * (diffuse * (1.0 - ShadowCalculation(FragPosLightSpace)) + ambient) + texture(material.specular, TexCoords).r * specular  * (1.0 - ShadowCalculation(FragPosLightSpace))) * (dirLight.diffuse + dirLight.ambient + dirLight.specular);
     } else {
@@ -274,7 +361,7 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, int index) {
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, int shadowSlot) {
     vec3 lightDir = vec3(0.0);
     //if(useNormalMaps) {
         //lightDir = normalize(TBN * light.position - TangentFragPos); // normal mapping
@@ -308,13 +395,13 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, i
     diffuse *= useDiffuse ? 1 : 0;
     specular *= useSpecular ? 1 : 0;
     ambient *= useAmbient ? 1 : 0;
-    if(useShadows) {
+    if(useShadows && shadowSlot >= 0) {
         //return ambient + (1.0 - ShadowCalculation(FragPosLightSpace)) * (diffuse + specular);
         //return (texture(material.diffuse, TexCoords).rgb * (diffuse * (1.0 - PointShadowCalculation(FragPos)) + ambient) + texture(material.specular, TexCoords).r * specular  * (1.0 - PointShadowCalculation(FragPos))) * (light.diffuse + light.ambient + light.specular);
         //return ambient + (1.0 - PointShadowCalculation(FragPos, index, normal)) * (diffuse + specular);
         //return (ambient + diffuse + specular);
         // Calculate the shadow factor
-        float shadowFactorInt = 1.0 - PointShadowCalculation(FragPos, index, normal);
+        float shadowFactorInt = 1.0 - PointShadowCalculation(FragPos, light.position, shadowSlot, normal);
 
         // Mix shadowed and unshadowed contributions
         vec3 unshadowedColor = ambient + diffuse + specular;
@@ -361,4 +448,30 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     specular *= useSpecular ? 1 : 0;
     ambient *= useAmbient ? 1 : 0;
     return (ambient + diffuse + specular);
-}
\ No newline at end of file
+}
+
+// froxel of this fragment: screen tile from the pixel position, slice from linear depth
+uint ClusterIndex() {
+    float logSlice = floor(log(clusterDepthSlicing.x - clusterDepthSlicing.y * gl_FragCoord.z) * clusterDepthSlicing.z + clusterDepthSlicing.w);
+    uint slice = uint(clamp(logSlice, 0.0, float(clusterGrid.z - 1u)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), clusterGrid.xy - 1u);
+    return (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+}
+
+// point light from the cluster buffers, with the same falloff as the uniform lights plus a
+// window that takes it smoothly to zero at its influence radius
+vec3 CalcClusterLight(PointLightData data, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    float distance = length(data.position - fragPos);
+    float ratio = distance / data.radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    if(window <= 0.0) return vec3(0.0);
+    PointLight light;
+    light.position = data.position;
+    light.constant = 1.0;
+    light.linear = 0.09;
+    light.quadratic = 0.032;
+    light.ambient = data.color / 20.0;
+    light.diffuse = data.color;
+    light.specular = data.color / 1.5;
+    return CalcPointLight(light, normal, fragPos, viewDir, data.shadowSlot) * window * window;
+}
@@ -11,7 +11,6 @@ out vec3 TangentLightPos;
 out vec3 TangentViewPos;
 out vec3 TangentFragPos;
 out vec2 TexCoords;
-out vec4 FragPosLightSpace;
 out mat3 TBN;
 
 layout(std140) uniform Matrices {
@@ -20,7 +19,9 @@ layout(std140) uniform Matrices {
 };
 
 uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
+
+// the depth pre-pass computes the same position, GL_EQUAL needs them identical
+invariant gl_Position;
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
@@ -35,9 +36,6 @@ void main()
     mat3 normalMatrix = transpose(inverse(mat3(model)));
     Normal = normalize(normalMatrix * aNormal);
 
-    // Shadow mapping position
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
-    
     // Build TBN matrix with corrected basis vectors
     vec3 T = normalize(normalMatrix * aTangent);
     vec3 N = Normal;
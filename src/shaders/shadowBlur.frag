@@ -0,0 +1,23 @@
+#version 460 core
+layout (location = 0) out vec4 FragColor;
+
+// one direction of a separable gaussian over a layer of a moment array
+uniform sampler2DArray source;
+uniform int layer;
+uniform ivec2 direction;    // (1, 0) or (0, 1)
+uniform int radius;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(source, 0).xy - 1;
+    float sigma = float(radius) * 0.5 + 0.5;
+    vec4 sum = vec4(0.0);
+    float weights = 0.0;
+    for(int i = -radius; i <= radius; i++) {
+        float w = exp(-float(i * i) / (2.0 * sigma * sigma));
+        sum += texelFetch(source, ivec3(clamp(texel + direction * i, ivec2(0), last), layer), 0) * w;
+        weights += w;
+    }
+    FragColor = sum / weights;
+}
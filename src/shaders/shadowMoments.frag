@@ -0,0 +1,23 @@
+#version 460 core
+layout (location = 0) out vec4 FragColor;
+
+// one cascade of the directional shadow array, turned into EVSM moments at half resolution
+uniform sampler2DArray depthMap;
+uniform int layer;
+uniform vec2 exponents;
+
+void main()
+{
+    // average the moments of the 2x2 depth texels under this moment texel
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    vec4 moments = vec4(0.0);
+    for(int y = 0; y < 2; y++) {
+        for(int x = 0; x < 2; x++) {
+            float depth = texelFetch(depthMap, ivec3(base + ivec2(x, y), layer), 0).r * 2.0 - 1.0;
+            float positive = exp(exponents.x * depth);
+            float negative = -exp(-exponents.y * depth);
+            moments += vec4(positive, positive * positive, negative, negative * negative);
+        }
+    }
+    FragColor = moments * 0.25;
+}
@@ -0,0 +1,45 @@
+#version 460 core
+out vec4 FragColor;
+
+// SMAA 1x, last pass: blend every pixel across the edges around it by their weights; the bottom
+// and left ones are stored with the pixel, the top and right ones with the neighbour that owns
+// those edges. Only the stronger direction is used: the short steps of a staircase carry small
+// weights of their own that would otherwise be blended in a second time
+uniform sampler2D screenTexture;
+uniform sampler2D weightsTexture;
+uniform vec2 viewportSize;
+
+ivec2 clampTexel(ivec2 texel) {
+    return clamp(texel, ivec2(0), ivec2(viewportSize) - 1);
+}
+
+vec3 colorAt(ivec2 texel) {
+    return texelFetch(screenTexture, clampTexel(texel), 0).rgb;
+}
+
+vec4 weightsAt(ivec2 texel) {
+    if (any(greaterThanEqual(texel, ivec2(viewportSize)))) return vec4(0.0);
+    return texelFetch(weightsTexture, texel, 0);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 weights = weightsAt(texel);
+    float bottom = weights.r;
+    float left = weights.b;
+    float top = weightsAt(texel + ivec2(0, 1)).g;
+    float right = weightsAt(texel + ivec2(1, 0)).a;
+    if (max(bottom, top) >= max(left, right)) { left = right = 0.0; }
+    else { bottom = top = 0.0; }
+    float total = bottom + left + top + right;
+    vec3 color = colorAt(texel);
+    if (total == 0.0) {
+        FragColor = vec4(color, 1.0);
+        return;
+    }
+    float scale = total > 1.0 ? 1.0 / total : 1.0;
+    vec3 neighbours = colorAt(texel + ivec2(0, -1)) * bottom + colorAt(texel + ivec2(0, 1)) * top
+                    + colorAt(texel + ivec2(-1, 0)) * left + colorAt(texel + ivec2(1, 0)) * right;
+    FragColor = vec4(color * (1.0 - total * scale) + neighbours * scale, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 460 core
+layout (location = 0) out vec2 Edges;
+
+// SMAA 1x, first pass: luma edges with the pixel's left (r) and bottom (g) neighbour. local
+// contrast adaptation drops an edge that is much weaker than another one next to it, which
+// keeps the pattern search in the next pass to the dominant edges
+uniform sampler2D screenTexture;
+uniform vec2 viewportSize;
+
+const float THRESHOLD = 0.1;
+const float CONTRAST_ADAPTATION = 2.0;
+
+float lumaAt(ivec2 texel) {
+    vec3 color = texelFetch(screenTexture, clamp(texel, ivec2(0), ivec2(viewportSize) - 1), 0).rgb;
+    return dot(sqrt(clamp(color, 0.0, 1.0)), vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float luma = lumaAt(texel);
+    float lumaLeft = lumaAt(texel + ivec2(-1, 0));
+    float lumaBottom = lumaAt(texel + ivec2(0, -1));
+    vec2 delta = abs(luma - vec2(lumaLeft, lumaBottom));
+    vec2 edges = step(THRESHOLD, delta);
+    if (edges.x + edges.y == 0.0) discard;
+
+    float lumaRight = lumaAt(texel + ivec2(1, 0));
+    float lumaTop = lumaAt(texel + ivec2(0, 1));
+    float lumaLeftLeft = lumaAt(texel + ivec2(-2, 0));
+    float lumaBottomBottom = lumaAt(texel + ivec2(0, -2));
+    vec2 maxDelta = max(delta, abs(luma - vec2(lumaRight, lumaTop)));
+    maxDelta = max(maxDelta, abs(vec2(lumaLeft, lumaBottom) - vec2(lumaLeftLeft, lumaBottomBottom)));
+    float finalDelta = max(maxDelta.x, maxDelta.y);
+    edges *= step(finalDelta, CONTRAST_ADAPTATION * delta);
+    Edges = edges;
+}
@@ -0,0 +1,105 @@
+#version 460 core
+layout (location = 0) out vec4 Weights;
+
+// SMAA 1x, second pass: for every edge the pixel owns (left and bottom), search along it for
+// its two ends and the crossing edges there, which give the shape of the aliased silhouette
+// (L, Z or U). The silhouette is revectorised as a line from each bent end to the middle of the
+// edge and the area it cuts from the pixels on both sides of the edge becomes their blend weight.
+// The areas are computed directly instead of being looked up from the precomputed area texture.
+// r: this pixel towards its bottom neighbour, g: the bottom neighbour towards this pixel,
+// b: this pixel towards its left neighbour, a: the left neighbour towards this pixel
+uniform sampler2D edgesTexture;
+uniform vec2 viewportSize;
+
+const int MAX_SEARCH = 16;      // pixels either way along an edge
+
+vec2 edgesAt(ivec2 texel) {
+    if (any(lessThan(texel, ivec2(0))) || any(greaterThanEqual(texel, ivec2(viewportSize)))) return vec2(0.0);
+    return texelFetch(edgesTexture, texel, 0).rg;
+}
+
+bool leftEdge(ivec2 texel) { return edgesAt(texel).r > 0.5; }
+bool bottomEdge(ivec2 texel) { return edgesAt(texel).g > 0.5; }
+
+// how an end of the edge bends: towards this pixel's side (+), the neighbour's side (-) or not
+float bend(bool near, bool far) {
+    return near == far ? 0.0 : (near ? 0.5 : -0.5);
+}
+
+// area between the edge and the line a-b over [x0, x1], split into (above, below) the edge
+vec2 segmentArea(vec2 a, vec2 b, float x0, float x1) {
+    float lo = max(x0, a.x);
+    float hi = min(x1, b.x);
+    if (hi <= lo) return vec2(0.0);
+    float slope = (b.y - a.y) / (b.x - a.x);
+    float y0 = a.y + slope * (lo - a.x);
+    float y1 = a.y + slope * (hi - a.x);
+    if (y0 * y1 >= 0.0) {
+        float area = 0.5 * (y0 + y1) * (hi - lo);
+        return area >= 0.0 ? vec2(area, 0.0) : vec2(0.0, -area);
+    }
+    // the line crosses the edge inside the span: two triangles on opposite sides
+    float crossing = lo + (hi - lo) * y0 / (y0 - y1);
+    float area0 = 0.5 * y0 * (crossing - lo);
+    float area1 = 0.5 * y1 * (hi - crossing);
+    return vec2(max(area0, 0.0) + max(area1, 0.0), max(-area0, 0.0) + max(-area1, 0.0));
+}
+
+// coverage of the pixel at [x, x + 1] along an edge of the given length whose ends bend by
+// bend0 and bend1
+vec2 edgeArea(float x, float len, float bend0, float bend1) {
+    if (bend0 != 0.0 && bend1 != 0.0 && bend0 != bend1) {
+        // Z shape: one straight line from end to end
+        return segmentArea(vec2(0.0, bend0), vec2(len, bend1), x, x + 1.0);
+    }
+    vec2 area = vec2(0.0);
+    float mid = 0.5 * len;
+    if (bend0 != 0.0) area += segmentArea(vec2(0.0, bend0), vec2(mid, 0.0), x, x + 1.0);
+    if (bend1 != 0.0) area += segmentArea(vec2(mid, 0.0), vec2(len, bend1), x, x + 1.0);
+    return area;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec2 edges = edgesAt(texel);
+    Weights = vec4(0.0);
+
+    // edge along the bottom: search left and right, stopping at a crossing edge
+    if (edges.g > 0.5) {
+        int left = 0;
+        for (; left < MAX_SEARCH; left++) {
+            ivec2 t = texel - ivec2(left, 0);
+            if (leftEdge(t) || leftEdge(t + ivec2(0, -1)) || !bottomEdge(t + ivec2(-1, 0))) break;
+        }
+        int right = 0;
+        for (; right < MAX_SEARCH; right++) {
+            ivec2 t = texel + ivec2(right, 0);
+            if (leftEdge(t + ivec2(1, 0)) || leftEdge(t + ivec2(1, -1)) || !bottomEdge(t + ivec2(1, 0))) break;
+        }
+        ivec2 end0 = texel - ivec2(left, 0);
+        ivec2 end1 = texel + ivec2(right, 0);
+        float bend0 = bend(leftEdge(end0), leftEdge(end0 + ivec2(0, -1)));
+        float bend1 = bend(leftEdge(end1 + ivec2(1, 0)), leftEdge(end1 + ivec2(1, -1)));
+        Weights.rg = edgeArea(float(left), float(left + right + 1), bend0, bend1);
+    }
+
+    // edge along the left: the same going down and up, crossings are bottom edges
+    if (edges.r > 0.5) {
+        int down = 0;
+        for (; down < MAX_SEARCH; down++) {
+            ivec2 t = texel - ivec2(0, down);
+            if (bottomEdge(t) || bottomEdge(t + ivec2(-1, 0)) || !leftEdge(t + ivec2(0, -1))) break;
+        }
+        int up = 0;
+        for (; up < MAX_SEARCH; up++) {
+            ivec2 t = texel + ivec2(0, up);
+            if (bottomEdge(t + ivec2(0, 1)) || bottomEdge(t + ivec2(-1, 1)) || !leftEdge(t + ivec2(0, 1))) break;
+        }
+        ivec2 end0 = texel - ivec2(0, down);
+        ivec2 end1 = texel + ivec2(0, up);
+        float bend0 = bend(bottomEdge(end0), bottomEdge(end0 + ivec2(-1, 0)));
+        float bend1 = bend(bottomEdge(end1 + ivec2(0, 1)), bottomEdge(end1 + ivec2(-1, 1)));
+        Weights.ba = edgeArea(float(down), float(down + up + 1), bend0, bend1);
+    }
+}
@@ -0,0 +1,109 @@
+#version 460 core
+out vec4 FragColor;
+
+uniform sampler2D currentColor;     // this frame, jittered
+uniform sampler2D history;          // last frame's resolve, viewport sized
+uniform sampler2D motionVectors;
+uniform sampler2D depthTexture;
+uniform vec2 viewportSize;
+uniform bool hasHistory;
+uniform float feedback;
+
+vec3 RGBToYCoCg(vec3 c) {
+    return vec3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b, 0.5 * c.r - 0.5 * c.b, -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+vec3 YCoCgToRGB(vec3 c) {
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+ivec2 clampTexel(ivec2 texel) {
+    return clamp(texel, ivec2(0), ivec2(viewportSize) - 1);
+}
+
+vec3 colorAt(ivec2 texel) {
+    return RGBToYCoCg(max(texelFetch(currentColor, clampTexel(texel), 0).rgb, vec3(0.0)));
+}
+
+vec3 historyAt(vec2 uv) {
+    return RGBToYCoCg(max(textureLod(history, uv, 0.0).rgb, vec3(0.0)));
+}
+
+// bicubic Catmull-Rom in 5 bilinear taps (the corners are dropped); keeps the history from
+// going soft under repeated resampling
+vec3 sampleHistory(vec2 uv) {
+    vec2 position = uv * viewportSize;
+    vec2 center = floor(position - 0.5) + 0.5;
+    vec2 f = position - center;
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+    vec2 uv0 = (center - 1.0) / viewportSize;
+    vec2 uv3 = (center + 2.0) / viewportSize;
+    vec2 uv12 = (center + w2 / w12) / viewportSize;
+    vec3 result = historyAt(vec2(uv12.x, uv0.y)) * w12.x * w0.y
+                + historyAt(vec2(uv0.x, uv12.y)) * w0.x * w12.y
+                + historyAt(uv12) * w12.x * w12.y
+                + historyAt(vec2(uv3.x, uv12.y)) * w3.x * w12.y
+                + historyAt(vec2(uv12.x, uv3.y)) * w12.x * w3.y;
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    return result / weight;
+}
+
+// pull the history towards the box centre until it is inside the box
+vec3 clipToBox(vec3 color, vec3 boxMin, vec3 boxMax) {
+    vec3 center = 0.5 * (boxMax + boxMin);
+    vec3 extents = 0.5 * (boxMax - boxMin) + 0.0001;
+    vec3 offset = color - center;
+    vec3 unit = abs(offset / extents);
+    float largest = max(unit.x, max(unit.y, unit.z));
+    return largest > 1.0 ? center + offset / largest : color;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    // neighbourhood statistics of the current frame, and the nearest surface for the motion
+    // vector so edges of moving objects don't reproject the background behind them
+    vec3 m1 = vec3(0.0), m2 = vec3(0.0);
+    vec3 boxMin = vec3(1e30), boxMax = vec3(-1e30);
+    vec3 current = vec3(0.0);
+    float nearest = 2.0;
+    ivec2 nearestTexel = texel;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 t = clampTexel(texel + ivec2(x, y));
+            vec3 c = colorAt(t);
+            if (x == 0 && y == 0) current = c;
+            m1 += c;
+            m2 += c * c;
+            boxMin = min(boxMin, c);
+            boxMax = max(boxMax, c);
+            float depth = texelFetch(depthTexture, t, 0).r;
+            if (depth < nearest) { nearest = depth; nearestTexel = t; }
+        }
+    }
+
+    vec2 motion = texelFetch(motionVectors, nearestTexel, 0).rg;
+    vec2 previousUV = gl_FragCoord.xy / viewportSize - motion;
+    if (!hasHistory || any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0)))) {
+        FragColor = vec4(YCoCgToRGB(current), 1.0);
+        return;
+    }
+
+    // variance clipping: a box of one standard deviation around the mean, inside the min/max box
+    vec3 mean = m1 / 9.0;
+    vec3 sigma = sqrt(max(m2 / 9.0 - mean * mean, vec3(0.0)));
+    vec3 clipMin = max(boxMin, mean - sigma);
+    vec3 clipMax = min(boxMax, mean + sigma);
+    vec3 previous = clipToBox(sampleHistory(previousUV), clipMin, clipMax);
+
+    // weigh by inverse luma so single bright samples don't flicker through the average
+    float currentWeight = (1.0 - feedback) / (1.0 + current.x);
+    float historyWeight = feedback / (1.0 + max(previous.x, 0.0));
+    vec3 result = (current * currentWeight + previous * historyWeight) / (currentWeight + historyWeight);
+    FragColor = vec4(max(YCoCgToRGB(result), vec3(0.0)), 1.0);
+}
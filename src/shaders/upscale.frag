@@ -0,0 +1,91 @@
+#version 460 core
+out vec4 FragColor;
+
+// edge-adaptive spatial upscale in the style of FSR 1's EASU: the luma gradient of the 2x2 texels
+// around the sample gives an edge direction and strength, and a 12-tap approximated Lanczos-2
+// kernel is stretched along the edge and narrowed across it, so edges stay sharp without the
+// staircase a plain bilinear stretch shows. the result is clamped to the 2x2 texels to avoid ringing
+uniform sampler2D source;
+uniform vec2 renderSize;       // valid region of the source, which may be a larger pooled texture
+uniform vec2 displaySize;
+
+vec3 fetch(ivec2 texel) {
+    return texelFetch(source, clamp(texel, ivec2(0), ivec2(renderSize) - 1), 0).rgb;
+}
+
+float lumaOf(vec3 color) {
+    return dot(color, vec3(0.5, 1.0, 0.5));
+}
+
+// direction and edge strength seen from one texel of the centre quad, weighted by its bilinear share.
+// c is the texel, l/r/u/d its neighbours
+void accumulateEdge(inout vec2 dir, inout float len, float weight, float l, float c, float r, float d, float u) {
+    float dirX = r - l;
+    float lenX = max(abs(r - c), abs(c - l));
+    lenX = lenX > 0.0 ? clamp(abs(dirX) / lenX, 0.0, 1.0) : 0.0;
+    float dirY = u - d;
+    float lenY = max(abs(u - c), abs(c - d));
+    lenY = lenY > 0.0 ? clamp(abs(dirY) / lenY, 0.0, 1.0) : 0.0;
+    dir += vec2(dirX, dirY) * weight;
+    len += (lenX * lenX + lenY * lenY) * weight;
+}
+
+// approximated Lanczos-2 weight of a tap at offset from the sample, in the rotated and scaled edge space
+float tapWeight(vec2 offset, vec2 dir, vec2 scale, float lobe, float clip) {
+    vec2 v = vec2(dot(offset, dir), dot(offset, vec2(-dir.y, dir.x))) * scale;
+    float d2 = min(dot(v, v), clip);
+    float base = 0.4 * d2 - 1.0;
+    float window = lobe * d2 - 1.0;
+    base = base * base * (25.0 / 16.0) - (25.0 / 16.0 - 1.0);
+    return base * window * window;
+}
+
+void main()
+{
+    // sample position in source texels, relative to the texel centre at its lower left
+    vec2 position = gl_FragCoord.xy * (renderSize / displaySize) - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+
+    // the 4x4 neighbourhood without its corners
+    vec3 color[4][4];
+    float luma[4][4];
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            if ((x == 0 || x == 3) && (y == 0 || y == 3)) continue;
+            color[x][y] = fetch(base + ivec2(x - 1, y - 1));
+            luma[x][y] = lumaOf(color[x][y]);
+        }
+    }
+
+    vec2 dir = vec2(0.0);
+    float len = 0.0;
+    accumulateEdge(dir, len, (1.0 - f.x) * (1.0 - f.y), luma[0][1], luma[1][1], luma[2][1], luma[1][0], luma[1][2]);
+    accumulateEdge(dir, len, f.x * (1.0 - f.y),         luma[1][1], luma[2][1], luma[3][1], luma[2][0], luma[2][2]);
+    accumulateEdge(dir, len, (1.0 - f.x) * f.y,         luma[0][2], luma[1][2], luma[2][2], luma[1][1], luma[1][3]);
+    accumulateEdge(dir, len, f.x * f.y,                 luma[1][2], luma[2][2], luma[3][2], luma[2][1], luma[2][3]);
+
+    // flat areas get an isotropic kernel
+    float dirLength = dot(dir, dir);
+    dir = dirLength < 1.0 / 32768.0 ? vec2(1.0, 0.0) : dir * inversesqrt(dirLength);
+    len = len * 0.5;
+    len *= len;
+    float stretch = 1.0 / max(abs(dir.x), abs(dir.y));
+    vec2 scale = vec2(1.0 + (stretch - 1.0) * len, 1.0 - 0.5 * len);
+    float lobe = 0.5 + (1.0 / 4.0 - 0.04 - 0.5) * len;
+    float clip = 1.0 / lobe;
+
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            if ((x == 0 || x == 3) && (y == 0 || y == 3)) continue;
+            float w = tapWeight(vec2(x - 1, y - 1) - f, dir, scale, lobe, clip);
+            sum += color[x][y] * w;
+            weightSum += w;
+        }
+    }
+    vec3 minColor = min(min(color[1][1], color[2][1]), min(color[1][2], color[2][2]));
+    vec3 maxColor = max(max(color[1][1], color[2][1]), max(color[1][2], color[2][2]));
+    FragColor = vec4(clamp(sum / weightSum, minColor, maxColor), 1.0);
+}
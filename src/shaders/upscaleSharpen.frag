@@ -0,0 +1,36 @@
+#version 460 core
+out vec4 FragColor;
+
+// contrast-adaptive sharpening after the upscale, in the style of FSR 1's RCAS: a negative lobe on
+// the four neighbours, as strong as it can be without pushing the centre outside the range of
+// its neighbourhood, so it restores detail the upscale softened without adding halos
+uniform sampler2D source;
+uniform vec2 displaySize;      // valid region of the source, which may be a larger pooled texture
+uniform float sharpness;       // 0 is the strongest, every unit halves it
+
+const float LOBE_LIMIT = 0.25 - 1.0 / 16.0;
+
+vec3 fetch(ivec2 texel) {
+    return clamp(texelFetch(source, clamp(texel, ivec2(0), ivec2(displaySize) - 1), 0).rgb, 0.0, 1.0);
+}
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec3 b = fetch(p + ivec2(0, 1));
+    vec3 d = fetch(p + ivec2(-1, 0));
+    vec3 e = fetch(p);
+    vec3 f = fetch(p + ivec2(1, 0));
+    vec3 h = fetch(p + ivec2(0, -1));
+
+    vec3 minRing = min(min(b, d), min(f, h));
+    vec3 maxRing = max(max(b, d), max(f, h));
+    // the lobe at which the result would reach 0 or 1 in each channel
+    vec3 hitMin = min(minRing, e) / (4.0 * maxRing + 1e-5);
+    vec3 hitMax = (1.0 - max(maxRing, e)) / (4.0 * minRing - 4.0 - 1e-5);
+    vec3 lobeRGB = max(-hitMin, hitMax);
+    float lobe = max(-LOBE_LIMIT, min(max(lobeRGB.r, max(lobeRGB.g, lobeRGB.b)), 0.0)) * exp2(-sharpness);
+
+    vec3 color = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+    FragColor = vec4(color, 1.0);
+}
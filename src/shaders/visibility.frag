@@ -0,0 +1,24 @@
+#version 460 core
+// the whole geometry pass output: which draw and which of its triangles covers the pixel
+layout (location = 0) out uvec2 Visibility;    // (draw index + 1, triangle), 0 = nothing
+layout (location = 1) out uint ObjectID;
+
+flat in uint drawIndex;
+
+struct DrawRecord {
+    mat4 model;
+    mat4 normalMatrix;
+    uint firstIndex;
+    int baseVertex;
+    int diffuseLayer;
+    int specularLayer;
+    int normalLayer;
+    uint objectID;
+};
+layout(std430, binding = 3) readonly buffer DrawBuffer { DrawRecord draws[]; };
+
+void main()
+{
+    Visibility = uvec2(drawIndex + 1u, uint(gl_PrimitiveID));
+    ObjectID = draws[drawIndex].objectID;
+}
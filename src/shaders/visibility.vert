@@ -0,0 +1,33 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+// per-instance attribute advanced by each draw's baseInstance: the draw's index
+layout (location = 1) in uint aDrawIndex;
+
+// matches DrawRecord in VisibilityBuffer.hpp
+struct DrawRecord {
+    mat4 model;
+    mat4 normalMatrix;
+    uint firstIndex;
+    int baseVertex;
+    int diffuseLayer;
+    int specularLayer;
+    int normalLayer;
+    uint objectID;
+};
+layout(std430, binding = 3) readonly buffer DrawBuffer { DrawRecord draws[]; };
+
+layout(std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+flat out uint drawIndex;
+
+// the material pass rebuilds this exact position, so keep it bit-identical
+invariant gl_Position;
+
+void main()
+{
+    drawIndex = aDrawIndex;
+    gl_Position = projection * view * draws[aDrawIndex].model * vec4(aPos, 1.0);
+}
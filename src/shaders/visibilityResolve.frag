@@ -0,0 +1,122 @@
+#version 460 core
+// visibility-buffer material pass: fetch the covering triangle's vertices, rebuild the
+// attributes with analytic barycentrics and write the same G-buffer the deferred path uses
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec4 gNormalGloss;
+
+in vec2 TexCoords;
+
+struct DrawRecord {
+    mat4 model;
+    mat4 normalMatrix;
+    uint firstIndex;
+    int baseVertex;
+    int diffuseLayer;
+    int specularLayer;
+    int normalLayer;
+    uint objectID;
+};
+
+struct VisVertex {
+    vec4 positionU;
+    vec4 normalV;
+    vec4 tangent;
+};
+
+layout(std430, binding = 3) readonly buffer DrawBuffer { DrawRecord draws[]; };
+layout(std430, binding = 4) readonly buffer VertexBuffer { VisVertex vertices[]; };
+layout(std430, binding = 5) readonly buffer IndexBuffer { uint indices[]; };
+
+uniform usampler2D visibility;
+uniform sampler2DArray materialTextures;
+uniform mat4 viewProjection;
+uniform vec2 viewportSize;
+uniform bool useNormalMaps;
+uniform float shininess;
+
+vec2 OctWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+// perspective-correct barycentrics of the pixel plus how they change one pixel right/up,
+// which stand in for the screen-space derivatives a rasterised fragment would have had
+struct Barycentrics {
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+Barycentrics ComputeBarycentrics(vec4 p0, vec4 p1, vec4 p2, vec2 pixelNdc) {
+    Barycentrics b;
+    vec3 invW = 1.0 / vec3(p0.w, p1.w, p2.w);
+    vec2 ndc0 = p0.xy * invW.x;
+    vec2 ndc1 = p1.xy * invW.y;
+    vec2 ndc2 = p2.xy * invW.z;
+
+    float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float ddxSum = ddx.x + ddx.y + ddx.z;
+    float ddySum = ddy.x + ddy.y + ddy.z;
+
+    vec2 delta = pixelNdc - ndc0;
+    float interpInvW = invW.x + delta.x * ddxSum + delta.y * ddySum;
+    float interpW = 1.0 / interpInvW;
+    b.lambda = interpW * (vec3(invW.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy);
+
+    // one pixel is 2 / size in NDC
+    vec2 pixel = 2.0 / viewportSize;
+    ddx *= pixel.x;
+    ddy *= pixel.y;
+    ddxSum *= pixel.x;
+    ddySum *= pixel.y;
+    b.ddx = (b.lambda * interpInvW + ddx) / (interpInvW + ddxSum) - b.lambda;
+    b.ddy = (b.lambda * interpInvW + ddy) / (interpInvW + ddySum) - b.lambda;
+    return b;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    uvec2 vis = texelFetch(visibility, texel, 0).xy;
+    // background: the lighting pass skips it by depth, the skybox fills it later
+    if (vis.x == 0u) discard;
+
+    DrawRecord draw = draws[vis.x - 1u];
+    uint first = draw.firstIndex + vis.y * 3u;
+    VisVertex v0 = vertices[int(indices[first + 0u]) + draw.baseVertex];
+    VisVertex v1 = vertices[int(indices[first + 1u]) + draw.baseVertex];
+    VisVertex v2 = vertices[int(indices[first + 2u]) + draw.baseVertex];
+
+    mat4 mvp = viewProjection * draw.model;
+    vec2 pixelNdc = gl_FragCoord.xy / viewportSize * 2.0 - 1.0;
+    Barycentrics b = ComputeBarycentrics(mvp * vec4(v0.positionU.xyz, 1.0), mvp * vec4(v1.positionU.xyz, 1.0), mvp * vec4(v2.positionU.xyz, 1.0), pixelNdc);
+
+    mat3x2 uvs = mat3x2(vec2(v0.positionU.w, v0.normalV.w), vec2(v1.positionU.w, v1.normalV.w), vec2(v2.positionU.w, v2.normalV.w));
+    vec2 uv = uvs * b.lambda;
+    vec2 uvDx = uvs * b.ddx;
+    vec2 uvDy = uvs * b.ddy;
+
+    mat3 normalMatrix = mat3(draw.normalMatrix);
+    vec3 normal = normalize(normalMatrix * (mat3(v0.normalV.xyz, v1.normalV.xyz, v2.normalV.xyz) * b.lambda));
+    if (useNormalMaps && draw.normalLayer >= 0) {
+        // same tangent frame as gBuffer.vert
+        vec3 T = normalize(normalMatrix * (mat3(v0.tangent.xyz, v1.tangent.xyz, v2.tangent.xyz) * b.lambda));
+        T = normalize(T - dot(T, normal) * normal);
+        mat3 TBN = mat3(T, cross(normal, T), normal);
+        vec3 normalMap = textureGrad(materialTextures, vec3(uv, draw.normalLayer), uvDx, uvDy).rgb * 2.0 - 1.0;
+        normal = normalize(TBN * normalMap);
+    }
+
+    vec3 albedo = draw.diffuseLayer >= 0 ? textureGrad(materialTextures, vec3(uv, draw.diffuseLayer), uvDx, uvDy).rgb : vec3(1.0);
+    float specular = draw.specularLayer >= 0 ? textureGrad(materialTextures, vec3(uv, draw.specularLayer), uvDx, uvDy).r : 0.0;
+
+    gAlbedoSpec = vec4(albedo, specular);
+    gNormalGloss = vec4(EncodeNormal(normal), clamp(shininess / 256.0, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,181 @@
+// Standalone check of the CPU occlusion culler, no GL or window needed: `make checkculling` in build/.
+// A fixed random scene of occluder quads and boxes is rasterized, then thousands of random boxes
+// are tested against it. Every box the culler rejects is ray cast through every pixel centre of the
+// buffer against the same occluders; a single pixel where the box is hit before any occluder is a
+// false cull. The buffer rasterized on several threads has to match the single-threaded one exactly.
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../src/JobSystem.hpp"
+#include "../src/OcclusionCulling.hpp"
+
+static constexpr int OCCLUDER_QUADS = 60;
+static constexpr int OCCLUDER_BOXES = 20;
+static constexpr int TEST_BOXES = 3000;
+// reference hits are taken at the pixel centre and a little around it; an occluder only counts
+// where all of them agree, so a box along an occluder's edge never has to be culled
+static constexpr float EDGE_MARGIN = 0.02f;
+
+struct Mesh {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+};
+
+// counter-clockwise from outside, like the models the culler gets
+static void addBox(Mesh& mesh, const glm::vec3& lo, const glm::vec3& hi) {
+    const unsigned int base = (unsigned int)mesh.positions.size();
+    for (int k = 0; k < 8; k++) { mesh.positions.push_back(glm::vec3((k & 1) ? hi.x : lo.x, (k & 2) ? hi.y : lo.y, (k & 4) ? hi.z : lo.z)); }
+    const unsigned int faces[6][4] = {
+        {0, 4, 6, 2}, {1, 3, 7, 5},     // -x, +x
+        {0, 1, 5, 4}, {2, 6, 7, 3},     // -y, +y
+        {0, 2, 3, 1}, {4, 5, 7, 6}      // -z, +z
+    };
+    for (const auto& f : faces) { mesh.indices.insert(mesh.indices.end(), {base + f[0], base + f[1], base + f[2], base + f[0], base + f[2], base + f[3]}); }
+}
+
+// facing +z, towards a camera at the origin looking down -z
+static void addQuad(Mesh& mesh, const glm::vec3& center, const glm::vec2& halfSize) {
+    const unsigned int base = (unsigned int)mesh.positions.size();
+    mesh.positions.push_back(center + glm::vec3(-halfSize.x, -halfSize.y, 0.0f));
+    mesh.positions.push_back(center + glm::vec3(halfSize.x, -halfSize.y, 0.0f));
+    mesh.positions.push_back(center + glm::vec3(halfSize.x, halfSize.y, 0.0f));
+    mesh.positions.push_back(center + glm::vec3(-halfSize.x, halfSize.y, 0.0f));
+    mesh.indices.insert(mesh.indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+}
+
+// nearest front-facing hit along origin + t * dir, FLT_MAX if none
+static float castOccluders(const Mesh& mesh, const glm::vec3& origin, const glm::vec3& dir) {
+    float nearest = FLT_MAX;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const glm::vec3 a = mesh.positions[mesh.indices[i]], b = mesh.positions[mesh.indices[i + 1]], c = mesh.positions[mesh.indices[i + 2]];
+        const glm::vec3 e1 = b - a, e2 = c - a;
+        const glm::vec3 p = glm::cross(dir, e2);
+        const float det = glm::dot(e1, p);
+        if (det <= 0.0f) continue;      // back facing, the culler skips those too
+        const glm::vec3 s = origin - a;
+        const float u = glm::dot(s, p) / det;
+        if (u < 0.0f || u > 1.0f) continue;
+        const glm::vec3 q = glm::cross(s, e1);
+        const float v = glm::dot(dir, q) / det;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        const float t = glm::dot(e2, q) / det;
+        if (t >= 0.0f) nearest = std::min(nearest, t);
+    }
+    return nearest;
+}
+
+// entry distance of the ray into the box, FLT_MAX if it misses
+static float castBox(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& origin, const glm::vec3& dir) {
+    float t0 = 0.0f, t1 = FLT_MAX;
+    for (int k = 0; k < 3; k++) {
+        const float inv = 1.0f / dir[k];
+        float a = (lo[k] - origin[k]) * inv, b = (hi[k] - origin[k]) * inv;
+        if (a > b) std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+    return t0 <= t1 ? t0 : FLT_MAX;
+}
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (condition) return;
+    std::printf("FAILED: %s\n", what);
+    failures++;
+}
+
+int main() {
+    const int W = OcclusionCuller::WIDTH, H = OcclusionCuller::HEIGHT;
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)W / (float)H, 0.1f, 100.0f);
+    const glm::mat4 viewProjection = projection;   // camera at the origin, looking down -z
+    const glm::mat4 inverse = glm::inverse(viewProjection);
+
+    std::mt19937 rng(12345);
+    auto uniform = [&](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+
+    Mesh occluderMesh;
+    for (int i = 0; i < OCCLUDER_QUADS; i++) { addQuad(occluderMesh, glm::vec3(uniform(-20.0f, 20.0f), uniform(-12.0f, 12.0f), uniform(-30.0f, -4.0f)), glm::vec2(uniform(0.5f, 4.0f), uniform(0.5f, 4.0f))); }
+    for (int i = 0; i < OCCLUDER_BOXES; i++) {
+        glm::vec3 center(uniform(-15.0f, 15.0f), uniform(-8.0f, 8.0f), uniform(-25.0f, -5.0f));
+        glm::vec3 half(uniform(0.3f, 2.0f), uniform(0.3f, 2.0f), uniform(0.3f, 2.0f));
+        addBox(occluderMesh, center - half, center + half);
+    }
+    std::vector<OcclusionCuller::Occluder> occluders = {{&occluderMesh.positions, &occluderMesh.indices, glm::mat4(1.0f)}};
+
+    // MARK: single thread against several
+    OcclusionCuller culler, threadedCuller;
+    {
+        JobSystem single(0);
+        culler.rasterize(occluders, viewProjection, single);
+    }
+    {
+        JobSystem threaded(3);
+        threadedCuller.rasterize(occluders, viewProjection, threaded);
+    }
+    std::printf("%d occluder triangles, rasterized on %d and %d threads\n", culler.getStats().occluderTriangles, culler.getStats().threads, threadedCuller.getStats().threads);
+    check(threadedCuller.getStats().threads > 1, "the threaded rasterizer ran on more than one thread");
+    check(culler.sameBuffer(threadedCuller), "the threaded buffer matches the single-threaded one");
+
+    // MARK: reference
+    // every pixel centre's ray from the near to the far plane, with the nearest occluder hit all
+    // samples around the centre agree on
+    std::vector<glm::vec3> rayOrigins(W * H), rayDirs(W * H);
+    std::vector<float> occluderDepth(W * H);
+    const glm::vec2 offsets[5] = {{0.0f, 0.0f}, {-EDGE_MARGIN, 0.0f}, {EDGE_MARGIN, 0.0f}, {0.0f, -EDGE_MARGIN}, {0.0f, EDGE_MARGIN}};
+    auto ray = [&](float px, float py, glm::vec3& origin, glm::vec3& dir) {
+        const float x = px / W * 2.0f - 1.0f, y = py / H * 2.0f - 1.0f;
+        glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f), farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+        origin = glm::vec3(nearPoint) / nearPoint.w;
+        dir = glm::vec3(farPoint) / farPoint.w - origin;    // t in [0, 1] spans the frustum
+    };
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float depth = 0.0f;
+            for (const glm::vec2& offset : offsets) {
+                glm::vec3 origin, dir;
+                ray(x + 0.5f + offset.x, y + 0.5f + offset.y, origin, dir);
+                depth = std::max(depth, castOccluders(occluderMesh, origin, dir));
+            }
+            ray(x + 0.5f, y + 0.5f, rayOrigins[y * W + x], rayDirs[y * W + x]);
+            occluderDepth[y * W + x] = depth;
+        }
+    }
+
+    // MARK: no false culls
+    int occluded = 0, outside = 0, falseCulls = 0;
+    for (int i = 0; i < TEST_BOXES; i++) {
+        glm::vec3 center(uniform(-25.0f, 25.0f), uniform(-15.0f, 15.0f), uniform(-45.0f, 2.0f));
+        glm::vec3 half(uniform(0.05f, 1.5f), uniform(0.05f, 1.5f), uniform(0.05f, 1.5f));
+        const glm::vec3 lo = center - half, hi = center + half;
+        OcclusionCuller::Result result = culler.test(lo, hi, viewProjection);
+        check(threadedCuller.test(lo, hi, viewProjection) == result, "both buffers give the same result");
+        if (result == OcclusionCuller::Visible) continue;
+        (result == OcclusionCuller::Occluded ? occluded : outside)++;
+        for (int p = 0; p < W * H; p++) {
+            const float t = castBox(lo, hi, rayOrigins[p], rayDirs[p]);
+            if (t > 1.0f || t >= occluderDepth[p]) continue;
+            std::printf("box %d (%.2f %.2f %.2f)-(%.2f %.2f %.2f) %s but seen at pixel %d,%d\n", i, lo.x, lo.y, lo.z, hi.x, hi.y, hi.z,
+                        result == OcclusionCuller::Occluded ? "occluded" : "outside the frustum", p % W, p / W);
+            falseCulls++;
+            break;
+        }
+    }
+    std::printf("%d boxes: %d occluded, %d outside the frustum, %d false culls\n", TEST_BOXES, occluded, outside, falseCulls);
+    check(falseCulls == 0, "no box is culled where it can be seen");
+    check(occluded > TEST_BOXES / 20, "the scene occludes enough boxes to mean something");
+
+    if (failures) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}